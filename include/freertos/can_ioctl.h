@@ -59,6 +59,11 @@ typedef uint32_t can_state_t;
 /** Read the CAN state */
 #define SIOCGCANSTATE IOR(CAN_IOC_MAGIC, 3, sizeof(can_state_t))
 
+/** Read the number of idle packets a DCC track driver sent because it had
+ * no packet queued. Argument is a pointer to a uint32_t, which receives the
+ * running count since the driver started. */
+#define DCC_IOC_IDLE_PACKETS IOR(CAN_IOC_MAGIC, 4, sizeof(uint32_t))
+
 /** CAN bus active */
 #define CAN_STATE_ACTIVE            0
 
@@ -37,6 +37,7 @@
 #include <dirent.h>
 
 #include "console/Console.hxx"
+#include "utils/StringBuilder.hxx"
 
 /// Container for all the file system operations.
 /// This class can be used by intantiating an instance of FileCommands and
@@ -247,17 +248,19 @@ private:
         type = S_ISDIR(stat->st_mode) ? 'd' : '-';
         type = S_ISLNK(stat->st_mode) ? 'l' : type;
 
-        fprintf(fp, "%c%c%c%c%c%c%c%c%c%c %5ld %s\n", type,
-                stat->st_mode & S_IRUSR ? 'r' : '-',
-                stat->st_mode & S_IWUSR ? 'w' : '-',
-                stat->st_mode & S_IXUSR ? 'x' : '-',
-                stat->st_mode & S_IRGRP ? 'r' : '-',
-                stat->st_mode & S_IWGRP ? 'w' : '-',
-                stat->st_mode & S_IXGRP ? 'x' : '-',
-                stat->st_mode & S_IROTH ? 'r' : '-',
-                stat->st_mode & S_IWOTH ? 'w' : '-',
-                stat->st_mode & S_IXOTH ? 'x' : '-',
-                stat->st_size, name);
+        /* mode and size are rendered without printf */
+        StringBuilder<32> line;
+        line.push_back(type);
+        static const char PERMISSIONS[] = "rwxrwxrwx";
+        for (unsigned i = 0; i < 9; ++i)
+        {
+            line.push_back(
+                stat->st_mode & (S_IRUSR >> i) ? PERMISSIONS[i] : '-');
+        }
+        line.push_back(' ').append_int64(stat->st_size, 5, ' ').push_back(' ');
+        fputs(line.c_str(), fp);
+        fputs(name, fp);
+        fputc('\n', fp);
     }
 
     DISALLOW_COPY_AND_ASSIGN(FileCommands);
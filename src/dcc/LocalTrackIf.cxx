@@ -33,6 +33,8 @@
  * @date 24 Aug 2014
  */
 
+#include <algorithm>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -71,4 +73,102 @@ StateFlowBase::Action LocalTrackIfSelect::entry() {
     return write_repeated(&helper_, fd_, p, sizeof(*p), STATE(finish));
 }
 
+LocalTrackIfBatched::LocalTrackIfBatched(
+    Service *service, int pool_size, unsigned ring_size)
+    : LocalTrackIf(service, pool_size)
+    , ring_(new dcc::Packet[ring_size])
+    , ringSize_(ring_size)
+{
+}
+
+StateFlowBase::Action LocalTrackIfBatched::entry()
+{
+    if (count_ == ringSize_)
+    {
+        // The writer will wake us up.
+        blocked_ = true;
+        return wait();
+    }
+    unsigned idx = rdIndex_ + count_;
+    if (idx >= ringSize_)
+    {
+        idx -= ringSize_;
+    }
+    ring_[idx] = *message()->data();
+    ++count_;
+    writer_.kick();
+    return finish();
+}
+
+int LocalTrackIfBatched::device_write(
+    const dcc::Packet *packets, unsigned count)
+{
+    HASSERT(fd_ >= 0);
+    int ret = ::write(fd_, packets, count * sizeof(dcc::Packet));
+    if (ret < 0)
+    {
+        if (errno == ENOSPC || errno == EAGAIN)
+        {
+            return 0;
+        }
+        LOG(WARNING, "LocalTrackIf: write to the track device failed: %s",
+            strerror(errno));
+        return -1;
+    }
+    return ret / sizeof(dcc::Packet);
+}
+
+void LocalTrackIfBatched::device_wait_writable(Notifiable *n)
+{
+    ::ioctl(fd_, CAN_IOC_WRITE_ACTIVE, n);
+}
+
+bool LocalTrackIfBatched::device_idle_packets(uint32_t *count)
+{
+    return fd_ >= 0 && ::ioctl(fd_, DCC_IOC_IDLE_PACKETS, count) == 0;
+}
+
+StateFlowBase::Action LocalTrackIfBatched::Writer::try_write()
+{
+    LocalTrackIfBatched *p = parent_;
+    if (!p->count_)
+    {
+        return exit();
+    }
+    // Contiguous part of the ring.
+    unsigned len = std::min(p->count_, p->ringSize_ - p->rdIndex_);
+    int ret = p->device_write(&p->ring_[p->rdIndex_], len);
+    if (!ret)
+    {
+        p->device_wait_writable(this);
+        return wait();
+    }
+    unsigned written;
+    if (ret < 0)
+    {
+        // Drops the packets, so that a failing device does not stall the
+        // update loop.
+        ++p->stats_.errors;
+        written = len;
+    }
+    else
+    {
+        ++p->stats_.writes;
+        p->stats_.packets += ret;
+        written = ret;
+    }
+    p->rdIndex_ += written;
+    if (p->rdIndex_ >= p->ringSize_)
+    {
+        p->rdIndex_ = 0;
+    }
+    p->count_ -= written;
+    if (p->blocked_)
+    {
+        p->blocked_ = false;
+        p->notify();
+    }
+    return again();
+}
+
 } // namespace dcc
@@ -36,6 +36,8 @@
 #ifndef _DCC_LOCALTRACKIF_HXX_
 #define _DCC_LOCALTRACKIF_HXX_
 
+#include <memory>
+
 #include "executor/Executor.hxx"
 #include "executor/StateFlow.hxx"
 #include "dcc/Packet.hxx"
@@ -114,6 +116,122 @@ protected:
     StateFlowSelectHelper helper_{this};
 };
 
+/// StateFlow that accepts dcc::Packet structures and sends them to a local
+/// device driver in batches, without ever blocking the executor.
+///
+/// The incoming packets are copied into a ring buffer and released right
+/// away, so that the update loop can generate the upcoming packets while the
+/// device is busy. A separate writer flow writes as many packets from the
+/// ring to the device as it accepts in a single write() call. When the
+/// device is full, the writer waits for the device to notify (same model as
+/// @ref LocalTrackIf); when the ring is full, the incoming packet waits in
+/// the queue.
+///
+/// The device driver must support the notifiable-based asynchronous write
+/// model, and accept writes of any number of packets, returning the number of
+/// bytes of the whole packets taken (like TivaDCC).
+class LocalTrackIfBatched : public LocalTrackIf
+{
+public:
+    /** Constructs a TrackInterface from an fd to the mainline.
+     *
+     * @param service Usually the main executor.
+     * @param pool_size will determine how many packets the current flow's
+     * alloc() will have.
+     * @param ring_size is the number of packets to buffer before the device.
+     */
+    LocalTrackIfBatched(Service *service, int pool_size, unsigned ring_size);
+
+    /// Counters about the operation.
+    struct Stats
+    {
+        /// Number of packets written to the device.
+        unsigned packets{0};
+        /// Number of write calls to the device that took packets.
+        unsigned writes{0};
+        /// Number of write calls that failed. The packets of a failed write
+        /// are dropped.
+        unsigned errors{0};
+        /// Number of idle packets the device sent because it had no packet
+        /// from us (i.e. underruns). Stays zero if the device does not report
+        /// it.
+        uint32_t idlePackets{0};
+    };
+
+    /// @return the counters. Must be called on the executor.
+    const Stats &stats()
+    {
+        uint32_t idle;
+        if (device_idle_packets(&idle))
+        {
+            stats_.idlePackets = idle;
+        }
+        return stats_;
+    }
+
+protected:
+    Action entry() override;
+
+    /// Writes packets to the device. Must not block.
+    /// @param packets points to the packets to write.
+    /// @param count number of packets to write.
+    /// @return the number of packets taken by the device, zero if the device
+    /// is full, negative if the device returned an error.
+    virtual int device_write(const dcc::Packet *packets, unsigned count);
+
+    /// Asks the device to notify when it can accept more packets.
+    /// @param n is the notifiable to call.
+    virtual void device_wait_writable(Notifiable *n);
+
+    /// Reads the idle packet counter of the device.
+    /// @param count receives the number of idle packets the device sent since
+    /// it started.
+    /// @return false if the device does not support this.
+    virtual bool device_idle_packets(uint32_t *count);
+
+private:
+    /// Flow that moves packets from the ring to the device.
+    class Writer : public StateFlowBase
+    {
+    public:
+        Writer(LocalTrackIfBatched *parent)
+            : StateFlowBase(parent->service())
+            , parent_(parent)
+        {
+        }
+
+        /// Starts writing if the writer is idle.
+        void kick()
+        {
+            if (is_terminated())
+            {
+                start_flow(STATE(try_write));
+            }
+        }
+
+    private:
+        /// Writes the next batch. @return next action.
+        Action try_write();
+
+        LocalTrackIfBatched *parent_;
+    };
+
+    /// Upcoming packets.
+    std::unique_ptr<dcc::Packet[]> ring_;
+    /// Number of entries in ring_.
+    unsigned ringSize_;
+    /// Index of the oldest packet in the ring.
+    unsigned rdIndex_{0};
+    /// Number of packets in the ring.
+    unsigned count_{0};
+    /// True if the current message waits for space in the ring.
+    bool blocked_{false};
+    /// Counters.
+    Stats stats_;
+    /// Moves the packets to the device.
+    Writer writer_{this};
+};
+
 } // namespace dcc
 
 #endif // _DCC_LOCALTRACKIF_HXX_
@@ -45,12 +45,7 @@ namespace dcc
 /// file.
 extern void createtrains();
 
-template <> DccTrain<Dcc28Payload>::~DccTrain()
-{
-    packet_processor_remove_refresh_source(this);
-}
-
-template <> DccTrain<Dcc128Payload>::~DccTrain()
+template <class Payload, class Cache> DccTrain<Payload, Cache>::~DccTrain()
 {
     packet_processor_remove_refresh_source(this);
 }
@@ -81,19 +76,11 @@ unsigned Dcc28Payload::get_fn_update_code(unsigned address)
 }
 
 // Generates next outgoing packet.
-template <class Payload>
-void DccTrain<Payload>::get_next_packet(unsigned code, Packet *packet)
+template <class Payload, class Cache>
+void DccTrain<Payload, Cache>::get_next_packet(unsigned code, Packet *packet)
 {
-    packet->start_dcc_packet();
-    if (this->p.isShortAddress_)
-    {
-        packet->add_dcc_address(DccShortAddress(this->p.address_));
-    }
-    else
-    {
-        packet->add_dcc_address(DccLongAddress(this->p.address_));
-    }
-    if (code == REFRESH)
+    bool refresh = (code == REFRESH);
+    if (refresh)
     {
         code = MIN_REFRESH + this->p.nextRefresh_++;
         if (this->p.nextRefresh_ > MAX_REFRESH - MIN_REFRESH)
@@ -101,11 +88,38 @@ void DccTrain<Payload>::get_next_packet(unsigned code, Packet *packet)
             this->p.nextRefresh_ = 0;
         }
     }
+    if (Cache::get_cached(code, packet))
+    {
+        packet->feedback_key = this->p.address_;
+        if (code == SPEED)
+        {
+            this->p.directionChanged_ = 0;
+        }
+    }
     else
+    {
+        encode_packet(code, packet);
+        Cache::put_cached(code, *packet);
+    }
+    if (!refresh && code != ESTOP)
     {
         // User action. Up repeat count.
         packet->packet_header.rept_count = 2;
     }
+}
+
+template <class Payload, class Cache>
+void DccTrain<Payload, Cache>::encode_packet(unsigned code, Packet *packet)
+{
+    packet->start_dcc_packet();
+    if (this->p.isShortAddress_)
+    {
+        packet->add_dcc_address(DccShortAddress(this->p.address_));
+    }
+    else
+    {
+        packet->add_dcc_address(DccLongAddress(this->p.address_));
+    }
     switch (code)
     {
         case FUNCTION0:
@@ -269,6 +283,8 @@ void MMNewTrain::get_next_packet(unsigned code, Packet *packet)
 void createtrains() {
     Dcc28Train train1(DccShortAddress(1));
     Dcc128Train train2(DccShortAddress(1));
+    CachedDcc28Train train5(DccShortAddress(1));
+    CachedDcc128Train train6(DccShortAddress(1));
     MMNewTrain train3(MMAddress(1));
     MMOldTrain train4(MMAddress(1));
 }
@@ -116,21 +116,11 @@ public:
             p.directionChanged_ = 1;
             p.direction_ = speed.direction();
         }
-        float f_speed = speed.mph();
-        if (f_speed > 0)
-        {
-            f_speed *= ((p.get_speed_steps() * 1.0) / 126);
-            unsigned sp = f_speed;
-            sp++; // makes sure it is at least speed step 1.
-            if (sp > p.get_speed_steps())
-                sp = p.get_speed_steps();
-            LOG(VERBOSE, "set speed to step %u", sp);
-            p.speed_ = sp;
-        }
-        else
-        {
-            p.speed_ = 0;
-        }
+        unsigned sp =
+            SpeedType::wire_to_speed_step(new_speed, p.get_speed_steps());
+        LOG(VERBOSE, "set speed to step %u", sp);
+        p.speed_ = sp;
+        invalidate_cached_packet(SPEED);
         packet_processor_notify_update(this, SPEED);
     }
 
@@ -155,6 +145,7 @@ public:
         dir0.set_direction(p.direction_);
         p.lastSetSpeed_ = dir0.get_wire();
         p.directionChanged_ = 1;
+        invalidate_cached_packet(SPEED);
         /// @todo (Stuart.Baker) We should not just send a single E-Stop burst.
         /// It is possible that the loco was on dirt and missed this.  Should
         /// send continuous E-Stop packets until the estop condition is cleared.
@@ -183,7 +174,9 @@ public:
         {
             p.fn_ &= ~bit;
         }
-        packet_processor_notify_update(this, p.get_fn_update_code(address));
+        unsigned code = p.get_fn_update_code(address);
+        invalidate_cached_packet(code);
+        packet_processor_notify_update(this, code);
     }
     /// @return the last set value of a given function, or 0 if the function is
     /// not known. @param address is the function address.
@@ -208,6 +201,12 @@ public:
     }
 
 protected:
+    /// Called when the state changes that is sent to the track in a given
+    /// packet type. @param code is the DccTrainUpdateCode of the packet.
+    virtual void invalidate_cached_packet(unsigned code)
+    {
+    }
+
     /// Payload -- actual data we know about the train.
     P p;
 };
@@ -273,8 +272,113 @@ struct Dcc28Payload
     }
 };
 
+/// Packet cache policy for @ref DccTrain that does not cache anything, and
+/// takes no memory.
+struct NoPacketCache
+{
+    /// @return false (cache miss). @param code is the packet code, @param
+    /// packet is the output.
+    bool get_cached(unsigned code, Packet *packet)
+    {
+        return false;
+    }
+
+    /// Ignored. @param code is the packet code, @param packet is the encoded
+    /// packet.
+    void put_cached(unsigned code, const Packet &packet)
+    {
+    }
+
+    /// Ignored. @param code is the packet code.
+    void invalidate_cached(unsigned code)
+    {
+    }
+};
+
+/// Packet cache policy for @ref DccTrain that keeps the encoded bytes of the
+/// speed and function group packets, so that the refresh loop only copies
+/// them instead of encoding the address, payload and checksum every
+/// time. Costs 43 bytes of RAM per train.
+class DccPacketCache
+{
+public:
+    /// Copies a cached packet.
+    /// @param code is the packet code (DccTrainUpdateCode).
+    /// @param packet is the output.
+    /// @return true if the packet was in the cache.
+    bool get_cached(unsigned code, Packet *packet)
+    {
+        unsigned idx = code - FIRST_CODE;
+        if (idx >= NUM_CODES || !(valid_ & (1 << idx)))
+        {
+            return false;
+        }
+        const Entry &e = entries_[idx];
+        packet->header_raw_data = e.header;
+        packet->dlc = e.dlc;
+        memcpy(packet->payload, e.payload, MAX_LEN);
+        return true;
+    }
+
+    /// Stores an encoded packet.
+    /// @param code is the packet code (DccTrainUpdateCode).
+    /// @param packet is the encoded packet.
+    void put_cached(unsigned code, const Packet &packet)
+    {
+        unsigned idx = code - FIRST_CODE;
+        if (idx >= NUM_CODES || packet.dlc > MAX_LEN)
+        {
+            return;
+        }
+        Entry &e = entries_[idx];
+        e.header = packet.header_raw_data;
+        e.dlc = packet.dlc;
+        memcpy(e.payload, packet.payload, MAX_LEN);
+        valid_ |= (1 << idx);
+    }
+
+    /// Drops a packet from the cache.
+    /// @param code is the packet code (DccTrainUpdateCode).
+    void invalidate_cached(unsigned code)
+    {
+        unsigned idx = code - FIRST_CODE;
+        if (idx < NUM_CODES)
+        {
+            valid_ &= ~(1 << idx);
+        }
+    }
+
+private:
+    /// First packet code we cache.
+    static constexpr unsigned FIRST_CODE = SPEED;
+    /// Number of packet codes we cache (speed and the function groups).
+    static constexpr unsigned NUM_CODES = FUNCTION21 - SPEED + 1;
+    /// Longest packet (long address, two bytes of instruction and the
+    /// checksum).
+    static constexpr unsigned MAX_LEN = 5;
+
+    /// One encoded packet.
+    struct Entry
+    {
+        uint8_t header;
+        uint8_t dlc;
+        uint8_t payload[MAX_LEN];
+    };
+
+    /// Encoded packets, indexed by code - FIRST_CODE.
+    Entry entries_[NUM_CODES];
+    /// Bit i is set if entries_[i] is valid.
+    uint8_t valid_ = 0;
+};
+
 /// TrainImpl class for a DCC locomotive.
-template <class Payload> class DccTrain : public AbstractTrain<Payload>
+///
+/// @param Payload is the structure storing the train state, e.g. @ref
+/// Dcc28Payload.
+/// @param Cache is the packet cache policy, either @ref NoPacketCache (for
+/// command stations with little RAM) or @ref DccPacketCache.
+template <class Payload, class Cache = NoPacketCache>
+class DccTrain : public AbstractTrain<Payload>, private Cache
 {
 public:
     /// Constructor. @param a is the address.
@@ -299,6 +403,16 @@ public:
     /// requested by the previous cycle or the on-update notification). @param
     /// packet needs to be filled in for the output.
     void get_next_packet(unsigned code, Packet *packet) OVERRIDE;
+
+private:
+    void invalidate_cached_packet(unsigned code) override
+    {
+        Cache::invalidate_cached(code);
+    }
+
+    /// Encodes a packet from the current state. @param code is the packet
+    /// code (not REFRESH), @param packet is the output.
+    void encode_packet(unsigned code, Packet *packet);
 };
 
 /// TrainImpl class for a 28-speed-step DCC locomotive.
@@ -371,6 +485,11 @@ struct Dcc128Payload
 /// TrainImpl class for a 128-speed-step DCC locomotive.
 typedef DccTrain<Dcc128Payload> Dcc128Train;
 
+/// 28-speed-step DCC locomotive with cached packet encoding.
+typedef DccTrain<Dcc28Payload, DccPacketCache> CachedDcc28Train;
+/// 128-speed-step DCC locomotive with cached packet encoding.
+typedef DccTrain<Dcc128Payload, DccPacketCache> CachedDcc128Train;
+
 /// Structure defining the volatile state for a Marklin-Motorola v1 protocol
 /// locomotive (with 14 speed steps, one function and relative direction only).
 struct MMOldPayload
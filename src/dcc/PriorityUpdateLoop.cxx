@@ -0,0 +1,403 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file PriorityUpdateLoop.cxx
+ *
+ * Control flow central to the command station: it sends user-requested
+ * changes to the track with priority, and refreshes the state of the
+ * individual trains in the remaining packet slots.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "dcc/PriorityUpdateLoop.hxx"
+#include "dcc/Loco.hxx"
+#include "dcc/Packet.hxx"
+#include "dcc/PacketSource.hxx"
+
+namespace dcc
+{
+
+PriorityUpdateLoop::PriorityUpdateLoop(
+    Service *service, PacketFlowInterface *track_send)
+    : StateFlow(service)
+    , trackSend_(track_send)
+{
+}
+
+PriorityUpdateLoop::~PriorityUpdateLoop()
+{
+}
+
+bool PriorityUpdateLoop::add_refresh_source(
+    dcc::PacketSource *source, unsigned priority)
+{
+    OSMutexLock h(&lock_);
+    bool ret = true;
+    for (const auto &x : exclusive_)
+    {
+        if (x.priority > priority)
+        {
+            ret = false;
+        }
+    }
+    if (priority >= EXCLUSIVE_MIN_PRIORITY)
+    {
+        exclusive_.push_back({source, priority});
+        return ret;
+    }
+    auto it = entries_.emplace(source, Entry()).first;
+    if (it->second.source == source)
+    {
+        // Already registered.
+        return ret;
+    }
+    Entry *e = &it->second;
+    e->source = source;
+    e->lastRefresh = 0;
+    e->pending = 0;
+    // We cannot ask the source about its speed, because it might be under
+    // construction.
+    ring_add(e, RING_STOPPED);
+    return ret;
+}
+
+void PriorityUpdateLoop::remove_refresh_source(dcc::PacketSource *source)
+{
+    // Waits if the loop is calling the source right now.
+    OSMutexLock cl(&callLock_);
+    OSMutexLock h(&lock_);
+    for (auto it = exclusive_.begin(); it != exclusive_.end(); ++it)
+    {
+        if (it->source == source)
+        {
+            exclusive_.erase(it);
+            return;
+        }
+    }
+    auto it = entries_.find(source);
+    if (it == entries_.end())
+    {
+        return;
+    }
+    Entry *e = &it->second;
+    ring_remove(e);
+    purge(e);
+    entries_.erase(it);
+}
+
+void PriorityUpdateLoop::notify_update(PacketSource *source, unsigned code)
+{
+    OSMutexLock h(&lock_);
+    auto it = entries_.find(source);
+    if (it == entries_.end())
+    {
+        return;
+    }
+    enqueue(&it->second, code);
+}
+
+StateFlowBase::Action PriorityUpdateLoop::entry()
+{
+    dcc::Packet *packet = message()->data();
+    long long now = get_time();
+    {
+        OSMutexLock cl(&callLock_);
+        dcc::PacketSource *source = nullptr;
+        Entry *e = nullptr;
+        unsigned code = 0;
+        {
+            OSMutexLock h(&lock_);
+            if (!exclusive_.empty())
+            {
+                const Exclusive *best = &exclusive_[0];
+                for (const auto &x : exclusive_)
+                {
+                    if (x.priority > best->priority)
+                    {
+                        best = &x;
+                    }
+                }
+                source = best->source;
+            }
+            else if (!urgent_.empty())
+            {
+                e = take_command(&urgent_, &code);
+            }
+            else if (!updates_.empty() &&
+                updatesInARow_ < MAX_UPDATES_IN_A_ROW)
+            {
+                ++updatesInARow_;
+                e = take_command(&updates_, &code);
+            }
+            else
+            {
+                updatesInARow_ = 0;
+                e = take_refresh(now, &code);
+            }
+            if (e)
+            {
+                e->lastRefresh = now;
+                source = e->source;
+            }
+        }
+        // The source is called without lock_, so that the throttles calling
+        // notify_update do not wait for it. callLock_ keeps the source (and
+        // its entry) registered.
+        if (source)
+        {
+            source->get_next_packet(code, packet);
+        }
+        else
+        {
+            packet->set_dcc_idle();
+        }
+        if (e)
+        {
+            bool moving = source->get_speed().speed() != 0;
+            OSMutexLock h(&lock_);
+            classify(e, moving);
+        }
+    }
+    // We pass on the filled packet to the track processor.
+    trackSend_->send(transfer_message());
+    return exit();
+}
+
+void PriorityUpdateLoop::ring_add(Entry *e, unsigned ring)
+{
+    Ring *r = &rings_[ring];
+    e->ring = ring;
+    ++r->size;
+    if (!r->next)
+    {
+        e->prev = e->next = e;
+        r->next = e;
+        return;
+    }
+    e->next = r->next;
+    e->prev = r->next->prev;
+    e->prev->next = e;
+    e->next->prev = e;
+}
+
+void PriorityUpdateLoop::ring_remove(Entry *e)
+{
+    Ring *r = &rings_[e->ring];
+    --r->size;
+    if (!r->size)
+    {
+        r->next = nullptr;
+        return;
+    }
+    if (r->next == e)
+    {
+        // Nobody misses their turn.
+        r->next = e->next;
+    }
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+void PriorityUpdateLoop::classify(Entry *e, bool moving)
+{
+    unsigned ring = moving ? RING_MOVING : RING_STOPPED;
+    if (ring != e->ring)
+    {
+        ring_remove(e);
+        ring_add(e, ring);
+    }
+}
+
+void PriorityUpdateLoop::enqueue(Entry *e, unsigned code)
+{
+    unsigned first = 0;
+    unsigned last = MAX_CODES_PER_SOURCE;
+    CommandQueue *q = &updates_;
+    if (code == ESTOP)
+    {
+        first = URGENT_SLOT;
+        last = URGENT_SLOT + 1;
+        q = &urgent_;
+    }
+    unsigned free_slot = last;
+    for (unsigned i = first; i < last; ++i)
+    {
+        Command *c = &e->commands[i];
+        if (!(e->pending & (1u << i)))
+        {
+            free_slot = std::min(free_slot, i);
+        }
+        else if (c->code == code)
+        {
+            // The source will generate the packet from its current state, so
+            // the new value goes out with the full repeat count.
+            c->repeats = UPDATE_REPEATS;
+            return;
+        }
+    }
+    if (free_slot == last)
+    {
+        // The command is dropped; the background refresh will send the
+        // current state.
+        return;
+    }
+    Command *c = &e->commands[free_slot];
+    c->entry = e;
+    c->code = code;
+    c->repeats = UPDATE_REPEATS;
+    e->pending |= 1u << free_slot;
+    q->push(c);
+}
+
+void PriorityUpdateLoop::purge(Entry *e)
+{
+    for (unsigned i = 0; i <= URGENT_SLOT; ++i)
+    {
+        if (e->pending & (1u << i))
+        {
+            (i == URGENT_SLOT ? urgent_ : updates_).remove(&e->commands[i]);
+        }
+    }
+    e->pending = 0;
+}
+
+PriorityUpdateLoop::Entry *PriorityUpdateLoop::take_command(
+    CommandQueue *q, unsigned *code)
+{
+    Command *c = q->pop();
+    Entry *e = c->entry;
+    *code = c->code;
+    if (--c->repeats)
+    {
+        q->push(c);
+    }
+    else
+    {
+        e->pending &= ~(1u << (c - e->commands));
+    }
+    return e;
+}
+
+PriorityUpdateLoop::Entry *PriorityUpdateLoop::take_refresh(
+    long long now, unsigned *code)
+{
+    unsigned first = RING_MOVING;
+    unsigned second = RING_STOPPED;
+    if (movingInARow_ >= MOVING_SHARE)
+    {
+        std::swap(first, second);
+    }
+    Entry *e = pick(first, now);
+    if (!e)
+    {
+        e = pick(second, now);
+    }
+    if (!e)
+    {
+        if (!updates_.empty())
+        {
+            // Nothing to refresh; no reason to hold back the updates.
+            return take_command(&updates_, code);
+        }
+        return nullptr;
+    }
+    if (e->ring == RING_MOVING)
+    {
+        ++movingInARow_;
+    }
+    else
+    {
+        movingInARow_ = 0;
+    }
+    *code = 0;
+    return e;
+}
+
+PriorityUpdateLoop::Entry *PriorityUpdateLoop::pick(unsigned ring, long long now)
+{
+    Ring *r = &rings_[ring];
+    // If the next entry was just sent a command, we give the turn to the one
+    // after it.
+    for (unsigned tries = std::min(r->size, 2u); tries; --tries)
+    {
+        Entry *e = r->next;
+        r->next = e->next;
+        if (now - e->lastRefresh >= MIN_REFRESH_NSEC)
+        {
+            return e;
+        }
+    }
+    // We do not want to send another packet to the same locomotive too
+    // quick.
+    return nullptr;
+}
+
+void PriorityUpdateLoop::CommandQueue::push(Command *c)
+{
+    c->next = nullptr;
+    c->prev = tail_;
+    if (tail_)
+    {
+        tail_->next = c;
+    }
+    else
+    {
+        head_ = c;
+    }
+    tail_ = c;
+}
+
+PriorityUpdateLoop::Command *PriorityUpdateLoop::CommandQueue::pop()
+{
+    HASSERT(head_);
+    Command *c = head_;
+    remove(c);
+    return c;
+}
+
+void PriorityUpdateLoop::CommandQueue::remove(Command *c)
+{
+    if (c->prev)
+    {
+        c->prev->next = c->next;
+    }
+    else
+    {
+        head_ = c->next;
+    }
+    if (c->next)
+    {
+        c->next->prev = c->prev;
+    }
+    else
+    {
+        tail_ = c->prev;
+    }
+}
+
+} // namespace dcc
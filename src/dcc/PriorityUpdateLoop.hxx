@@ -0,0 +1,298 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file PriorityUpdateLoop.hxx
+ *
+ * Control flow central to the command station: it sends user-requested
+ * changes to the track with priority, and refreshes the state of the
+ * individual trains in the remaining packet slots.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _DCC_PRIORITYUPDATELOOP_HXX_
+#define _DCC_PRIORITYUPDATELOOP_HXX_
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "dcc/UpdateLoop.hxx"
+#include "executor/StateFlow.hxx"
+#include "os/OS.hxx"
+
+namespace dcc
+{
+
+/// Implementation of a command station update loop with prioritization. Each
+/// outgoing packet slot is assigned in the following order:
+///
+/// - urgent commands (emergency stop) that were notified via notify_update;
+///
+/// - other commands (speed and function changes) that were notified via
+///   notify_update. Each such command is sent UPDATE_REPEATS times, but a
+///   refresh slot is inserted after every MAX_UPDATES_IN_A_ROW update slots,
+///   so that the background refresh does not starve under a flood of
+///   commands;
+///
+/// - background refresh. The refresh sources are kept in two rings: moving
+///   trains and stopped trains (including non-train sources). The moving ring
+///   gets MOVING_SHARE slots for each slot of the stopped ring. A source is
+///   moved between the rings when it is refreshed or updated.
+///
+/// Exclusive sources (priority of at least EXCLUSIVE_MIN_PRIORITY) take all
+/// packet slots while they are registered, the highest priority first.
+///
+/// The refresh rings and the command queues are intrusive doubly linked lists
+/// running through the entries of the sources. Adding, removing and moving a
+/// source, and queuing, coalescing and purging its commands take constant
+/// time; filling a packet slot and notify_update() do not allocate. The packet
+/// sources are called without holding the lock of the
+/// command queues, so notify_update() never waits for them. Removing a refresh
+/// source waits until the loop has finished calling the sources; it must not
+/// be called from the packet source's own callbacks.
+///
+/// Usage is the same as @ref SimpleUpdateLoop.
+class PriorityUpdateLoop : public StateFlow<Buffer<dcc::Packet>, QList<1>>,
+                           private UpdateLoopBase
+{
+public:
+    /// How many times each notified command is sent to the track.
+    static constexpr unsigned UPDATE_REPEATS = 2;
+    /// How many update packets may be sent before a refresh slot is given.
+    static constexpr unsigned MAX_UPDATES_IN_A_ROW = 4;
+    /// How many slots the moving trains get for each slot of the stopped
+    /// trains.
+    static constexpr unsigned MOVING_SHARE = 3;
+    /// Minimum time between two refresh packets to the same source.
+    static constexpr long long MIN_REFRESH_NSEC = MSEC_TO_NSEC(5);
+    /// How many different (non-urgent) update codes a source may have queued
+    /// at the same time. Further codes are dropped; the background refresh
+    /// sends them later.
+    static constexpr unsigned MAX_CODES_PER_SOURCE = 8;
+
+    /// Constructor.
+    /// @param service defines the executor to run on.
+    /// @param track_send is where to send the packets filled in.
+    PriorityUpdateLoop(Service *service, PacketFlowInterface *track_send);
+    ~PriorityUpdateLoop();
+
+    bool add_refresh_source(
+        dcc::PacketSource *source, unsigned priority) override;
+
+    void remove_refresh_source(dcc::PacketSource *source) override;
+
+    void notify_update(PacketSource *source, unsigned code) override;
+
+    // Entry to the state flow -- when a new packet needs to be sent.
+    Action entry() override;
+
+protected:
+    /// @return the current time in nsec. Overridden by the simulator in the
+    /// unit tests.
+    virtual long long get_time()
+    {
+        return os_get_time_monotonic();
+    }
+
+private:
+    /// Which ring an entry is in.
+    enum RingId
+    {
+        RING_STOPPED = 0,
+        RING_MOVING = 1,
+        NUM_RINGS
+    };
+
+    /// Index of the command slot in Entry used for the urgent queue.
+    static constexpr unsigned URGENT_SLOT = MAX_CODES_PER_SOURCE;
+    static_assert(URGENT_SLOT < 16, "pending bits do not fit");
+
+    struct Entry;
+
+    /// A notified command waiting for a packet slot. Lives in the entry of
+    /// its source, and is linked into one of the command queues.
+    struct Command
+    {
+        /// Entry of the source this command is for.
+        Entry *entry;
+        /// Neighbors in the command queue.
+        Command *prev;
+        Command *next;
+        /// Code to pass to get_next_packet.
+        uint8_t code;
+        /// How many more times to send this command.
+        uint8_t repeats;
+    };
+
+    /// What we know about a registered (non-exclusive) refresh source.
+    struct Entry
+    {
+        dcc::PacketSource *source;
+        /// Neighbors in the refresh ring.
+        Entry *prev;
+        Entry *next;
+        /// Which ring the source is in, one of RingId.
+        unsigned ring : 1;
+        /// Bit i is set if commands[i] is in a command queue.
+        uint16_t pending;
+        /// When the last refresh packet was sent.
+        long long lastRefresh;
+        /// Storage for the queued commands. commands[URGENT_SLOT] is for the
+        /// urgent queue, the others for the update queue.
+        Command commands[URGENT_SLOT + 1];
+    };
+
+    /// FIFO of commands, linked through the commands. Must be accessed with
+    /// the lock held.
+    class CommandQueue
+    {
+    public:
+        /// @return true if there are no commands queued.
+        bool empty()
+        {
+            return head_ == nullptr;
+        }
+
+        /// Appends a command at the end.
+        /// @param c the command to append. Must not be in a queue.
+        void push(Command *c);
+
+        /// Removes the first command. The queue must not be empty.
+        /// @return the removed command.
+        Command *pop();
+
+        /// Removes a command from the queue, keeping the order of the rest.
+        /// @param c a command in this queue.
+        void remove(Command *c);
+
+    private:
+        /// First command, or nullptr if empty.
+        Command *head_{nullptr};
+        /// Last command, or nullptr if empty.
+        Command *tail_{nullptr};
+    };
+
+    /// One round-robin ring of refresh sources, linked through the entries.
+    struct Ring
+    {
+        /// The next entry to refresh, or nullptr if the ring is empty.
+        Entry *next = nullptr;
+        /// Number of entries in the ring.
+        unsigned size = 0;
+    };
+
+    /// An exclusive source.
+    struct Exclusive
+    {
+        dcc::PacketSource *source;
+        unsigned priority;
+    };
+
+    /// Adds an entry to a ring, before its next entry, so that the new entry
+    /// is refreshed last in the current round. Must be called with the lock
+    /// held.
+    /// @param e the entry to add.
+    /// @param ring RingId to add to.
+    void ring_add(Entry *e, unsigned ring);
+
+    /// Removes an entry from its ring, keeping the order of the others. If
+    /// the entry was the next one to refresh, the one after it becomes the
+    /// next. Must be called with the lock held.
+    /// @param e the entry to remove.
+    void ring_remove(Entry *e);
+
+    /// Puts an entry to the ring that matches the train's speed. Must be
+    /// called with the lock held.
+    /// @param e the entry to classify.
+    /// @param moving true if the train is moving.
+    void classify(Entry *e, bool moving);
+
+    /// Adds a command to the urgent queue (for ESTOP) or the update queue, or
+    /// if the same command is already waiting, restarts its repeat count.
+    /// Must be called with the lock held.
+    /// @param e the entry to send the command for.
+    /// @param code the command code.
+    void enqueue(Entry *e, unsigned code);
+
+    /// Removes all queued commands of an entry. Must be called with the lock
+    /// held.
+    /// @param e the entry whose commands to remove.
+    void purge(Entry *e);
+
+    /// Takes the next command from a queue. Must be called with the lock
+    /// held.
+    /// @param q non-empty queue.
+    /// @param code will be set to the command code.
+    /// @return the entry to send the command to.
+    Entry *take_command(CommandQueue *q, unsigned *code);
+
+    /// Chooses the source for a background refresh slot. Must be called with
+    /// the lock held.
+    /// @param now current time.
+    /// @param code will be set to the code to send.
+    /// @return the entry to send a packet to, or nullptr if an idle packet
+    /// should be sent.
+    Entry *take_refresh(long long now, unsigned *code);
+
+    /// Picks the next entry from a ring that can be refreshed now.
+    /// @param ring RingId to pick from.
+    /// @param now current time.
+    /// @return nullptr if there is no entry which is due for refresh.
+    Entry *pick(unsigned ring, long long now);
+
+    /// Place where we forward the packets filled in.
+    PacketFlowInterface *trackSend_;
+
+    /// Protects the sources, the rings and the command queues.
+    OSMutex lock_;
+    /// Held while the loop calls into a packet source, so that the source
+    /// cannot be removed meanwhile. Taken before lock_.
+    OSMutex callLock_;
+
+    /// All registered non-exclusive sources.
+    std::unordered_map<dcc::PacketSource *, Entry> entries_;
+    /// Refresh rings, indexed by RingId.
+    Ring rings_[NUM_RINGS];
+    /// Exclusive sources, in the order of registration.
+    std::vector<Exclusive> exclusive_;
+
+    /// Emergency commands.
+    CommandQueue urgent_;
+    /// Speed and function commands.
+    CommandQueue updates_;
+
+    /// How many update slots we had since the last refresh slot.
+    unsigned updatesInARow_{0};
+    /// How many refresh slots the moving ring had since the stopped ring got
+    /// one.
+    unsigned movingInARow_{0};
+};
+
+} // namespace dcc
+
+#endif // _DCC_PRIORITYUPDATELOOP_HXX_
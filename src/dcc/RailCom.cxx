@@ -34,6 +34,8 @@
 
 #include <string.h>
 
+#include <algorithm>
+
 #include "dcc/RailCom.hxx"
 
 namespace dcc {
@@ -86,20 +88,21 @@ const uint8_t railcom_decode[256] =
 /// for a multi-channel railcom decoder it's as many as the number of ports.
 /// @param railcom_channel 1 or 2 depending on which part of the cutout window
 /// the data is from.
-/// @param ptr raw railcom data read from the UART.
+/// @param dec railcom data read from the UART, already decoded through @ref
+/// railcom_decode.
 /// @param size how many bytes were read from the UART
 /// @param output where to put the decoded packets (or GARBAGE packets if
 /// decoding fails).
 ///
-void parse_internal(uint8_t fb_channel, uint8_t railcom_channel,
-    const uint8_t *ptr, unsigned size,
+static void parse_internal(uint8_t fb_channel, uint8_t railcom_channel,
+    const uint8_t *dec, unsigned size,
     std::vector<struct RailcomPacket> *output)
 {
     if (!size)
         return;
     for (unsigned ofs = 0; ofs < size; ++ofs)
     {
-        uint8_t decoded = railcom_decode[ptr[ofs]];
+        uint8_t decoded = dec[ofs];
         uint8_t type = 0xff;
         uint32_t arg = 0;
         if (decoded == RailcomDefs::ACK)
@@ -150,7 +153,7 @@ void parse_internal(uint8_t fb_channel, uint8_t railcom_channel,
                     // packet) with four NACK bytes, presumably to report that
                     // it is not actually giving back a 32-bit response but
                     // only an 8-bit response.
-                    && railcom_decode[ptr[2]] < 64)
+                    && dec[2] < 64)
                 {
                     len = 6;
                 }
@@ -178,7 +181,7 @@ void parse_internal(uint8_t fb_channel, uint8_t railcom_channel,
         for (int i = 1; i < len; ++i, ++ofs)
         {
             arg <<= 6;
-            uint8_t decoded = railcom_decode[ptr[ofs + 1]];
+            uint8_t decoded = dec[ofs + 1];
             if (decoded >= 64)
             {
                 type = RailcomPacket::GARBAGE;
@@ -189,40 +192,57 @@ void parse_internal(uint8_t fb_channel, uint8_t railcom_channel,
     }
 }
 
-void parse_railcom_data(
+/// Decodes the 4/8 coded bytes of a feedback structure and appends the
+/// railcom packets in it to the output. The bytes of both channels are run
+/// through the decode table exactly once, into a contiguous buffer, which
+/// also takes care of the misaligned window case without copying.
+///
+/// @param fb the feedback to decode.
+/// @param output where to append the decoded packets.
+static void parse_append(
     const dcc::Feedback &fb, std::vector<struct RailcomPacket> *output)
 {
-    output->clear();
     if (fb.channel == 0xff)
         return; // Occupancy feedback information
-    if (fb.ch1Size == 1 && (railcom_decode[fb.ch1Data[0]] != RailcomDefs::INV) && fb.ch2Size >= 1)
+    unsigned ch1_size = std::min<unsigned>(fb.ch1Size, sizeof(fb.ch1Data));
+    unsigned ch2_size = std::min<unsigned>(fb.ch2Size, sizeof(fb.ch2Data));
+    uint8_t dec[sizeof(fb.ch1Data) + sizeof(fb.ch2Data)];
+    for (unsigned i = 0; i < ch1_size; ++i)
+    {
+        dec[i] = railcom_decode[fb.ch1Data[i]];
+    }
+    for (unsigned i = 0; i < ch2_size; ++i)
+    {
+        dec[ch1_size + i] = railcom_decode[fb.ch2Data[i]];
+    }
+    if (ch1_size == 1 && dec[0] != RailcomDefs::INV && ch2_size >= 1)
     {
         // Railcom channel 1 should have 0 or 2 bytes according to the standard.
         //
         // There is probably a mistake in the placement of the second window
         // (i.e., a timing problem in the decoder). Let's concatenate the two
         // channels and parse them together.
-        uint8_t data[8];
-        memcpy(data, fb.ch1Data, fb.ch1Size);
-        memcpy(data + fb.ch1Size, fb.ch2Data, fb.ch2Size);
-        parse_internal(fb.channel, 2, data, fb.ch1Size + fb.ch2Size, output);
+        parse_internal(fb.channel, 2, dec, ch1_size + ch2_size, output);
         return;
     }
-    for (bool ch1 : {true, false})
+    parse_internal(fb.channel, 1, dec, ch1_size, output);
+    parse_internal(fb.channel, 2, dec + ch1_size, ch2_size, output);
+}
+
+void parse_railcom_data(
+    const dcc::Feedback &fb, std::vector<struct RailcomPacket> *output)
+{
+    output->clear();
+    parse_append(fb, output);
+}
+
+void parse_railcom_data(const dcc::Feedback *fb, unsigned count,
+    std::vector<struct RailcomPacket> *output)
+{
+    output->clear();
+    for (unsigned i = 0; i < count; ++i)
     {
-        uint8_t size;
-        const uint8_t *ptr;
-        if (ch1)
-        {
-            size = fb.ch1Size;
-            ptr = fb.ch1Data;
-        }
-        else
-        {
-            size = fb.ch2Size;
-            ptr = fb.ch2Data;
-        }
-        parse_internal(fb.channel, ch1 ? 1 : 2, ptr, size, output);
+        parse_append(fb[i], output);
     }
 }
 
@@ -166,6 +166,19 @@ struct RailcomPacket
 void parse_railcom_data(
     const dcc::Feedback &fb, std::vector<struct RailcomPacket> *output);
 
+/** Interprets the data from an array of railcom feedbacks in one pass, for
+ * example all the outputs of a multi-channel railcom receiver after a cutout.
+ * The result is the same as concatenating the output of parse_railcom_data
+ * called on each feedback in order; the packets can be told apart by their
+ * hw_channel field. Clears the output list before filling with the railcom
+ * data.
+ *
+ * @param fb array of feedback structures.
+ * @param count number of entries in fb.
+ * @param output where to put the decoded packets. */
+void parse_railcom_data(const dcc::Feedback *fb, unsigned count,
+    std::vector<struct RailcomPacket> *output);
+
 }  // namespace dcc
 
 #endif // _DCC_RAILCOM_HXX_
@@ -62,22 +62,28 @@ bool RailcomBroadcastDecoder::process_packet(const dcc::Feedback &packet)
 
 bool RailcomBroadcastDecoder::process_data(const uint8_t *data, unsigned size)
 {
+    uint8_t dec[2];
     for (unsigned i = 0; i < size; ++i)
     {
-        if (railcom_decode[data[i]] == RailcomDefs::INV)
+        uint8_t d = railcom_decode[data[i]];
+        if (d == RailcomDefs::INV)
             return true; // garbage.
+        if (i < sizeof(dec))
+        {
+            dec[i] = d;
+        }
     }
     /// TODO(balazs.racz) if we have only one byte in ch1 but we have a second
     /// byte in ch2, we should still process those because it might be a
     /// misaligned window.
     if (size < 2)
         return true; // Dunno what this is.a
-    uint8_t type = (dcc::railcom_decode[data[0]] >> 2);
+    uint8_t type = (dec[0] >> 2);
     if (size == 2)
     {
-        uint8_t payload = dcc::railcom_decode[data[0]] & 0x3;
+        uint8_t payload = dec[0] & 0x3;
         payload <<= 6;
-        payload |= dcc::railcom_decode[data[1]];
+        payload |= dec[1];
         switch (type)
         {
             case dcc::RMOB_ADRLOW:
@@ -33,6 +33,7 @@
 
 #include "EEPROMEmulation.hxx"
 
+#include <algorithm>
 #include <cstring>
 
 const size_t EEPROMEmulation::HEADER_BLOCK_COUNT = 3;
@@ -115,6 +116,198 @@ void EEPROMEmulation::mount()
         /* turn on shadowing */
         shadowInRam_ = true;
     }
+    else if (INDEX_IN_RAM)
+    {
+        /* slot indexes are stored on 16 bits; rawBlockCount_ is truncated
+         * to 16 bits, so check the value it was computed from */
+        HASSERT(SECTOR_SIZE / BLOCK_SIZE <= 0xFFFF);
+        slotIndex_ = new uint16_t[fblock_count()];
+        build_index();
+    }
+}
+
+/** Fills in the slot index from the journal of the active sector.
+ */
+void EEPROMEmulation::build_index()
+{
+    /* later slots override earlier ones */
+    memset(slotIndex_, 0, fblock_count() * sizeof(uint16_t));
+    for (unsigned block_index = slot_first();
+         block_index < rawBlockCount_ - availableSlots_; ++block_index)
+    {
+        unsigned fblock = *block(activeSector_, block_index) >> 16;
+        if (fblock < fblock_count())
+        {
+            slotIndex_[fblock] = block_index;
+        }
+    }
+}
+
+/** Enables incremental compaction.
+ * @param reserve_slots compaction starts when the active sector has this
+ *        many free slots left
+ * @param blocks_per_step how many blocks of the file compact_step() moves
+ *        over at most
+ */
+void EEPROMEmulation::enable_incremental_compaction(
+    unsigned reserve_slots, unsigned blocks_per_step)
+{
+    OSMutexLock l(&lock_);
+    compactReserve_ = reserve_slots;
+    compactBlocksPerStep_ = blocks_per_step;
+    if (compactReserve_ && compactState_ == COMPACT_IDLE &&
+        availableSlots_ <= compactReserve_)
+    {
+        start_compaction();
+    }
+}
+
+/** Starts an incremental compaction and wakes up the thread blocked in
+ * wait_for_compaction(). Must be called with lock_ held.
+ */
+void EEPROMEmulation::start_compaction()
+{
+    compactState_ = COMPACT_ERASE;
+    if (compactWaiting_)
+    {
+        compactWaiting_ = false;
+        compactWakeup_.post();
+    }
+}
+
+/** Blocks the calling thread until there is incremental compaction work to
+ * do.
+ * @return true if there is work to do, false if stop_compaction_wait() was
+ *         called
+ */
+bool EEPROMEmulation::wait_for_compaction()
+{
+    {
+        OSMutexLock l(&lock_);
+        if (compactStopped_)
+        {
+            return false;
+        }
+        if (compactState_ != COMPACT_IDLE)
+        {
+            return true;
+        }
+        compactWaiting_ = true;
+    }
+    compactWakeup_.wait();
+    OSMutexLock l(&lock_);
+    return !compactStopped_;
+}
+
+/** Wakes up the thread blocked in wait_for_compaction().
+ */
+void EEPROMEmulation::stop_compaction_wait()
+{
+    OSMutexLock l(&lock_);
+    compactStopped_ = true;
+    if (compactWaiting_)
+    {
+        compactWaiting_ = false;
+        compactWakeup_.post();
+    }
+}
+
+/** Performs a bounded amount of background compaction work.
+ * @return true if compaction is in progress and this function should be
+ *         called again
+ */
+bool EEPROMEmulation::compact_step()
+{
+    unsigned sector;
+    {
+        OSMutexLock l(&lock_);
+        if (compactState_ != COMPACT_ERASE)
+        {
+            return compact_step_locked();
+        }
+        /* the new sector is not used by anyone until it is marked dirty, so
+         * writes to the active sector may proceed during the erase */
+        sector = next_active();
+        compactSector_ = sector;
+        compactState_ = COMPACT_ERASING;
+    }
+    flash_erase(sector);
+    eraseDone_.post();
+    OSMutexLock l(&lock_);
+    return compact_step_locked();
+}
+
+/** Performs a bounded amount of background compaction work. Must be called
+ * with lock_ held.
+ * @return true if compaction is in progress
+ */
+bool EEPROMEmulation::compact_step_locked()
+{
+    switch (compactState_)
+    {
+        case COMPACT_IDLE:
+            return false;
+        case COMPACT_ERASE:
+            /* called from a write that ran out of slots; erase while
+             * holding the lock */
+            compactSector_ = next_active();
+            flash_erase(compactSector_);
+            eraseDone_.post();
+            compactState_ = COMPACT_ERASING;
+            // fall through
+        case COMPACT_ERASING:
+        {
+            /* wait for the erase in compact_step() if it is still running;
+             * that thread does not need the lock to finish it */
+            eraseDone_.wait();
+            /* prep the new sector; it is not authoritative until it is
+             * marked intact */
+            uint32_t magic[4] = {MAGIC_DIRTY, 0, 0, 0};
+            flash_program(compactSector_, MAGIC_DIRTY_INDEX, magic, BLOCK_SIZE);
+            compactAvailable_ = slot_count();
+            compactCursor_ = 0;
+            compactState_ = COMPACT_COPY;
+            return true;
+        }
+        case COMPACT_COPY:
+            /* move some of the existing data over */
+            for (unsigned i = 0;
+                 i < compactBlocksPerStep_ && compactCursor_ < fblock_count();
+                 ++i, ++compactCursor_)
+            {
+                uint8_t data[BYTES_PER_BLOCK];
+                if (!read_fblock(compactCursor_, data))
+                {
+                    /* nothing to write, this is the default "erased" value */
+                    continue;
+                }
+                program_slot(compactSector_,
+                    rawBlockCount_ - compactAvailable_, compactCursor_, data);
+                --compactAvailable_;
+            }
+            if (compactCursor_ >= fblock_count())
+            {
+                compactState_ = COMPACT_FINISH;
+            }
+            return true;
+        case COMPACT_FINISH:
+        {
+            /* switch over to the new sector */
+            uint32_t magic[4] = {MAGIC_INTACT, 0, 0, 0};
+            flash_program(compactSector_, MAGIC_INTACT_INDEX, magic, BLOCK_SIZE);
+            magic[0] = MAGIC_USED;
+            flash_program(activeSector_, MAGIC_USED_INDEX, magic, BLOCK_SIZE);
+            activeSector_ = compactSector_;
+            availableSlots_ = compactAvailable_;
+            compactState_ = COMPACT_IDLE;
+            if (slotIndex_)
+            {
+                build_index();
+            }
+            return false;
+        }
+    }
+    return false;
 }
 
 /** Write to the EEPROM.  NOTE!!! This is not necessarily atomic across
@@ -202,18 +395,43 @@ void EEPROMEmulation::write(unsigned int index, const void *buf, size_t len)
  */
 void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
 {
+    if (!availableSlots_ && compactState_ != COMPACT_IDLE)
+    {
+        /* the background compaction did not finish in time; complete it
+         * now */
+        while (compact_step_locked())
+        {
+        }
+    }
     if (availableSlots_)
     {
         /* still have room in this sector for at least one more write */
-        uint32_t slot_data[BLOCK_SIZE / sizeof(uint32_t)];
-        for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
+        if (slotIndex_)
         {
-            slot_data[i] = (index << 16) |
-                           (data[(i * 2) + 1] << 8) |
-                           (data[(i * 2) + 0] << 0);
+            slotIndex_[index] = rawBlockCount_ - availableSlots_;
         }
-        flash_program(activeSector_, rawBlockCount_ - availableSlots_, slot_data, BLOCK_SIZE);
+        program_slot(activeSector_, rawBlockCount_ - availableSlots_, index, data);
         --availableSlots_;
+        if (compactState_ >= COMPACT_COPY && index < compactCursor_)
+        {
+            /* this block was already moved to the new sector */
+            if (compactAvailable_)
+            {
+                program_slot(compactSector_,
+                    rawBlockCount_ - compactAvailable_, index, data);
+                --compactAvailable_;
+            }
+            else
+            {
+                /* no room left; start over with a freshly erased sector */
+                compactState_ = COMPACT_IDLE;
+            }
+        }
+        if (compactReserve_ && compactState_ == COMPACT_IDLE &&
+            availableSlots_ <= compactReserve_)
+        {
+            start_compaction();
+        }
     }
     else
     {
@@ -229,36 +447,27 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
         unsigned available_slots = slot_count();
 
         /* move any existing data over */
-        for (unsigned int fblock = 0; fblock < (file_size() / BYTES_PER_BLOCK); ++fblock)
+        for (unsigned int fblock = 0; fblock < fblock_count(); ++fblock)
         {
-            uint32_t slot_data[BLOCK_SIZE / sizeof(uint32_t)];
+            uint8_t read_data[BYTES_PER_BLOCK];
+            const uint8_t *slot_data = read_data;
             if (fblock == index) // the new data to be written
             {
-                for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-                {
-                    slot_data[i] = (index << 16) |
-                                   (data[(i * 2) + 1] << 8) |
-                                   (data[(i * 2) + 0] << 0);
-                }
+                slot_data = data;
             }
-            else
+            else if (!read_fblock(fblock, read_data))
             {
-                /* this is old data we need to move over */
-                uint8_t read_data[BYTES_PER_BLOCK];
-                if (!read_fblock(fblock, read_data))
-                {
-                    /* nothing to write, this is the default "erased" value */
-                    continue;
-                }
-                for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-                {
-                    slot_data[i] = (fblock << 16) |
-                                   (read_data[(i * 2) + 1] << 8) |
-                                   (read_data[(i * 2) + 0] << 0);
-                }
+                /* nothing to write, this is the default "erased" value */
+                continue;
             }
             /* commit the write */
-            flash_program(new_sector, rawBlockCount_ - available_slots, slot_data, BLOCK_SIZE);
+            if (slotIndex_)
+            {
+                /* the old slot has already been read above */
+                slotIndex_[fblock] = rawBlockCount_ - available_slots;
+            }
+            program_slot(new_sector, rawBlockCount_ - available_slots, fblock,
+                slot_data);
             --available_slots;
         }
         /* finalize the data move and write */
@@ -271,6 +480,25 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
     }
 }
 
+/** Programs the data of a file block into a slot.
+ * @param sector the sector to write to
+ * @param raw_block the raw block index of the slot within the sector
+ * @param index block within EEPROM address space
+ * @param data data to write, array size must be @ref BYTES_PER_BLOCK large
+ */
+void EEPROMEmulation::program_slot(
+    unsigned sector, unsigned raw_block, unsigned index, const uint8_t data[])
+{
+    uint32_t slot_data[BLOCK_SIZE / sizeof(uint32_t)];
+    for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
+    {
+        slot_data[i] = (index << 16) |
+                       (data[(i * 2) + 1] << 8) |
+                       (data[(i * 2) + 0] << 0);
+    }
+    flash_program(sector, raw_block, slot_data, BLOCK_SIZE);
+}
+
 /** Read from the EEPROM.
  * @param offset within EEPROM address space to start read
  * @param buf location to post read data
@@ -287,6 +515,24 @@ void EEPROMEmulation::read(unsigned int offset, void *buf, size_t len)
     }
 
     uint8_t *byte_data = (uint8_t *)buf;
+
+    if (slotIndex_)
+    {
+        /* one indexed lookup per block */
+        while (len)
+        {
+            uint8_t data[BYTES_PER_BLOCK];
+            unsigned lsa = offset & (BYTES_PER_BLOCK - 1);
+            size_t copylen = std::min(len, BYTES_PER_BLOCK - lsa);
+            read_fblock(offset / BYTES_PER_BLOCK, data);
+            memcpy(byte_data, data + lsa, copylen);
+            offset += copylen;
+            byte_data += copylen;
+            len -= copylen;
+        }
+        return;
+    }
+
     memset(byte_data, 0xff, len); // default if data not found
 
     for (unsigned block_index = slot_first();
@@ -306,11 +552,7 @@ void EEPROMEmulation::read(unsigned int offset, void *buf, size_t len)
         }
         // Reads the block
         uint8_t data[BYTES_PER_BLOCK];
-        for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-        {
-            data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
-            data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
-        }
+        decode_slot(address, data);
         // Copies the right part into the output buffer.
         unsigned slotofs, bufofs;
         if (slot_offset < offset)
@@ -352,6 +594,17 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
         }
         return false;
     }
+    else if (slotIndex_)
+    {
+        unsigned raw_block = slotIndex_[index];
+        if (!raw_block)
+        {
+            memset(data, 0xFF, BYTES_PER_BLOCK);
+            return false;
+        }
+        decode_slot(block(activeSector_, raw_block), data);
+        return true;
+    }
     else
     {
         /* default data value if not found */
@@ -366,11 +619,7 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
             if (index == (*address >> 16))
             {
                 /* found the data */
-                for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-                {
-                    data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
-                    data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
-                }
+                decode_slot(address, data);
                 return true;
             }
         }
@@ -378,3 +627,17 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
 
     return false;
 }
+
+/** Decodes the data payload of a slot.
+ * @param address pointer to the slot in flash
+ * @param data location to place the data, array size must be @ref
+ *           BYTES_PER_BLOCK large
+ */
+void EEPROMEmulation::decode_slot(const uint32_t *address, uint8_t data[])
+{
+    for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
+    {
+        data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
+        data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
+    }
+}
@@ -101,6 +101,12 @@ extern const char __eeprom_end;
  *  be allocated in RAM that will be pre-filled with the entire eeprom
  *  data. Dramatically speeds up reads, because reads will not have to go
  *  through the log anymore.
+ *  @param INDEX_IN_RAM: a boolean, if set to true (and SHADOW_IN_RAM is
+ *  false), an index is kept in RAM that stores for every block of the file
+ *  which slot of the active sector holds its latest data. The index is built
+ *  by a single scan of the journal during mount. Reads will not have to go
+ *  through the log anymore, but RAM usage is only 2 bytes per
+ *  BYTES_PER_BLOCK bytes of file instead of file_size.
  *  @param file_size: The total number of bytes held by the emulated eeprom
  *  file. Reads from address 0 .. file_size - 1 will be valid. Must be smaller
  *  than half of one sector, but should be realistically about 35% of the
@@ -128,9 +134,58 @@ extern const char __eeprom_end;
  *
  * The file size is limited to 64k - BLOCK_SIZE because the address is stored
  * on 2 bytes in each block.
+ *
+ * Incremental compaction:
+ *
+ * By default the data is copied to the next sector synchronously inside the
+ * write() call that finds the active sector full. This involves a sector
+ * erase and programming every block of the file, which may take hundreds of
+ * milliseconds. After enable_incremental_compaction() the copying starts
+ * ahead of time, when the active sector has only a few free slots left, and
+ * is performed in small steps by calling compact_step() from a background
+ * thread, for example an @ref EEPROMCompactionThread. The sector state
+ * transitions are the same as in the synchronous case: until the new sector
+ * is marked intact, the old sector stays authoritative and keeps receiving all
+ * writes; writes to blocks that were already moved are also appended to the
+ * new sector. The sector erase is performed without holding the device lock,
+ * so that writes to the active sector can proceed while the new sector is
+ * being erased. (On MCUs that stall all flash accesses during an erase, the
+ * hardware will still delay these writes.)
  */
 class EEPROMEmulation : public EEPROM
 {
+public:
+    /** Enables incremental compaction. After this call compact_step() needs
+     * to be called regularly from a background thread or flow.
+     * @param reserve_slots compaction starts when the active sector has this
+     *        many free slots left. If writes use up these before compaction
+     *        completes, the rest of the compaction is performed synchronously.
+     * @param blocks_per_step how many blocks of the file compact_step() moves
+     *        over at most
+     */
+    void enable_incremental_compaction(
+        unsigned reserve_slots, unsigned blocks_per_step);
+
+    /** Performs a bounded amount of background compaction work: one sector
+     * erase, or programming at most blocks_per_step slots, or the final
+     * switch-over to the new sector.
+     * @return true if compaction is in progress and this function should be
+     *         called again
+     */
+    bool compact_step();
+
+    /** Blocks the calling thread until there is incremental compaction work
+     * to do, i.e. until the next call to compact_step() would return true.
+     * @return true if there is work to do, false if stop_compaction_wait()
+     *         was called
+     */
+    bool wait_for_compaction();
+
+    /** Wakes up the thread blocked in wait_for_compaction(). All current and
+     * future calls to wait_for_compaction() will return false.
+     */
+    void stop_compaction_wait();
+
 protected:
     /** Constructor.
      * @param name device name
@@ -142,6 +197,8 @@ protected:
      */
     ~EEPROMEmulation()
     {
+        delete[] shadow_;
+        delete[] slotIndex_;
     }
 
     /** Mount the EEPROM file.  Should be called during construction of the
@@ -196,6 +253,12 @@ private:
      */
     static const bool SHADOW_IN_RAM;
 
+    /** Keep an index in RAM of which slot holds the latest data of each
+     * block. Speeds up reads at a fraction of the RAM usage of
+     * SHADOW_IN_RAM. Ignored if SHADOW_IN_RAM is set.
+     */
+    static const bool INDEX_IN_RAM;
+
 protected:
     /** magic marker for an intact block */
     static const uint32_t MAGIC_INTACT;
@@ -237,6 +300,42 @@ private:
      */
     bool read_fblock(unsigned int index, uint8_t data[]);
 
+    /** Programs the data of a file block into a slot.
+     * @param sector the sector to write to
+     * @param raw_block the raw block index of the slot within the sector
+     * @param index block within EEPROM address space
+     * @param data data to write, array size must be @ref BYTES_PER_BLOCK
+     *           large
+     */
+    void program_slot(unsigned sector, unsigned raw_block, unsigned index,
+        const uint8_t data[]);
+
+    /** Fills in the slot index from the journal of the active sector. */
+    void build_index();
+
+    /** Performs a bounded amount of background compaction work. Must be
+     * called with lock_ held.
+     * @return true if compaction is in progress
+     */
+    bool compact_step_locked();
+
+    /** Starts an incremental compaction and wakes up the thread blocked in
+     * wait_for_compaction(). Must be called with lock_ held. */
+    void start_compaction();
+
+    /** Decodes the data payload of a slot.
+     * @param address pointer to the slot in flash
+     * @param data location to place the data, array size must be @ref
+     *           BYTES_PER_BLOCK large
+     */
+    static void decode_slot(const uint32_t *address, uint8_t data[]);
+
+    /** @return the number of (possibly partial) blocks in the file. */
+    unsigned fblock_count()
+    {
+        return (file_size() + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
+    }
+
     /** Get the next active sector pointer.
      * @return sector index for the next sector to use.
      */
@@ -324,6 +423,53 @@ protected:
     /** pointer to RAM for shadowing EEPROM. */
     uint8_t *shadow_{nullptr};
 
+    /** For each block of the file, the raw block index of the slot in the
+     * active sector holding its latest data, or 0 if the block was never
+     * written. Only allocated if INDEX_IN_RAM is used. */
+    uint16_t *slotIndex_{nullptr};
+
+    /** States of the incremental compaction. */
+    enum CompactState : uint8_t
+    {
+        COMPACT_IDLE, /**< no compaction in progress */
+        COMPACT_ERASE, /**< next step erases the new sector */
+        COMPACT_ERASING, /**< erase of the new sector is in progress */
+        COMPACT_COPY, /**< copying blocks to the new sector */
+        COMPACT_FINISH, /**< next step marks the new sector active */
+    };
+
+    /** Current state of the incremental compaction. */
+    CompactState compactState_{COMPACT_IDLE};
+
+    /** Sector we are compacting into. */
+    uint8_t compactSector_{0};
+
+    /** Next file block to copy to the new sector. */
+    uint16_t compactCursor_{0};
+
+    /** Number of free slots in the new sector. */
+    uint16_t compactAvailable_{0};
+
+    /** Start compaction when this many slots are left. 0 disables
+     * incremental compaction. */
+    uint16_t compactReserve_{0};
+
+    /** How many file blocks to copy in one compaction step. */
+    uint16_t compactBlocksPerStep_{0};
+
+    /** True if a thread is blocked in wait_for_compaction(). */
+    bool compactWaiting_{false};
+
+    /** True if stop_compaction_wait() was called. */
+    bool compactStopped_{false};
+
+    /** Wakes up the thread blocked in wait_for_compaction(). */
+    OSSem compactWakeup_;
+
+    /** Posted when the erase of the new sector (which runs without holding
+     * lock_) completes. */
+    OSSem eraseDone_;
+
 
     /** Default constructor.
      */
@@ -332,4 +478,56 @@ protected:
     DISALLOW_COPY_AND_ASSIGN(EEPROMEmulation);
 };
 
+/** Background thread that drives the incremental compaction of an
+ * EEPROMEmulation. The thread sleeps until the active sector fills up to the
+ * configured reserve, then performs the compaction steps back to back. It
+ * should run at a lower priority than the threads writing the EEPROM.
+ *
+ * Usage:
+ *
+ *     eeprom.enable_incremental_compaction(64, 16);
+ *     compactionThread.start("eecompact", 0, 1024);
+ */
+class EEPROMCompactionThread : public OSThread
+{
+public:
+    /** Constructor.
+     * @param eeprom the EEPROM to compact, with incremental compaction
+     *        enabled
+     */
+    EEPROMCompactionThread(EEPROMEmulation *eeprom)
+        : eeprom_(eeprom)
+    {
+    }
+
+    /** Stops the thread. Blocks until the thread exited. Has to be called
+     * before the EEPROM is destroyed. */
+    void stop()
+    {
+        eeprom_->stop_compaction_wait();
+        exited_.wait();
+    }
+
+private:
+    /** Thread body. @return nullptr */
+    void *entry() override
+    {
+        while (eeprom_->wait_for_compaction())
+        {
+            while (eeprom_->compact_step())
+            {
+            }
+        }
+        exited_.post();
+        return nullptr;
+    }
+
+    /** EEPROM to compact. */
+    EEPROMEmulation *eeprom_;
+    /** Posted when the thread exits. */
+    OSSem exited_;
+
+    DISALLOW_COPY_AND_ASSIGN(EEPROMCompactionThread);
+};
+
 #endif /* _FREERTOS_DRIVERS_COMMON_EEPROMEMULATION_HXX_ */
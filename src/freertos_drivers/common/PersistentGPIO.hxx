@@ -41,6 +41,12 @@
 
 extern StoredBitSet *g_gpio_stored_bit_set;
 
+/// Gpio that saves its state to g_gpio_stored_bit_set upon every change.
+///
+/// Every change calls lock_and_maybe_flush(). If the bit set has a deferring
+/// flush policy (ShadowedStoredBitSet::set_flush_policy), the board has to
+/// create a StoredBitSetFlusher for it too, otherwise the last change before
+/// the pins go quiet is not written until the next change.
 class PersistentGpio : public Gpio
 {
 public:
@@ -57,19 +63,19 @@ public:
     void write(Value new_state) const OVERRIDE
     {
         impl_->write(new_state);
-        g_gpio_stored_bit_set->set_bit(bit_, new_state).lock_and_flush();
+        g_gpio_stored_bit_set->set_bit(bit_, new_state).lock_and_maybe_flush();
     }
 
     void set() const OVERRIDE
     {
         impl_->set();
-        g_gpio_stored_bit_set->set_bit(bit_, true).lock_and_flush();
+        g_gpio_stored_bit_set->set_bit(bit_, true).lock_and_maybe_flush();
     }
 
     void clr() const OVERRIDE
     {
         impl_->clr();
-        g_gpio_stored_bit_set->set_bit(bit_, false).lock_and_flush();
+        g_gpio_stored_bit_set->set_bit(bit_, false).lock_and_maybe_flush();
     }
 
     Value read() const OVERRIDE
@@ -336,7 +336,8 @@ private:
     /** Write to a file or device.
      * @param file file reference for this device
      * @param buf location to find write data
-     * @param count number of bytes to write
+     * @param count number of bytes to write; must be a multiple of
+     * sizeof(dcc::Packet). As many packets are taken as there is space for.
      * @return number of bytes written upon success, -1 upon failure with errno containing the cause
      */
     ssize_t write(File *file, const void *buf, size_t count) OVERRIDE;
@@ -506,6 +507,9 @@ private:
     FixedQueue<dcc::Packet, HW::Q_SIZE> packetQueue_;
     Notifiable* writableNotifiable_; /**< Notify this when we have free buffers. */
     RailcomDriver* railcomDriver_; /**< Will be notified for railcom cutout events. */
+    /// How many times the interrupt found the queue empty and sent an idle
+    /// packet instead. Read by the DCC_IOC_IDLE_PACKETS ioctl.
+    uint32_t idlePackets_;
 
     /** Default constructor.
      */
@@ -857,6 +861,7 @@ inline void TivaDCC<HW>::interrupt_handler()
         else
         {
             packet = &IDLE_PKT;
+            ++idlePackets_;
             resync = true;
         }
         preamble_count = 0;
@@ -944,6 +949,7 @@ TivaDCC<HW>::TivaDCC(const char *name, RailcomDriver* railcom_driver)
     , usecDelay_(nsec_to_clocks(1000))
     , writableNotifiable_(nullptr)
     , railcomDriver_(railcom_driver)
+    , idlePackets_(0)
 {
     state_ = PREAMBLE;
 
@@ -1053,7 +1059,7 @@ template<class HW>
 __attribute__((optimize("-O3")))
 ssize_t TivaDCC<HW>::write(File *file, const void *buf, size_t count)
 {
-    if (count != sizeof(dcc::Packet))
+    if (count == 0 || (count % sizeof(dcc::Packet)) != 0)
     {
         return -EINVAL;
     }
@@ -1070,31 +1076,42 @@ ssize_t TivaDCC<HW>::write(File *file, const void *buf, size_t count)
         return -ENOSPC;
     }
 
-    dcc::Packet* packet = &packetQueue_.back();
-    memcpy(packet, buf, count);
+    // Takes as many whole packets as there is space for.
+    size_t done = 0;
+    const uint8_t *src = static_cast<const uint8_t *>(buf);
+    while (done < count && !packetQueue_.full())
+    {
+        dcc::Packet *packet = &packetQueue_.back();
+        memcpy(packet, src + done, sizeof(dcc::Packet));
+        done += sizeof(dcc::Packet);
 
-    // Duplicates the marklin packet if it came single.
-    if (packet->packet_header.is_marklin) {
-        if (packet->dlc == 3) {
-            packet->dlc = 6;
-            packet->payload[3] = packet->payload[0];
-            packet->payload[4] = packet->payload[1];
-            packet->payload[5] = packet->payload[2];
-        } else {
-            HASSERT(packet->dlc == 6);
+        // Duplicates the marklin packet if it came single.
+        if (packet->packet_header.is_marklin)
+        {
+            if (packet->dlc == 3)
+            {
+                packet->dlc = 6;
+                packet->payload[3] = packet->payload[0];
+                packet->payload[4] = packet->payload[1];
+                packet->payload[5] = packet->payload[2];
+            }
+            else
+            {
+                HASSERT(packet->dlc == 6);
+            }
         }
-    }
 
-    packetQueue_.increment_back();
-    static uint8_t flip = 0;
-    if (++flip >= 4)
-    {
-        flip = 0;
-        HW::flip_led();
+        packetQueue_.increment_back();
+        static uint8_t flip = 0;
+        if (++flip >= 4)
+        {
+            flip = 0;
+            HW::flip_led();
+        }
     }
 
     MAP_TimerIntEnable(HW::INTERVAL_BASE, TIMER_TIMA_TIMEOUT);
-    return count;
+    return done;
 }
 
 /** Request an ioctl transaction
@@ -1133,6 +1150,11 @@ int TivaDCC<HW>::ioctl(File *file, unsigned long int key, unsigned long data)
         }
         return 0;
     }
+    if (key == DCC_IOC_IDLE_PACKETS) {
+        // A 32-bit read is atomic against the interrupt.
+        *reinterpret_cast<uint32_t*>(data) = idlePackets_;
+        return 0;
+    }
     errno = EINVAL;
     return -1;
 }
@@ -92,6 +92,13 @@ protected:
         MAP_EEPROMProgram(&value, get_address(cell_offset), 4);
     }
 
+    void write_cells(
+        unsigned cell_offset, const eeprom_t *values, unsigned count)
+    {
+        MAP_EEPROMProgram(
+            const_cast<eeprom_t *>(values), get_address(cell_offset), count * 4);
+    }
+
     eeprom_t read_cell(unsigned cell_offset)
     {
         eeprom_t ret;
@@ -0,0 +1,442 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file AsyncFileMemorySpace.cxx
+ *
+ * Memory space backed by a file, where the file operations are performed on
+ * a separate executor.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "openlcb/AsyncFileMemorySpace.hxx"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "utils/ConfigUpdateService.hxx"
+#include "utils/logging.h"
+
+namespace openlcb
+{
+
+AsyncFileMemorySpace::AsyncFileMemorySpace(ExecutorBase *io_executor,
+    const char *name, address_t len, unsigned buffer_size)
+    : ioExecutor_(io_executor)
+    , fileSize_(len)
+    , name_(name)
+    , fd_(-1)
+    , bufferSize_(buffer_size)
+    , readBuf_(new uint8_t[buffer_size])
+    , fetchBuf_(new uint8_t[buffer_size])
+    , writeBuf_(new uint8_t[buffer_size])
+{
+    HASSERT(name_);
+    if (Singleton<ConfigUpdateService>::exists())
+    {
+        Singleton<ConfigUpdateService>::instance()->register_sync_listener(
+            &syncListener_);
+        syncRegistered_ = true;
+    }
+}
+
+AsyncFileMemorySpace::AsyncFileMemorySpace(
+    ExecutorBase *io_executor, int fd, address_t len, unsigned buffer_size)
+    : ioExecutor_(io_executor)
+    , fileSize_(len)
+    , name_(nullptr)
+    , fd_(fd)
+    , bufferSize_(buffer_size)
+    , readBuf_(new uint8_t[buffer_size])
+    , fetchBuf_(new uint8_t[buffer_size])
+    , writeBuf_(new uint8_t[buffer_size])
+{
+    HASSERT(fd_ >= 0);
+    if (Singleton<ConfigUpdateService>::exists())
+    {
+        Singleton<ConfigUpdateService>::instance()->register_sync_listener(
+            &syncListener_);
+        syncRegistered_ = true;
+    }
+}
+
+AsyncFileMemorySpace::~AsyncFileMemorySpace()
+{
+    if (syncRegistered_)
+    {
+        Singleton<ConfigUpdateService>::instance()->unregister_sync_listener(
+            &syncListener_);
+    }
+    flush_sync();
+}
+
+void AsyncFileMemorySpace::ensure_file_open()
+{
+    if (fd_ < 0)
+    {
+        fd_ = open(name_, O_RDWR);
+        if (fd_ < 0)
+        {
+            LOG(WARNING, "Error opening file %s : %s", name_, strerror(errno));
+            return;
+        }
+    }
+    if (fileSize_ == AUTO_LEN)
+    {
+        struct stat buf;
+        HASSERT(fstat(fd_, &buf) >= 0);
+        fileSize_ = buf.st_size;
+    }
+}
+
+size_t AsyncFileMemorySpace::read(address_t source, uint8_t *dst, size_t len,
+    errorcode_t *error, Notifiable *again)
+{
+    ensure_file_open();
+    if (fd_ < 0)
+    {
+        *error = Defs::ERROR_PERMANENT;
+        return 0;
+    }
+    if (source >= fileSize_)
+    {
+        *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+        return 0;
+    }
+    if (source + len > fileSize_)
+    {
+        len = fileSize_ - source;
+    }
+    OSMutexLock h(&lock_);
+    if (readError_ && source == readErrorOffset_)
+    {
+        // The read this caller was waiting for failed.
+        *error = readError_;
+        readError_ = 0;
+        return 0;
+    }
+    if (source >= readOffset_ && source < readOffset_ + readLen_)
+    {
+        size_t count = readOffset_ + readLen_ - source;
+        if (count > len)
+        {
+            count = len;
+        }
+        memcpy(dst, readBuf_.get() + (source - readOffset_), count);
+        address_t next = readOffset_ + readLen_;
+        if (source + count == next && next < fileSize_ &&
+            ioState_ == IO_IDLE)
+        {
+            // Sequential reader got to the end of the buffer. Fetches the
+            // next block while the caller is busy with this one.
+            start_io(IO_READING, next, true);
+        }
+        return count;
+    }
+    if (ioState_ == IO_IDLE)
+    {
+        start_io(IO_READING, source);
+    }
+    add_waiter(again);
+    *error = ERROR_AGAIN;
+    return 0;
+}
+
+size_t AsyncFileMemorySpace::write(address_t destination, const uint8_t *data,
+    size_t len, errorcode_t *error, Notifiable *again)
+{
+    ensure_file_open();
+    if (fd_ < 0)
+    {
+        *error = Defs::ERROR_PERMANENT;
+        return 0;
+    }
+    if (destination >= fileSize_)
+    {
+        *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+        return 0;
+    }
+    if (destination + len > fileSize_)
+    {
+        len = fileSize_ - destination;
+    }
+    OSMutexLock h(&lock_);
+    if (ioState_ == IO_FLUSHING ||
+        (writeLen_ &&
+            (destination != writeOffset_ + writeLen_ ||
+                writeLen_ >= bufferSize_)))
+    {
+        // Cannot append to the write buffer; it has to go out first.
+        if (ioState_ == IO_IDLE)
+        {
+            start_io(IO_FLUSHING);
+        }
+        add_waiter(again);
+        *error = ERROR_AGAIN;
+        return 0;
+    }
+    if (!writeLen_)
+    {
+        writeOffset_ = destination;
+    }
+    size_t count = bufferSize_ - writeLen_;
+    if (count > len)
+    {
+        count = len;
+    }
+    memcpy(writeBuf_.get() + writeLen_, data, count);
+    writeLen_ += count;
+    overlay_dirty_data();
+    return count;
+}
+
+void AsyncFileMemorySpace::flush(Notifiable *done)
+{
+    {
+        OSMutexLock h(&lock_);
+        if (ioState_ == IO_FLUSHING)
+        {
+            // Writes are held back during a flush, so this one will write out
+            // everything.
+            add_waiter(done);
+            return;
+        }
+        else if (ioState_ == IO_READING)
+        {
+            flushWaiters_.push_back(done);
+            return;
+        }
+        else if (writeLen_)
+        {
+            start_io(IO_FLUSHING);
+            add_waiter(done);
+            return;
+        }
+    }
+    done->notify();
+}
+
+MemorySpace::errorcode_t AsyncFileMemorySpace::take_write_error()
+{
+    OSMutexLock h(&lock_);
+    errorcode_t ret = writeError_;
+    writeError_ = 0;
+    return ret;
+}
+
+void AsyncFileMemorySpace::flush_sync()
+{
+    SyncNotifiable n;
+    flush(&n);
+    n.wait_for_notification();
+    // Waits for a possible read-ahead to finish too.
+    {
+        OSMutexLock h(&lock_);
+        if (ioState_ == IO_IDLE)
+        {
+            return;
+        }
+        add_waiter(&n);
+    }
+    n.wait_for_notification();
+}
+
+void AsyncFileMemorySpace::start_io(
+    IoState state, address_t offset, bool read_ahead)
+{
+    HASSERT(ioState_ == IO_IDLE);
+    ioState_ = state;
+    fetchOffset_ = offset;
+    readAhead_ = read_ahead;
+    ioExecutor_->add(&ioRequest_);
+}
+
+void AsyncFileMemorySpace::overlay_dirty_data()
+{
+    address_t begin = std::max(readOffset_, writeOffset_);
+    address_t end =
+        std::min(readOffset_ + readLen_, writeOffset_ + writeLen_);
+    if (begin < end)
+    {
+        memcpy(readBuf_.get() + (begin - readOffset_),
+            writeBuf_.get() + (begin - writeOffset_), end - begin);
+    }
+}
+
+void AsyncFileMemorySpace::run_io()
+{
+    // The buffers used here are not touched by the other threads while the
+    // operation is in progress, so the file I/O runs without the lock.
+    if (ioState_ == IO_READING)
+    {
+        size_t len = bufferSize_;
+        if (fetchOffset_ + len > fileSize_)
+        {
+            len = fileSize_ - fetchOffset_;
+        }
+        ssize_t ret = file_read(fetchOffset_, fetchBuf_.get(), len);
+        OSMutexLock h(&lock_);
+        if (ret <= 0)
+        {
+            if (ret < 0)
+            {
+                LOG(INFO, "Error reading from fd %d: %s", fd_,
+                    strerror(errno));
+            }
+            if (!readAhead_)
+            {
+                // A file shorter than the space also ends up here.
+                readError_ = ret < 0
+                    ? (errorcode_t)Defs::ERROR_PERMANENT
+                    : (errorcode_t)MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+                readErrorOffset_ = fetchOffset_;
+            }
+        }
+        else
+        {
+            std::swap(readBuf_, fetchBuf_);
+            readOffset_ = fetchOffset_;
+            readLen_ = ret;
+            // A caller waiting for a failed read will retry and get its own
+            // error.
+            readError_ = 0;
+            // Writes that came in while we were reading.
+            overlay_dirty_data();
+        }
+    }
+    else
+    {
+        HASSERT(ioState_ == IO_FLUSHING);
+        ssize_t ret = file_write(writeOffset_, writeBuf_.get(), writeLen_);
+        OSMutexLock h(&lock_);
+        if (ret != (ssize_t)writeLen_)
+        {
+            LOG(INFO, "Error writing to fd %d: %s", fd_, strerror(errno));
+            writeError_ = Defs::ERROR_PERMANENT;
+            // The read buffer may hold data that did not make it to the file.
+            readLen_ = 0;
+        }
+        writeLen_ = 0;
+    }
+    std::vector<Notifiable *> done;
+    {
+        OSMutexLock h(&lock_);
+        ioState_ = IO_IDLE;
+        done.swap(waiters_);
+        if (!flushWaiters_.empty())
+        {
+            if (writeLen_)
+            {
+                start_io(IO_FLUSHING);
+                waiters_.swap(flushWaiters_);
+            }
+            else
+            {
+                done.insert(
+                    done.end(), flushWaiters_.begin(), flushWaiters_.end());
+                flushWaiters_.clear();
+            }
+        }
+    }
+    for (Notifiable *n : done)
+    {
+        n->notify();
+    }
+}
+
+ssize_t AsyncFileMemorySpace::file_read(off_t offset, uint8_t *buf, size_t len)
+{
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+    {
+        return -1;
+    }
+    size_t total = 0;
+    while (total < len)
+    {
+        ssize_t ret = ::read(fd_, buf + total, len - total);
+        if (ret < 0)
+        {
+            return -1;
+        }
+        if (ret == 0)
+        {
+            break;
+        }
+        total += ret;
+    }
+    return total;
+}
+
+ssize_t AsyncFileMemorySpace::file_write(
+    off_t offset, const uint8_t *buf, size_t len)
+{
+    if (lseek(fd_, offset, SEEK_SET) != offset)
+    {
+        return -1;
+    }
+    size_t total = 0;
+    while (total < len)
+    {
+        ssize_t ret = ::write(fd_, buf + total, len - total);
+        if (ret <= 0)
+        {
+            return -1;
+        }
+        total += ret;
+    }
+    return total;
+}
+
+ConfigUpdateListener::UpdateAction
+AsyncFileMemorySpace::SyncListener::apply_configuration(
+    int fd, bool initial_load, BarrierNotifiable *done)
+{
+    {
+        OSMutexLock h(&parent_->lock_);
+        // Other components may have written to the file directly.
+        if (parent_->ioState_ != IO_READING)
+        {
+            parent_->readLen_ = 0;
+        }
+    }
+    parent_->flush(done);
+    return UPDATED;
+}
+
+void AsyncFileMemorySpace::SyncListener::factory_reset(int fd)
+{
+    parent_->flush_sync();
+    OSMutexLock h(&parent_->lock_);
+    parent_->readLen_ = 0;
+}
+
+} // namespace openlcb
@@ -0,0 +1,285 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file AsyncFileMemorySpace.hxx
+ *
+ * Memory space backed by a file, where the file operations are performed on
+ * a separate executor.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_ASYNCFILEMEMORYSPACE_HXX_
+#define _OPENLCB_ASYNCFILEMEMORYSPACE_HXX_
+
+#include <memory>
+#include <vector>
+
+#include "executor/Executor.hxx"
+#include "openlcb/MemoryConfig.hxx"
+#include "os/OS.hxx"
+#include "utils/ConfigUpdateListener.hxx"
+
+namespace openlcb
+{
+
+/// Memory space implementation that exports the contents of a file, like @ref
+/// FileMemorySpace, but never blocks the calling executor on file I/O. The
+/// reads and writes of the file are performed on a separate (I/O) executor,
+/// and the memory space returns ERROR_AGAIN to the caller while the
+/// operation is in progress.
+///
+/// Reads are served from a buffer of buffer_size bytes. When a read consumes
+/// the end of the buffer, the next block of the file is fetched in the
+/// background, so that sequential readers (such as a configuration backup)
+/// usually find the data already there.
+///
+/// Writes are collected into a buffer of buffer_size bytes, and are written
+/// to the file when the buffer is full, when a non-contiguous write comes, or
+/// when the configuration update flow runs (e.g. due to an Update Complete
+/// command). Reads through this memory space always see the data written
+/// through it. Errors of the background writes are not reported to the
+/// writers; call take_write_error() after a flush to check them. A failed
+/// read-ahead is ignored, and the data is fetched again when it is actually
+/// read.
+///
+/// Only one file operation is outstanding at any time.
+class AsyncFileMemorySpace : public MemorySpace
+{
+public:
+    static const address_t AUTO_LEN = (address_t)-1;
+
+    /** Creates a memory space based on a file name. Opens the file at the
+     * first use, and never closes it.
+     *
+     * @param io_executor is the executor on which to perform the file
+     * operations. This executor may be blocked for a long time. Must not be
+     * the executor of the callers of this memory space.
+     * @param name is the file name to open. The pointer must stay alive so
+     * long as *this is around.
+     * @param len tells how many bytes there are in the memory space. If
+     * specified as AUTO_LEN, then uses fstat to figure out the size of the
+     * file.
+     * @param buffer_size is the size of the read and the write buffer in
+     * bytes. Three buffers of this size are allocated.
+     */
+    AsyncFileMemorySpace(ExecutorBase *io_executor, const char *name,
+        address_t len = AUTO_LEN, unsigned buffer_size = 1024);
+
+    /** Creates a memory space based on an fd.
+     *
+     * @param io_executor is the executor on which to perform the file
+     * operations. This executor may be blocked for a long time.
+     * @param fd is an open file descriptor with the data.
+     * @param len tells how many bytes there are in the memory space. If
+     * specified as AUTO_LEN, then uses fstat to figure out the size of the
+     * file.
+     * @param buffer_size is the size of the read and the write buffer in
+     * bytes. Three buffers of this size are allocated.
+     */
+    AsyncFileMemorySpace(ExecutorBase *io_executor, int fd,
+        address_t len = AUTO_LEN, unsigned buffer_size = 1024);
+
+    /// Destructor. Synchronously writes out any remaining dirty data.
+    ~AsyncFileMemorySpace();
+
+    bool read_only() override
+    {
+        return false;
+    }
+
+    address_t max_address() override
+    {
+        ensure_file_open();
+        return fileSize_ - 1;
+    }
+
+    size_t write(address_t destination, const uint8_t *data, size_t len,
+        errorcode_t *error, Notifiable *again) override;
+
+    size_t read(address_t source, uint8_t *dst, size_t len, errorcode_t *error,
+        Notifiable *again) override;
+
+    /// Starts writing out the dirty data to the file.
+    /// @param done will be notified when all data written via this space so
+    /// far is in the file.
+    void flush(Notifiable *done);
+
+    /// @return the error of the background writes since the last call, or 0
+    /// if all writes succeeded. Call after flush() has completed. The data of
+    /// the failed writes is lost.
+    errorcode_t take_write_error();
+
+protected:
+    /// Reads from the file. Called on the I/O executor.
+    /// @param offset where to read from in the file.
+    /// @param buf where to put the data.
+    /// @param len how many bytes to read.
+    /// @return number of bytes read, or -1 on error.
+    virtual ssize_t file_read(off_t offset, uint8_t *buf, size_t len);
+
+    /// Writes to the file. Called on the I/O executor.
+    /// @param offset where to write in the file.
+    /// @param buf the data to write.
+    /// @param len how many bytes to write.
+    /// @return number of bytes written, or -1 on error.
+    virtual ssize_t file_write(off_t offset, const uint8_t *buf, size_t len);
+
+private:
+    /// What the I/O executor is doing.
+    enum IoState
+    {
+        IO_IDLE,
+        IO_READING,
+        IO_FLUSHING,
+    };
+
+    /// Runs the current file operation on the I/O executor.
+    class IoRequest : public Executable
+    {
+    public:
+        IoRequest(AsyncFileMemorySpace *parent)
+            : parent_(parent)
+        {
+        }
+
+        void run() override
+        {
+            parent_->run_io();
+        }
+
+    private:
+        AsyncFileMemorySpace *parent_;
+    };
+
+    /// Flushes the write buffer when the config update flow runs, so that the
+    /// update listeners find the new data in the file.
+    class SyncListener : public ConfigUpdateListener
+    {
+    public:
+        SyncListener(AsyncFileMemorySpace *parent)
+            : parent_(parent)
+        {
+        }
+
+        UpdateAction apply_configuration(
+            int fd, bool initial_load, BarrierNotifiable *done) override;
+
+        void factory_reset(int fd) override;
+
+    private:
+        AsyncFileMemorySpace *parent_;
+    };
+
+    /** Makes fd a valid parameter, and ensures fileSize is filled in. */
+    void ensure_file_open();
+
+    /// Starts an I/O operation. Must be called with the lock held and the I/O
+    /// idle.
+    /// @param state is IO_READING or IO_FLUSHING.
+    /// @param offset for reads, the file offset to fetch.
+    /// @param read_ahead true if no caller is waiting for the read, so its
+    /// failure need not be reported.
+    void start_io(IoState state, address_t offset = 0, bool read_ahead = false);
+
+    /// Executes the pending I/O operation. Called on the I/O executor.
+    void run_io();
+
+    /// Adds a notifiable to be called when the current I/O completes. Must
+    /// be called with the lock held.
+    void add_waiter(Notifiable *n)
+    {
+        waiters_.push_back(n);
+    }
+
+    /// Copies the dirty bytes that overlap the read buffer into the read
+    /// buffer. Must be called with the lock held.
+    void overlay_dirty_data();
+
+    /// Writes out the dirty data and waits for all file operations to
+    /// complete. Blocks the calling thread.
+    void flush_sync();
+
+    /// Executor performing the file operations.
+    ExecutorBase *ioExecutor_;
+    /// Helper for scheduling the file operations.
+    IoRequest ioRequest_{this};
+    /// Helper for flushing at the config update sync points.
+    SyncListener syncListener_{this};
+
+    address_t fileSize_;
+    const char *name_;
+    int fd_;
+    /// Size of each buffer.
+    unsigned bufferSize_;
+
+    /// Data for reads.
+    std::unique_ptr<uint8_t[]> readBuf_;
+    /// The I/O executor reads into this buffer; swapped with readBuf_ when
+    /// the read completes.
+    std::unique_ptr<uint8_t[]> fetchBuf_;
+    /// File offset of readBuf_[0].
+    address_t readOffset_{0};
+    /// Number of valid bytes in readBuf_.
+    unsigned readLen_{0};
+    /// File offset that is being read into fetchBuf_.
+    address_t fetchOffset_{0};
+    /// Number of bytes successfully read into fetchBuf_.
+    unsigned fetchLen_{0};
+
+    /// Dirty data to be written to the file.
+    std::unique_ptr<uint8_t[]> writeBuf_;
+    /// File offset of writeBuf_[0].
+    address_t writeOffset_{0};
+    /// Number of dirty bytes in writeBuf_.
+    unsigned writeLen_{0};
+
+    /// Protects the buffer state and the waiter lists. The file operations
+    /// run without holding it.
+    OSMutex lock_;
+    /// What the I/O executor is doing now.
+    IoState ioState_{IO_IDLE};
+    /// True if the current read was started as a read-ahead.
+    bool readAhead_{false};
+    /// Error of a failed read, to be reported to the caller that reads from
+    /// readErrorOffset_.
+    errorcode_t readError_{0};
+    /// File offset of the failed read.
+    address_t readErrorOffset_{0};
+    /// Error of a background write, to be reported by take_write_error().
+    errorcode_t writeError_{0};
+    /// Notifiables to call when the current I/O operation completes.
+    std::vector<Notifiable *> waiters_;
+    /// Notifiables to call when a flush requested during a read completes.
+    std::vector<Notifiable *> flushWaiters_;
+    /// True if syncListener_ is registered with the config update service.
+    bool syncRegistered_{false};
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_ASYNCFILEMEMORYSPACE_HXX_
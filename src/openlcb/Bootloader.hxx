@@ -91,6 +91,8 @@ struct BootloaderState
     unsigned datagram_output_pending : 1;
     // 1 if we are waiting for an incoming reply to a sent datagram
     unsigned datagram_reply_waiting : 1;
+    // Which write buffer is collecting the incoming data.
+    unsigned write_buffer_cur : 1;
 
     NodeAlias alias;
     InitState init_state;
@@ -118,6 +120,12 @@ struct BootloaderState
     uintptr_t write_buffer_offset;
     // Offset inside the write buffer for the next incoming data.
     unsigned write_buffer_index;
+
+    // Flash address where the previous (full) write buffer needs to go.
+    uintptr_t flush_offset;
+    // Number of bytes in the previous write buffer that are not yet written
+    // to flash. Zero if there is no flash write pending.
+    unsigned flush_length;
 };
 
 /// Global state variables.
@@ -138,9 +146,20 @@ BootloaderState state_;
 /// is no need to make this bigger than a datagram.
 #define WRITE_BUFFER_SIZE 64
 #endif
-/// Write buffer; the OpenLCB protocol engine collects the incoming bytes into
-/// this buffer and repeatedly flushes to flash.
-uint8_t g_write_buffer[WRITE_BUFFER_SIZE];
+#ifndef WRITE_BUFFER_COUNT
+/// How many write buffers the bootloader should use, 1 or 2. With 2 buffers
+/// the received data is acknowledged (stream proceed or datagram OK) before
+/// the slow erase/program operation, so the flash write overlaps with the
+/// transfer of the next chunk. This costs another WRITE_BUFFER_SIZE bytes of
+/// RAM.
+#define WRITE_BUFFER_COUNT 1
+#endif
+static_assert(WRITE_BUFFER_COUNT == 1 || WRITE_BUFFER_COUNT == 2,
+    "WRITE_BUFFER_COUNT must be 1 or 2");
+/// Write buffers; the OpenLCB protocol engine collects the incoming bytes into
+/// one of these buffers, while the other one (if any) is being written to
+/// flash.
+uint8_t g_write_buffer[WRITE_BUFFER_COUNT][WRITE_BUFFER_SIZE];
 
 /// Which OpenLCB Memory Config Space number should the bootloader export.
 #define FLASH_SPACE (MemoryConfigDefs::SPACE_FIRMWARE)
@@ -298,10 +317,22 @@ void add_memory_config_error_response(uint16_t error_code)
     state_.datagram_payload[state_.datagram_dlc++] = error_code & 0xff;
 }
 
+/// @return the write buffer that is collecting the incoming data.
+uint8_t *write_buffer()
+{
+    return g_write_buffer[state_.write_buffer_cur];
+}
+
+/// @return the write buffer that is waiting to be written to flash.
+uint8_t *flush_buffer()
+{
+    return g_write_buffer[WRITE_BUFFER_COUNT - 1 - state_.write_buffer_cur];
+}
+
 /// Clears out the flash write buffer with all 0xFF values.
 void init_flash_write_buffer()
 {
-    memset(g_write_buffer, 0xff, WRITE_BUFFER_SIZE);
+    memset(write_buffer(), 0xff, WRITE_BUFFER_SIZE);
 }
 
 /// Translates from the logical address space of the OpenLCB memory config
@@ -327,12 +358,15 @@ bool normalize_write_buffer_offset()
     return true;
 }
 
-/// Writes the flash write buffer into flash, and clears it out for continuing
-/// the bootloading process. This call usually takes quite a few milliseconds.
-void flush_flash_buffer()
+/// Writes the previously filled write buffer into flash, if there is a pending
+/// write. This call usually takes quite a few milliseconds.
+void finish_flash_write()
 {
-    const void *address =
-        reinterpret_cast<const void *>(state_.write_buffer_offset);
+    if (!state_.flush_length)
+    {
+        return;
+    }
+    const void *address = reinterpret_cast<const void *>(state_.flush_offset);
     const void *page_start = nullptr;
     uint32_t page_length_bytes = 0;
     get_flash_page_info(address, &page_start, &page_length_bytes);
@@ -341,8 +375,26 @@ void flush_flash_buffer()
         // Beginning of a page -- let's do an erase.
         erase_flash_page(address);
     }
-    write_flash((const void *)state_.write_buffer_offset, g_write_buffer,
-        state_.write_buffer_index);
+    write_flash(address, flush_buffer(), state_.flush_length);
+    state_.flush_length = 0;
+}
+
+/// Hands off the flash write buffer to be written into flash, and clears out
+/// a buffer for continuing the bootloading process. With two write buffers
+/// the actual flash write happens in finish_flash_write(), called from the
+/// main loop once the response to the current message is sent out.
+void flush_flash_buffer()
+{
+    // There is only one buffer that can be pending.
+    finish_flash_write();
+    state_.flush_offset = state_.write_buffer_offset;
+    state_.flush_length = state_.write_buffer_index;
+#if WRITE_BUFFER_COUNT > 1
+    state_.write_buffer_cur ^= 1;
+#else
+    // The only buffer has to be written before it can be reused.
+    finish_flash_write();
+#endif
     state_.write_buffer_offset += state_.write_buffer_index;
     state_.write_buffer_index = 0;
     init_flash_write_buffer();
@@ -368,6 +420,7 @@ void handle_memory_config_frame()
         }
         case MemoryConfigDefs::COMMAND_ENTER_BOOTLOADER:
         {
+            finish_flash_write();
             // Poor man's reset. Clears the entire state machine, which will
             // cause us to run the boot sequence again.
             memset(&state_, 0, sizeof(state_));
@@ -383,6 +436,7 @@ void handle_memory_config_frame()
                 set_error_code(DatagramDefs::INVALID_ARGUMENTS);
                 return;
             }
+            finish_flash_write();
             uint16_t r = flash_complete();
             if (r != 0) {
                 // Invalid request.
@@ -443,7 +497,7 @@ void handle_memory_config_frame()
             state_.write_src_alias =
                 CanDefs::get_src(GET_CAN_FRAME_ID_EFF(state_.input_frame));
 
-            g_write_buffer[0] = state_.input_frame.data[7];
+            write_buffer()[0] = state_.input_frame.data[7];
             state_.write_buffer_index = 1;
 
             if (CanDefs::get_can_frame_type(GET_CAN_FRAME_ID_EFF(
@@ -698,7 +752,7 @@ void handle_stream_data()
         return;
     }
     state_.input_frame_full = 0;
-    memcpy(&g_write_buffer[state_.write_buffer_index],
+    memcpy(&write_buffer()[state_.write_buffer_index],
         &state_.input_frame.data[1], len);
     state_.write_buffer_index += len;
     state_.stream_buffer_remaining -= len;
@@ -843,7 +897,7 @@ void handle_input_frame()
             set_error_code(DatagramDefs::OUT_OF_ORDER);
             return;
         }
-        memcpy(g_write_buffer + state_.write_buffer_index,
+        memcpy(write_buffer() + state_.write_buffer_index,
             state_.input_frame.data, state_.input_frame.can_dlc);
         state_.write_buffer_index += state_.input_frame.can_dlc;
 
@@ -1054,7 +1108,7 @@ bool bootloader_loop()
         }
         unsigned new_busy =
             (state_.input_frame_full || state_.output_frame_full ||
-                state_.init_state != INITIALIZED ||
+                state_.init_state != INITIALIZED || state_.flush_length ||
                 (state_.datagram_output_pending
                     /*&& !state_.datagram_reply_waiting*/))
             ? 1
@@ -1101,6 +1155,12 @@ bool bootloader_loop()
     {
         handle_send_datagram();
     }
+    if (state_.flush_length && !state_.output_frame_full)
+    {
+        // The acknowledgement for the data is out, so the sender is already
+        // working on the next chunk while we are busy writing flash.
+        finish_flash_write();
+    }
     return false;
 }
 
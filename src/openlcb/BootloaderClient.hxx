@@ -74,6 +74,12 @@ struct BootloaderRequest
     uint8_t skip_pip{0};
     /// Offset at which to start writing.
     uint32_t offset{0};
+    /// How many write datagrams may be outstanding at the same time when
+    /// using datagrams. The datagram clients serialize the datagrams on the
+    /// wire, but the next datagram is queued up and goes out as soon as the
+    /// previous one is acknowledged. Capped at
+    /// BootloaderClient::MAX_PENDING_WRITES.
+    uint8_t max_pending_writes{2};
     /// Payload to write.
     string data;
     /// If set, will be called with floats [0.0, 1.0] as the download is
@@ -102,6 +108,9 @@ int g_bootloader_timeout_sec = 3;
 class BootloaderClient : public StateFlow<Buffer<BootloaderRequest>, QList<1>>
 {
 public:
+    /// Upper limit on how many write datagrams we keep in flight.
+    static constexpr unsigned MAX_PENDING_WRITES = 2;
+
     BootloaderClient(
         Node *node, DatagramService *if_datagram_service, IfCan *if_can)
         : StateFlow<Buffer<BootloaderRequest>, QList<1>>(node->iface())
@@ -109,6 +118,10 @@ public:
         , datagramService_(if_datagram_service)
         , ifCan_(if_can)
     {
+        for (auto &w : pendingWrites_)
+        {
+            w.parent_ = this;
+        }
     }
 
     Action entry() override
@@ -642,68 +655,153 @@ private:
         }
     }
 
+    class PendingWrite;
+
     Action bootload_using_datagrams()
     {
-        // dgClient_ is active currently.
+        // The write datagrams allocate their own clients.
+        datagramService_->client_allocator()->typed_insert(dgClient_);
+        dgClient_ = nullptr;
         bufferOffset_ = 0;
+        bytesAcked_ = 0;
+        writesPending_ = 0;
+        writeError_ = 0;
+        waitingForWrite_ = false;
         return call_immediately(STATE(next_dg_write_datagram));
     }
 
     Action next_dg_write_datagram()
     {
+        unsigned window = request()->max_pending_writes;
+        if (window > MAX_PENDING_WRITES)
+        {
+            window = MAX_PENDING_WRITES;
+        }
+        else if (!window)
+        {
+            window = 1;
+        }
+        if (writeError_ || bufferOffset_ >= request()->data.size())
+        {
+            if (writesPending_)
+            {
+                // Waits for the outstanding writes to complete.
+                waitingForWrite_ = true;
+                return wait();
+            }
+            return call_immediately(STATE(dg_writes_done));
+        }
+        if (writesPending_ >= window)
+        {
+            waitingForWrite_ = true;
+            return wait();
+        }
+        return allocate_and_call(
+            STATE(send_dg_write), datagramService_->client_allocator());
+    }
+
+    Action send_dg_write()
+    {
+        DatagramClient *client =
+            full_allocation_result(datagramService_->client_allocator());
+        PendingWrite *slot = nullptr;
+        for (auto &w : pendingWrites_)
+        {
+            if (!w.client_)
+            {
+                slot = &w;
+                break;
+            }
+        }
+        HASSERT(slot);
+        unsigned len = request()->data.size() - bufferOffset_;
+        if (len > 64)
+        {
+            len = 64;
+        }
+        slot->client_ = client;
+        slot->length_ = len;
+        ++writesPending_;
+
         Buffer<GenMessage> *b;
         mainBufferPool->alloc(&b);
-        DatagramPayload payload = MemoryConfigDefs::write_datagram(message()->data()->memory_space, message()->data()->offset + bufferOffset_);
-        unsigned len = message()->data()->data.size() - bufferOffset_;
-        if (len > 64) len = 64;
-        payload.append(&message()->data()->data[bufferOffset_], len);
-        b->set_done(n_.reset(this));
+        DatagramPayload payload = MemoryConfigDefs::write_datagram(
+            request()->memory_space, request()->offset + bufferOffset_);
+        payload.append(&request()->data[bufferOffset_], len);
+        bufferOffset_ += len;
+        b->set_done(slot->bn_.reset(slot));
         b->data()->reset(Defs::MTI_DATAGRAM, node_->node_id(),
             message()->data()->dst, payload);
-        dgClient_->write_datagram(b);
-
-        responseDatagram_ = nullptr;
-        sleeping_ = false;
-        /// @TODO (balazs.racz) we have to expect write response datagrams too.
-        return wait_and_call(STATE(dg_write_request_sent));
+        client->write_datagram(b);
+        return call_immediately(STATE(next_dg_write_datagram));
     }
 
-    Action dg_write_request_sent()
+    /// Called on the executor when a write datagram is acknowledged (or
+    /// failed).
+    /// @param w the slot of the completed write.
+    void dg_write_complete(PendingWrite *w)
     {
-        uint32_t dg_result =
-            dgClient_->result() & DatagramClient::RESPONSE_CODE_MASK;
-        if (dg_result != DatagramClient::OPERATION_SUCCESS) {
-            datagramService_->client_allocator()->typed_insert(dgClient_);
-            return return_error(dg_result, "Write rejected.");
+        uint32_t result = w->client_->result();
+        datagramService_->client_allocator()->typed_insert(w->client_);
+        w->client_ = nullptr;
+        --writesPending_;
+        uint32_t dg_result = result & DatagramClient::RESPONSE_CODE_MASK;
+        if (dg_result != DatagramClient::OPERATION_SUCCESS)
+        {
+            if (!writeError_)
+            {
+                writeError_ = dg_result ? dg_result
+                                        : (uint32_t)Defs::ERROR_PERMANENT;
+            }
         }
-
-        if (dgClient_->result() & DatagramClient::OK_REPLY_PENDING) {
-            DIE("Write datagram results with reply pending not supported for "
-                "bootloader yet.");
+        else
+        {
+            if (result & DatagramClient::OK_REPLY_PENDING)
+            {
+                DIE("Write datagram results with reply pending not supported "
+                    "for bootloader yet.");
+            }
+            report_dg_progress(w->length_);
         }
+        if (waitingForWrite_)
+        {
+            waitingForWrite_ = false;
+            notify();
+        }
+    }
 
-        unsigned len = message()->data()->data.size() - bufferOffset_;
-        if (len > 64) len = 64;
-        bufferOffset_ += len;
-
-        if ((bufferOffset_ & ~0xFF) != ((bufferOffset_ - len) & ~0xFF)) {
-            speedAvg_.add_absolute(bufferOffset_);
+    /// Updates the speed measurement and calls the progress callback.
+    /// @param len how many more bytes were acknowledged by the target.
+    void report_dg_progress(unsigned len)
+    {
+        bytesAcked_ += len;
+        if ((bytesAcked_ & ~0xFF) != ((bytesAcked_ - len) & ~0xFF))
+        {
+            speedAvg_.add_absolute(bytesAcked_);
             LOG(INFO, "write offset: %" PRIdPTR "; speed=%.0f bytes/sec",
-                bufferOffset_, speedAvg_.avg());
+                bytesAcked_, speedAvg_.avg());
             if (request()->progress_callback)
             {
-                float ofs = bufferOffset_;
+                float ofs = bytesAcked_;
                 ofs /= request()->data.size();
                 request()->progress_callback(ofs);
             }
         }
+    }
 
-        if (bufferOffset_ < message()->data()->data.size()) {
-            return call_immediately(STATE(next_dg_write_datagram));
+    Action dg_writes_done()
+    {
+        if (writeError_)
+        {
+            return return_error(writeError_, "Write rejected.");
         }
-        if (message()->data()->request_reboot_after) {
-            return call_immediately(STATE(reboot_with_dg_client));
-        } else {
+        if (message()->data()->request_reboot_after)
+        {
+            return allocate_and_call(
+                STATE(reboot_dg_client), datagramService_->client_allocator());
+        }
+        else
+        {
             return return_error(0, "Remote node left in bootloader.");
         }
     }
@@ -766,6 +864,25 @@ private:
     }
 
 private:
+    /// Book-keeping for one write datagram in flight.
+    class PendingWrite : public Notifiable
+    {
+    public:
+        /// Called when the datagram client is done with the datagram.
+        void notify() override
+        {
+            parent_->dg_write_complete(this);
+        }
+
+        BootloaderClient *parent_{nullptr};
+        /// Datagram client sending this write; nullptr if the slot is free.
+        DatagramClient *client_{nullptr};
+        /// Number of payload bytes in the write.
+        unsigned length_{0};
+        /// Done notifiable of the datagram buffer.
+        BarrierNotifiable bn_;
+    };
+
     Node *node_;
     DatagramService *datagramService_;
     IfCan *ifCan_;
@@ -785,6 +902,16 @@ private:
     uint32_t availableBufferSize_;
     // The next byte we need to send from the input data.
     size_t bufferOffset_;
+    // How many bytes were acknowledged by the target in datagram mode.
+    size_t bytesAcked_;
+    // Slots for the write datagrams in flight.
+    PendingWrite pendingWrites_[MAX_PENDING_WRITES];
+    // Number of write datagrams in flight.
+    unsigned writesPending_{0};
+    // First error code returned for a write datagram.
+    uint32_t writeError_{0};
+    // True if the flow is waiting for a write datagram to complete.
+    bool waitingForWrite_{false};
 
     Ewma speedAvg_;
     // The Average speed (ewma) in bytes/second.
@@ -36,6 +36,7 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include "utils/ConfigUpdateService.hxx"
 #include "utils/logging.h"
 #include "utils/FdUtils.hxx"
 
@@ -44,6 +45,12 @@ namespace openlcb
 
 void ConfigEntryBase::repeated_read(int fd, void *buf, size_t size) const
 {
+    if (Singleton<ConfigUpdateService>::exists() &&
+        Singleton<ConfigUpdateService>::instance()->shadow_read(
+            fd, offset_, buf, size))
+    {
+        return;
+    }
     int ret = lseek(fd, offset_, SEEK_SET);
     ERRNOCHECK("seek_config", ret);
     FdUtils::repeated_read(fd, buf, size);
@@ -54,6 +61,10 @@ void ConfigEntryBase::repeated_write(int fd, const void *buf, size_t size) const
     int ret = lseek(fd, offset_, SEEK_SET);
     ERRNOCHECK("seek_config", ret);
     FdUtils::repeated_write(fd, buf, size);
+    if (Singleton<ConfigUpdateService>::exists())
+    {
+        Singleton<ConfigUpdateService>::instance()->mark_dirty(offset_, size);
+    }
 }
 
 } // namespace openlcb
@@ -35,7 +35,13 @@
  */
 
 #include "openlcb/ConfigUpdateFlow.hxx"
+#include <algorithm>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/FdUtils.hxx"
 
 namespace openlcb
 {
@@ -62,6 +68,10 @@ void ConfigUpdateFlow::init_flow()
 
 void ConfigUpdateFlow::factory_reset()
 {
+    for (auto it = syncListeners_.begin(); it != syncListeners_.end(); ++it)
+    {
+        it->factory_reset(fd_);
+    }
     for (auto it = listeners_.begin(); it != listeners_.end(); ++it) {
         it->factory_reset(fd_);
     }
@@ -108,6 +118,190 @@ void ConfigUpdateFlow::unregister_update_listener(
     nextRefresh_ = listeners_.begin();
 }
 
+void ConfigUpdateFlow::register_sync_listener(ConfigUpdateListener *listener)
+{
+    AtomicHolder h(this);
+    syncListeners_.push_front(listener);
+    // We invalidated the iterator due to the insert.
+    nextSync_ = syncListeners_.begin();
+}
+
+void ConfigUpdateFlow::unregister_sync_listener(ConfigUpdateListener *listener)
+{
+    AtomicHolder h(this);
+    for (auto it = syncListeners_.begin(); it != syncListeners_.end();)
+    {
+        if (it.operator->() == listener)
+        {
+            syncListeners_.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    // We invalidated the iterator due to the erase.
+    nextSync_ = syncListeners_.begin();
+}
+
+void ConfigUpdateFlow::mark_dirty(unsigned offset, size_t len)
+{
+    if (!len)
+    {
+        return;
+    }
+    AtomicHolder h(this);
+    dirty_.add(offset, offset + len);
+    // The data may not be in the file yet (e.g. with a write-behind memory
+    // space), so the shadow is only refreshed by the next update, after the
+    // sync listeners flushed.
+    shadowStale_ = 1;
+}
+
+bool ConfigUpdateFlow::shadow_read(
+    int fd, unsigned offset, void *buf, size_t len)
+{
+    if (fd != fd_ || !shadow_ || offset > shadowSize_ ||
+        len > shadowSize_ - offset)
+    {
+        return false;
+    }
+    AtomicHolder h(this);
+    if (shadowStale_)
+    {
+        return false;
+    }
+    // Copies under the lock, so that refresh_shadow cannot start loading new
+    // data halfway through.
+    memcpy(buf, shadow_.get() + offset, len);
+    return true;
+}
+
+void ConfigUpdateFlow::enable_shadow(size_t size)
+{
+    HASSERT(fd_ >= 0);
+    struct stat buf;
+    HASSERT(fstat(fd_, &buf) >= 0);
+    if ((size_t)buf.st_size < size)
+    {
+        size = buf.st_size;
+    }
+    shadow_.reset(new uint8_t[size]);
+    shadowSize_ = size;
+    load_shadow(0, size);
+}
+
+void ConfigUpdateFlow::refresh_shadow()
+{
+    if (!shadow_)
+    {
+        return;
+    }
+    RangeSet ranges;
+    {
+        AtomicHolder h(this);
+        // The reads go to the file while the shadow is being loaded.
+        shadowStale_ = 1;
+        ranges = updateDirty_;
+    }
+    if (ranges.all())
+    {
+        load_shadow(0, shadowSize_);
+    }
+    else
+    {
+        ranges.for_each([this](unsigned begin, unsigned end) {
+            load_shadow(begin, end);
+        });
+    }
+    AtomicHolder h(this);
+    // Writes that came after this update started are not loaded yet.
+    shadowStale_ = !dirty_.empty();
+}
+
+void ConfigUpdateFlow::load_shadow(unsigned begin, unsigned end)
+{
+    if (!shadow_ || begin >= shadowSize_)
+    {
+        return;
+    }
+    if (end > shadowSize_)
+    {
+        end = shadowSize_;
+    }
+    // pread does not move the file position, which other threads may be
+    // using.
+    FdUtils::repeated_pread(fd_, shadow_.get() + begin, end - begin, begin);
+}
+
+void ConfigUpdateFlow::RangeSet::add(unsigned begin, unsigned end)
+{
+    // Merges all ranges that overlap or touch the new one into it.
+    for (unsigned i = 0; i < count_;)
+    {
+        if (ranges_[i].begin <= end && begin <= ranges_[i].end)
+        {
+            begin = std::min(begin, ranges_[i].begin);
+            end = std::max(end, ranges_[i].end);
+            ranges_[i] = ranges_[--count_];
+            continue;
+        }
+        ++i;
+    }
+    if (count_ == MAX_RANGES)
+    {
+        // Out of space: merges the two closest ranges (which may or may not
+        // include the new one). Since the ranges are disjoint, nothing can be
+        // between the closest two.
+        Range r[MAX_RANGES + 1];
+        std::copy(ranges_, ranges_ + count_, r);
+        r[count_] = {begin, end};
+        unsigned best_i = 0;
+        unsigned best_j = 1;
+        unsigned best_gap = UINT_MAX;
+        for (unsigned i = 0; i <= count_; ++i)
+        {
+            for (unsigned j = i + 1; j <= count_; ++j)
+            {
+                unsigned gap = r[i].end < r[j].begin ? r[j].begin - r[i].end
+                                                     : r[i].begin - r[j].end;
+                if (gap < best_gap)
+                {
+                    best_gap = gap;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        r[best_i].begin = std::min(r[best_i].begin, r[best_j].begin);
+        r[best_i].end = std::max(r[best_i].end, r[best_j].end);
+        r[best_j] = r[count_];
+        std::copy(r, r + count_, ranges_);
+        return;
+    }
+    ranges_[count_++] = {begin, end};
+}
+
+void ConfigUpdateFlow::RangeSet::add(const RangeSet &o)
+{
+    all_ |= o.all_;
+    o.for_each([this](unsigned begin, unsigned end) { add(begin, end); });
+}
+
+bool ConfigUpdateFlow::RangeSet::overlaps(const ConfigUpdateListener *l) const
+{
+    if (all_)
+    {
+        return true;
+    }
+    for (unsigned i = 0; i < count_; ++i)
+    {
+        if (l->config_range_overlaps(ranges_[i].begin, ranges_[i].end))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 extern const char *const CONFIG_FILENAME __attribute__((weak)) = nullptr;
 extern const size_t CONFIG_FILE_SIZE __attribute__((weak)) = 0;
 
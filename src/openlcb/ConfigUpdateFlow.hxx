@@ -37,6 +37,8 @@
 #ifndef _OPENLCB_CONFIGUPDATEFLOW_HXX_
 #define _OPENLCB_CONFIGUPDATEFLOW_HXX_
 
+#include <memory>
+
 #include "openmrn_features.h"
 #include "utils/ConfigUpdateListener.hxx"
 #include "utils/ConfigUpdateService.hxx"
@@ -57,6 +59,13 @@ namespace openlcb
 /// to the registered ConfigUpdateListener descendants. This flow also handles
 /// any necessary action such as reboot or factory reset. This flow keeps the
 /// file descriptor for the config file that's currently open.
+///
+/// The flow keeps track of the ranges of the config file written since the
+/// last update (see @ref mark_dirty). When enabled with @ref
+/// enable_selective_update, only those listeners are called whose declared
+/// config range overlaps the written ranges. Optionally the flow keeps a copy
+/// of the config file in RAM (see @ref enable_shadow), from which the
+/// listeners' config reads are served.
 class ConfigUpdateFlow : public StateFlowBase,
                          public ConfigUpdateService,
                          private Atomic
@@ -64,9 +73,13 @@ class ConfigUpdateFlow : public StateFlowBase,
 public:
     ConfigUpdateFlow(If *iface)
         : StateFlowBase(iface)
+        , nextSync_(syncListeners_.begin())
         , nextRefresh_(listeners_.begin())
         , needsReboot_(0)
         , needsReInit_(0)
+        , shadowFresh_(0)
+        , selectiveUpdate_(0)
+        , shadowStale_(0)
         , fd_(-1)
     {
     }
@@ -74,10 +87,39 @@ public:
     /// Must be called once before calling anything else. Returns the file
     /// descriptor.
     int open_file(const char *path);
+    /// Uses an already open file as the config file. Further calls to
+    /// open_file will return this file descriptor. Must be called before
+    /// open_file.
+    /// @param fd is the file descriptor of the config file.
+    void set_fd(int fd)
+    {
+        HASSERT(fd_ < 0);
+        fd_ = fd;
+    }
     /// Asynchronously invokes all update listeners with the config FD.
     void init_flow();
     /// Synchronously invokes all update listeners to factory reset.
     void factory_reset();
+    /// Loads the config file into RAM, and serves all further reads of the
+    /// config entries from there. Must be called after the file is opened.
+    /// After a write reported with mark_dirty, the reads go to the file until
+    /// the next update refreshes the shadow. Writes that are not reported are
+    /// only seen after the next update.
+    /// @param size is the number of bytes to keep in RAM, starting at offset
+    /// zero. Limited to the size of the file.
+    void enable_shadow(size_t size);
+    /// Makes the updates call only the listeners whose config range was
+    /// written since the previous update. Only call this if every write to
+    /// the config file is reported with mark_dirty. The memory config
+    /// protocol (config and ACDI user spaces) and ConfigEntry writes do this;
+    /// direct writes to the file descriptor by the application do not. If
+    /// any such write may happen, leave this disabled, and every update calls
+    /// all listeners.
+    void enable_selective_update()
+    {
+        AtomicHolder h(this);
+        selectiveUpdate_ = 1;
+    }
 
     void TEST_set_fd(int fd)
     {
@@ -90,6 +132,24 @@ public:
     void trigger_update() override
     {
         AtomicHolder h(this);
+        if (!is_state(exit().next_state()))
+        {
+            // An update is in progress, and will restart. Keeps the ranges it
+            // was working on.
+            updateDirty_.add(dirty_);
+        }
+        else
+        {
+            updateDirty_ = dirty_;
+        }
+        if (!selectiveUpdate_ || dirty_.empty())
+        {
+            // We don't know what changed.
+            updateDirty_.set_all();
+        }
+        dirty_.clear();
+        shadowFresh_ = 0;
+        nextSync_ = syncListeners_.begin();
         nextRefresh_ = listeners_.begin();
         needsReboot_ = 0;
         needsReInit_ = 0;
@@ -101,19 +161,127 @@ public:
 
     void register_update_listener(ConfigUpdateListener *listener) override;
     void unregister_update_listener(ConfigUpdateListener *listener) override;
+    void register_sync_listener(ConfigUpdateListener *listener) override;
+    void unregister_sync_listener(ConfigUpdateListener *listener) override;
+    void mark_dirty(unsigned offset, size_t len) override;
+    bool shadow_read(int fd, unsigned offset, void *buf, size_t len) override;
+
 private:
+    /// A small set of byte ranges of the config file. When more ranges are
+    /// added than we have space for, the ranges get merged, so the set may
+    /// grow larger than what was added.
+    class RangeSet
+    {
+    public:
+        /// Removes all ranges.
+        void clear()
+        {
+            count_ = 0;
+            all_ = false;
+        }
+
+        /// Makes the set cover the entire file.
+        void set_all()
+        {
+            all_ = true;
+        }
+
+        /// @return true if the set covers no byte.
+        bool empty() const
+        {
+            return !all_ && !count_;
+        }
+
+        /// Adds the bytes [begin, end) to the set.
+        void add(unsigned begin, unsigned end);
+
+        /// Adds all ranges of another set.
+        void add(const RangeSet &o);
+
+        /// @return true if the listener's config range overlaps the set.
+        bool overlaps(const ConfigUpdateListener *l) const;
+
+        /// Calls fn(begin, end) for each range.
+        template <class F> void for_each(F fn) const
+        {
+            for (unsigned i = 0; i < count_; ++i)
+            {
+                fn(ranges_[i].begin, ranges_[i].end);
+            }
+        }
+
+        /// @return true if the set covers the entire file.
+        bool all() const
+        {
+            return all_;
+        }
+
+    private:
+        /// How many disjoint ranges we store at most.
+        static constexpr unsigned MAX_RANGES = 4;
+        /// One range of bytes.
+        struct Range
+        {
+            unsigned begin;
+            unsigned end;
+        };
+        /// Disjoint ranges, in no particular order.
+        Range ranges_[MAX_RANGES];
+        /// How many entries of ranges_ are valid.
+        unsigned count_ = 0;
+        /// true if the set covers the entire file.
+        bool all_ = false;
+    };
+
+    /// Re-reads the ranges of the shadow that were changed in the file.
+    void refresh_shadow();
+
+    /// Reads a range of the config file into the shadow.
+    /// @param begin first byte to read.
+    /// @param end one past the last byte to read.
+    void load_shadow(unsigned begin, unsigned end);
+
     Action call_next_listener()
     {
         ConfigUpdateListener *l = nullptr;
         {
             AtomicHolder h(this);
+            if (nextSync_ != syncListeners_.end())
+            {
+                l = nextSync_.operator->();
+                ++nextSync_;
+            }
+        }
+        if (l)
+        {
+            return call_listener(l, false);
+        }
+        bool refresh;
+        {
+            AtomicHolder h(this);
+            refresh = !shadowFresh_;
+            shadowFresh_ = 1;
+        }
+        if (refresh)
+        {
+            // The sync listeners are done, so the file has the new data.
+            refresh_shadow();
+        }
+        {
+            AtomicHolder h(this);
+            // Skips the listeners that are not affected by the change.
+            while (nextRefresh_ != listeners_.end() &&
+                !updateDirty_.overlaps(nextRefresh_.operator->()))
+            {
+                ++nextRefresh_;
+            }
             if (nextRefresh_ == listeners_.end())
             {
                 return call_immediately(STATE(do_initial_load));
             }
             l = nextRefresh_.operator->();
+            ++nextRefresh_;
         }
-        ++nextRefresh_;
         return call_listener(l, false);
     }
 
@@ -187,13 +355,37 @@ private:
     /// All listeners that have not yet been added to listeners_ and their
     /// initial load needs to be called.
     queue_type pendingListeners_;
+    /// Listeners that need to be called before all others in each
+    /// update. Protected by Atomic *this.
+    queue_type syncListeners_;
+    /// Where are we in the sync part of the refresh cycle.
+    typename queue_type::iterator nextSync_;
     /// Where are we in the refresh cycle.
     typename queue_type::iterator nextRefresh_;
     /// did anybody request a reboot to happen?
     unsigned needsReboot_ : 1;
     /// did anybody request a node reinit to happen?
     unsigned needsReInit_ : 1;
+    /// 1 if the shadow has been refreshed in the current update. Protected
+    /// by Atomic *this.
+    unsigned shadowFresh_ : 1;
+    /// 1 if the updates only call the listeners affected by the writes.
+    unsigned selectiveUpdate_ : 1;
+    /// 1 if the config file was written since the shadow was last
+    /// refreshed, or the shadow is being refreshed. Reads go to the file
+    /// then. Protected by Atomic *this. Not a bit field, because readers on
+    /// other threads check it while the flow changes the flags above.
+    uint8_t shadowStale_;
     int fd_;
+    /// Ranges of the config file written since the last update started.
+    /// Protected by Atomic *this.
+    RangeSet dirty_;
+    /// Ranges of the config file changed for the current update.
+    RangeSet updateDirty_;
+    /// Copy of the beginning of the config file, or nullptr.
+    std::unique_ptr<uint8_t[]> shadow_;
+    /// Number of bytes in shadow_.
+    size_t shadowSize_ = 0;
     BarrierNotifiable n_;
 };
 
@@ -94,6 +94,7 @@ public:
         , consumer_(&impl_)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -103,6 +104,7 @@ public:
         , consumer_(&impl_)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -156,6 +158,7 @@ public:
         , gpio_(g)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -165,6 +168,7 @@ public:
         , gpio_(gpio)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
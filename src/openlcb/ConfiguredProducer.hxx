@@ -102,6 +102,7 @@ public:
         : producer_(QuiesceDebouncer::Options(3), node, 0, 0, gpio)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -111,6 +112,7 @@ public:
         : producer_(QuiesceDebouncer::Options(3), node, 0, 0, g)
         , cfg_(cfg)
     {
+        set_config_range(cfg);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -37,6 +37,7 @@
 #include "openlcb/DatagramDefs.hxx"
 #include "openlcb/DatagramImpl.hxx"
 #include "openlcb/IfCanImpl.hxx"
+#include "utils/SizedMap.hxx"
 
 namespace openlcb
 {
@@ -338,8 +339,9 @@ private:
      * payload. When a payload is finished, it should be moved into the final
      * datagram message using swap() to avoid memory copies.
      * @TODO(balazs.racz) we need some kind of timeout-based release mechanism
-     * in here. */
-    StlMap<uint64_t, DatagramPayload> pendingBuffers_;
+     * in here. Usually there are at most a few datagrams being received at
+     * the same time. */
+    SizedMap<uint64_t, DatagramPayload, 4> pendingBuffers_;
 };
 CanDatagramService::CanDatagramService(IfCan *iface,
                                        int num_registry_entries,
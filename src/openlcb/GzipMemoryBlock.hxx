@@ -0,0 +1,154 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file GzipMemoryBlock.hxx
+ *
+ * Read-only memory space serving the decompressed contents of a gzip file.
+ * Header-only; the application needs to link with -lz.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_GZIPMEMORYBLOCK_HXX_
+#define _OPENLCB_GZIPMEMORYBLOCK_HXX_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "openlcb/MmapMemoryBlock.hxx"
+#include "utils/logging.h"
+
+namespace openlcb
+{
+
+/// Decompresses a gzip file into anonymous memory pages. Base class of @ref
+/// GzipMemoryBlock.
+class GzipMappedFile : public MappedFile
+{
+protected:
+    /// Loads and decompresses a file.
+    /// @param name is the path of the gzip file.
+    /// @param add_terminator if true, a zero byte is appended after the
+    /// decompressed contents.
+    GzipMappedFile(const char *name, bool add_terminator)
+    {
+        int fd = ::open(name, O_RDONLY);
+        if (fd < 0)
+        {
+            LOG(WARNING, "Error opening file %s : %s", name, strerror(errno));
+            return;
+        }
+        if (!decompress(fd, add_terminator))
+        {
+            LOG(WARNING, "Error decompressing file %s.", name);
+            release();
+        }
+        ::close(fd);
+    }
+
+private:
+    /// Decompresses the file into a new memory region.
+    /// @param fd is the gzip file.
+    /// @param add_terminator if true, a zero byte is appended after the
+    /// decompressed contents.
+    /// @return true on success.
+    bool decompress(int fd, bool add_terminator)
+    {
+        struct stat buf;
+        HASSERT(fstat(fd, &buf) >= 0);
+        size_t len = buf.st_size;
+        // The gzip trailer has the uncompressed size (modulo 2^32).
+        uint8_t trailer[4];
+        if (len < 18 || ::pread(fd, trailer, 4, len - 4) != 4)
+        {
+            return false;
+        }
+        size_t out_len = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+            ((uint32_t)trailer[3] << 24);
+        if (!alloc_region(
+                out_len + (add_terminator ? 1 : 0), PROT_READ | PROT_WRITE))
+        {
+            return false;
+        }
+        void *in = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (in == MAP_FAILED)
+        {
+            return false;
+        }
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        // 16 + MAX_WBITS selects the gzip wrapper.
+        bool ok = inflateInit2(&strm, 16 + MAX_WBITS) == Z_OK;
+        if (ok)
+        {
+            strm.next_in = (Bytef *)in;
+            strm.avail_in = len;
+            strm.next_out = (Bytef *)region_;
+            strm.avail_out = regionLen_;
+            ok = inflate(&strm, Z_FINISH) == Z_STREAM_END &&
+                strm.total_out == out_len;
+            inflateEnd(&strm);
+        }
+        munmap(in, len);
+        // The terminator (if any) is already zero in the fresh pages.
+        return ok && mprotect(region_, regionLen_, PROT_READ) == 0;
+    }
+};
+
+/// Read-only memory space exporting the decompressed contents of a gzip
+/// file. The file is decompressed once upon construction into anonymous
+/// memory pages, and the reads are served from there; the heap is not used.
+/// This allows shipping large CDI or FDI files compressed.
+///
+/// Header-only, because it depends on zlib; the application needs to link
+/// with -lz.
+class GzipMemoryBlock : private GzipMappedFile, public ReadOnlyMemoryBlock
+{
+public:
+    /// Creates a memory block from a gzip file. If the file cannot be opened
+    /// or decompressed, logs a warning and the memory space will be empty.
+    ///
+    /// @param name is the path of the gzip file to serve.
+    /// @param add_terminator if true, the memory space will have a zero byte
+    /// after the file contents. CDI memory spaces need this.
+    GzipMemoryBlock(const char *name, bool add_terminator = true)
+        : GzipMappedFile(name, add_terminator)
+        , ReadOnlyMemoryBlock(mapData_, mapLen_)
+    {
+    }
+
+    using MappedFile::valid;
+    using MappedFile::data;
+    using MappedFile::size;
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_GZIPMEMORYBLOCK_HXX_
@@ -185,6 +185,10 @@ private:
         auto *b = get_allocation_result(if_can()->frame_write_flow());
         b->set_done(message()->new_child());
         struct can_frame *f = b->data()->mutable_frame();
+        if (nmsg()->mti == Defs::MTI_STREAM_DATA)
+        {
+            return fill_stream_data_frame(b);
+        }
         if (nmsg()->mti & (Defs::MTI_DATAGRAM_MASK | Defs::MTI_SPECIAL_MASK |
                            Defs::MTI_RESERVED_MASK))
         {
@@ -253,6 +257,49 @@ private:
             return call_immediately(STATE(send_finished));
         }
     }
+
+    /** Renders the next frame of a stream data message. The first byte of the
+     * payload is the destination stream ID, which is repeated at the
+     * beginning of every frame; the rest of the payload is split into 7-byte
+     * chunks.
+     * @param b is the allocated CAN frame buffer. */
+    Action fill_stream_data_frame(Buffer<CanHubData> *b)
+    {
+        struct can_frame *f = b->data()->mutable_frame();
+        const string &data = nmsg()->payload;
+        if (data.empty())
+        {
+            // Missing destination stream ID.
+            b->unref();
+            return call_immediately(STATE(send_finished));
+        }
+        uint32_t can_id;
+        CanDefs::set_datagram_fields(
+            &can_id, srcAlias_, dstAlias_, CanDefs::STREAM_DATA);
+        SET_CAN_FRAME_ID_EFF(*f, can_id);
+        if (!dataOffset_)
+        {
+            dataOffset_ = 1;
+        }
+        f->data[0] = data[0];
+        unsigned len = data.size() - dataOffset_;
+        if (len > 7)
+        {
+            len = 7;
+        }
+        memcpy(f->data + 1, data.data() + dataOffset_, len);
+        dataOffset_ += len;
+        f->can_dlc = 1 + len;
+        if_can()->frame_write_flow()->send(b);
+        if (dataOffset_ < data.size())
+        {
+            return call_immediately(STATE(get_can_frame_buffer));
+        }
+        else
+        {
+            return call_immediately(STATE(send_finished));
+        }
+    }
 };
 
 /** The addressed write flow is responsible for sending addressed messages to
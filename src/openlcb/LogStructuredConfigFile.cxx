@@ -0,0 +1,338 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file LogStructuredConfigFile.cxx
+ *
+ * Configuration file storage for Linux nodes that is made of a snapshot and
+ * an append-only log of changes.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "openlcb/LogStructuredConfigFile.hxx"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/ConfigUpdateService.hxx"
+#include "utils/Crc.hxx"
+#include "utils/FdUtils.hxx"
+#include "utils/logging.h"
+
+namespace openlcb
+{
+
+LogStructuredConfigFile::LogStructuredConfigFile(
+    const char *path, size_t max_log_size)
+    : path_(path)
+    , logPath_(path_ + ".log")
+    , maxLogSize_(max_log_size)
+{
+    load();
+    if (Singleton<ConfigUpdateService>::exists())
+    {
+        Singleton<ConfigUpdateService>::instance()->register_sync_listener(
+            this);
+        syncRegistered_ = true;
+    }
+}
+
+LogStructuredConfigFile::~LogStructuredConfigFile()
+{
+    if (syncRegistered_)
+    {
+        Singleton<ConfigUpdateService>::instance()->unregister_sync_listener(
+            this);
+    }
+    sync();
+    ::close(logFd_);
+    ::close(fd_);
+}
+
+void LogStructuredConfigFile::load()
+{
+    int sfd = ::open(path_.c_str(), O_RDONLY);
+    if (sfd < 0)
+    {
+        // Creates an empty snapshot, so that others can see that the config
+        // file exists.
+        sfd = ::open(path_.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+        ERRNOCHECK(path_.c_str(), sfd);
+    }
+    struct stat buf;
+    HASSERT(fstat(sfd, &buf) == 0);
+    persisted_.resize(buf.st_size);
+    FdUtils::repeated_read(sfd, persisted_.data(), persisted_.size());
+    ::close(sfd);
+    SnapshotTrailer trailer;
+    if (persisted_.size() >= sizeof(trailer))
+    {
+        memcpy(&trailer,
+            persisted_.data() + persisted_.size() - sizeof(trailer),
+            sizeof(trailer));
+        if (trailer.magic == SNAPSHOT_MAGIC &&
+            trailer.size == persisted_.size() - sizeof(trailer))
+        {
+            generation_ = trailer.generation;
+            persisted_.resize(trailer.size);
+        }
+    }
+
+    logFd_ = ::open(logPath_.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    ERRNOCHECK(logPath_.c_str(), logFd_);
+    HASSERT(fstat(logFd_, &buf) == 0);
+    std::vector<uint8_t> log(buf.st_size);
+    FdUtils::repeated_read(logFd_, log.data(), log.size());
+    size_t ofs = 0;
+    LogHeader lhdr;
+    if (log.size() >= sizeof(lhdr))
+    {
+        memcpy(&lhdr, log.data(), sizeof(lhdr));
+    }
+    if (log.size() < sizeof(lhdr) || lhdr.magic != LOG_MAGIC)
+    {
+        // Empty, or the first sync was interrupted.
+        log.clear();
+    }
+    else if (lhdr.generation != generation_)
+    {
+        // The power was lost after a compaction wrote the new snapshot, but
+        // before it emptied the log. The snapshot already contains these
+        // changes.
+        LOG(WARNING, "%s: ignoring log of generation %u, snapshot is %u",
+            logPath_.c_str(), (unsigned)lhdr.generation,
+            (unsigned)generation_);
+        log.clear();
+    }
+    else
+    {
+        ofs = sizeof(lhdr);
+    }
+    RecordHeader hdr;
+    while (ofs + sizeof(hdr) <= log.size())
+    {
+        memcpy(&hdr, log.data() + ofs, sizeof(hdr));
+        const uint8_t *data = log.data() + ofs + sizeof(hdr);
+        if (hdr.len > MAX_RECORD_LEN ||
+            ofs + sizeof(hdr) + hdr.len > log.size() ||
+            record_crc(hdr, data) != hdr.crc)
+        {
+            break;
+        }
+        if (hdr.offset + hdr.len > persisted_.size())
+        {
+            persisted_.resize(hdr.offset + hdr.len);
+        }
+        memcpy(persisted_.data() + hdr.offset, data, hdr.len);
+        ofs += sizeof(hdr) + hdr.len;
+        ++stats_.replayedRecords;
+    }
+    if (ofs <= sizeof(lhdr))
+    {
+        // No records; the header will be written with the first ones.
+        ofs = 0;
+    }
+    if (ofs != (size_t)buf.st_size)
+    {
+        // The last sync was interrupted, or the log is stale.
+        LOG(WARNING, "%s: dropping %u bytes of the log",
+            logPath_.c_str(), (unsigned)(buf.st_size - ofs));
+        ERRNOCHECK("truncate_log", ftruncate(logFd_, ofs));
+    }
+    logSize_ = ofs;
+    HASSERT(lseek(logFd_, ofs, SEEK_SET) == (off_t)ofs);
+
+    fd_ = memfd_create("openmrn_config", MFD_CLOEXEC);
+    ERRNOCHECK("memfd_create", fd_);
+    FdUtils::repeated_write(fd_, persisted_.data(), persisted_.size());
+}
+
+void LogStructuredConfigFile::sync()
+{
+    struct stat buf;
+    HASSERT(fstat(fd_, &buf) == 0);
+    size_t size = buf.st_size;
+    if (size < persisted_.size())
+    {
+        // The log cannot express a truncation.
+        compact();
+        return;
+    }
+    current_.resize(size);
+    HASSERT(pread(fd_, current_.data(), size, 0) == (ssize_t)size);
+
+    logBuf_.clear();
+    const uint8_t *cur = current_.data();
+    const uint8_t *old = persisted_.data();
+    size_t old_size = persisted_.size();
+    // Compares in blocks to quickly skip the unchanged parts of the file.
+    static constexpr size_t BLOCK = 64;
+    size_t i = 0;
+    while (i < old_size)
+    {
+        size_t len = std::min(BLOCK, old_size - i);
+        if (!memcmp(cur + i, old + i, len))
+        {
+            i += len;
+            continue;
+        }
+        while (cur[i] == old[i])
+        {
+            ++i;
+        }
+        // Extends the range until we find a gap of unchanged bytes that is
+        // longer than a record header.
+        size_t last = i;
+        size_t j = i + 1;
+        while (j < old_size && j - last <= sizeof(RecordHeader))
+        {
+            if (cur[j] != old[j])
+            {
+                last = j;
+            }
+            ++j;
+        }
+        add_records(cur, i, last + 1);
+        i = j;
+    }
+    if (size > old_size)
+    {
+        add_records(cur, old_size, size);
+    }
+    if (logBuf_.empty())
+    {
+        return;
+    }
+    if (!logSize_)
+    {
+        LogHeader lhdr{LOG_MAGIC, generation_};
+        const uint8_t *h = reinterpret_cast<const uint8_t *>(&lhdr);
+        logBuf_.insert(logBuf_.begin(), h, h + sizeof(lhdr));
+    }
+    FdUtils::repeated_write(logFd_, logBuf_.data(), logBuf_.size());
+    ERRNOCHECK("sync_log", fdatasync(logFd_));
+    logSize_ += logBuf_.size();
+    stats_.logBytes += logBuf_.size();
+    ++stats_.syncs;
+    persisted_.swap(current_);
+
+    size_t limit = maxLogSize_;
+    if (!limit)
+    {
+        limit = std::max(persisted_.size(), (size_t)65536);
+    }
+    if (logSize_ > limit)
+    {
+        compact();
+    }
+}
+
+void LogStructuredConfigFile::compact()
+{
+    struct stat buf;
+    HASSERT(fstat(fd_, &buf) == 0);
+    current_.resize(buf.st_size);
+    HASSERT(pread(fd_, current_.data(), current_.size(), 0) ==
+        (ssize_t)current_.size());
+
+    std::string tmp_path = path_ + ".tmp";
+    int tfd = ::open(
+        tmp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+    ERRNOCHECK(tmp_path.c_str(), tfd);
+    FdUtils::repeated_write(tfd, current_.data(), current_.size());
+    SnapshotTrailer trailer{
+        SNAPSHOT_MAGIC, generation_ + 1, (uint32_t)current_.size()};
+    FdUtils::repeated_write(tfd, &trailer, sizeof(trailer));
+    ERRNOCHECK("sync_snapshot", fsync(tfd));
+    ::close(tfd);
+    ERRNOCHECK("rename_snapshot", rename(tmp_path.c_str(), path_.c_str()));
+    // From here on, the old log is ignored, because it belongs to the
+    // previous generation.
+    ++generation_;
+    // Makes the rename durable before the log is emptied.
+    size_t slash = path_.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path_.substr(0, slash);
+    int dfd = ::open(dir.empty() ? "/" : dir.c_str(), O_RDONLY);
+    if (dfd >= 0)
+    {
+        fsync(dfd);
+        ::close(dfd);
+    }
+
+    ERRNOCHECK("truncate_log", ftruncate(logFd_, 0));
+    HASSERT(lseek(logFd_, 0, SEEK_SET) == 0);
+    ERRNOCHECK("sync_log", fdatasync(logFd_));
+    logSize_ = 0;
+    persisted_.swap(current_);
+    ++stats_.compactions;
+}
+
+void LogStructuredConfigFile::add_records(
+    const uint8_t *data, size_t begin, size_t end)
+{
+    while (begin < end)
+    {
+        RecordHeader hdr;
+        hdr.offset = begin;
+        hdr.len = std::min(end - begin, (size_t)MAX_RECORD_LEN);
+        hdr.crc = record_crc(hdr, data + begin);
+        const uint8_t *h = reinterpret_cast<const uint8_t *>(&hdr);
+        logBuf_.insert(logBuf_.end(), h, h + sizeof(hdr));
+        logBuf_.insert(logBuf_.end(), data + begin, data + begin + hdr.len);
+        begin += hdr.len;
+        ++stats_.records;
+    }
+}
+
+uint16_t LogStructuredConfigFile::record_crc(
+    const RecordHeader &hdr, const uint8_t *data)
+{
+    uint8_t buf[sizeof(hdr.offset) + sizeof(hdr.len) + MAX_RECORD_LEN];
+    memcpy(buf, &hdr.offset, sizeof(hdr.offset));
+    memcpy(buf + sizeof(hdr.offset), &hdr.len, sizeof(hdr.len));
+    memcpy(buf + sizeof(hdr.offset) + sizeof(hdr.len), data, hdr.len);
+    return crc_16_ibm(buf, sizeof(hdr.offset) + sizeof(hdr.len) + hdr.len);
+}
+
+ConfigUpdateListener::UpdateAction
+LogStructuredConfigFile::apply_configuration(
+    int fd, bool initial_load, BarrierNotifiable *done)
+{
+    AutoNotify n(done);
+    sync();
+    return UPDATED;
+}
+
+} // namespace openlcb
+
+#endif // __linux__
@@ -0,0 +1,216 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file LogStructuredConfigFile.hxx
+ *
+ * Configuration file storage for Linux nodes that is made of a snapshot and
+ * an append-only log of changes.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_LOGSTRUCTUREDCONFIGFILE_HXX_
+#define _OPENLCB_LOGSTRUCTUREDCONFIGFILE_HXX_
+
+#include <string>
+#include <vector>
+
+#include "utils/ConfigUpdateListener.hxx"
+
+#if defined(__linux__)
+
+namespace openlcb
+{
+
+/// Stores the configuration file of a node as a snapshot file and an
+/// append-only log of changes next to it (with the ".log" suffix). The
+/// snapshot is a copy of the configuration file followed by a small trailer
+/// with the generation number of the snapshot. A plain configuration file
+/// without the trailer is accepted as a snapshot of generation zero, so an
+/// existing configuration file can be used as a snapshot.
+///
+/// Upon construction the snapshot is loaded and the log is replayed into an
+/// in-memory file (memfd). The file descriptor of this file is exported via
+/// fd(), and can be used everywhere the config file descriptor is used
+/// (ConfigUpdateFlow, ConfigEntry reads and writes, FileMemorySpace). Writes
+/// to this file are not persistent until sync() is called. The sync compares
+/// the file to the last persisted contents, and appends all changed ranges
+/// to the log with a single write and a single fsync, no matter how many
+/// writes happened in between. When the log grows too large, a new snapshot
+/// is written and the log is emptied.
+///
+/// The object registers itself as a sync listener to the ConfigUpdateService
+/// if one exists, thus every configuration update (such as an Update
+/// Complete command) persists the changes.
+///
+/// A power loss in the middle of a sync loses at most the changes of that
+/// sync: every log record carries a checksum, and the replay stops at the
+/// first incomplete record. The log starts with the generation number of the
+/// snapshot it applies to. A power loss after a new snapshot is in place but
+/// before the log is emptied leaves a log of the previous generation behind,
+/// which is ignored upon the next load.
+class LogStructuredConfigFile : public ConfigUpdateListener
+{
+public:
+    /// Opens the configuration file storage.
+    /// @param path is the name of the snapshot file. It is created if it does
+    /// not exist.
+    /// @param max_log_size when the log grows beyond this many bytes, a new
+    /// snapshot is written. If zero, the limit is the size of the
+    /// configuration file, but at least 64 KB.
+    LogStructuredConfigFile(const char *path, size_t max_log_size = 0);
+
+    /// Persists any remaining changes.
+    ~LogStructuredConfigFile();
+
+    /// @return the file descriptor with the current contents of the
+    /// configuration file.
+    int fd()
+    {
+        return fd_;
+    }
+
+    /// Writes all changes made to the file since the last sync to the log,
+    /// and waits for them to reach the storage. Blocks the caller.
+    void sync();
+
+    /// Writes a new snapshot with the current contents of the file, then
+    /// empties the log. Blocks the caller.
+    void compact();
+
+    /// Counters about the storage operations.
+    struct Stats
+    {
+        /// How many records were replayed upon opening.
+        unsigned replayedRecords;
+        /// How many syncs wrote anything to the log.
+        unsigned syncs;
+        /// How many records were written to the log.
+        unsigned records;
+        /// How many bytes were written to the log.
+        size_t logBytes;
+        /// How many times a new snapshot was written.
+        unsigned compactions;
+    };
+
+    /// @return the storage operation counters.
+    const Stats &stats()
+    {
+        return stats_;
+    }
+
+    UpdateAction apply_configuration(
+        int fd, bool initial_load, BarrierNotifiable *done) override;
+
+    void factory_reset(int fd) override
+    {
+        // The changes will be persisted by the next sync.
+    }
+
+private:
+    /// Header of a record in the log. The header is followed by len bytes of
+    /// data to write to the configuration file at offset.
+    struct RecordHeader
+    {
+        uint32_t offset;
+        uint16_t len;
+        /// CRC16-IBM of the offset, the length and the data.
+        uint16_t crc;
+    };
+
+    /// Trailer at the end of the snapshot file.
+    struct SnapshotTrailer
+    {
+        /// SNAPSHOT_MAGIC
+        uint32_t magic;
+        /// Generation of the snapshot; each compaction increments it.
+        uint32_t generation;
+        /// Number of bytes of the configuration file before the trailer.
+        uint32_t size;
+    };
+
+    /// Header at the beginning of the log file.
+    struct LogHeader
+    {
+        /// LOG_MAGIC
+        uint32_t magic;
+        /// Generation of the snapshot that the records apply to.
+        uint32_t generation;
+    };
+
+    /// Identifies the snapshot trailer.
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x4C534346;
+    /// Identifies the log header.
+    static constexpr uint32_t LOG_MAGIC = 0x4C53434C;
+
+    /// Largest number of data bytes in a single record.
+    static constexpr unsigned MAX_RECORD_LEN = 4096;
+
+    /// Loads the snapshot and replays the log into the in-memory file.
+    void load();
+
+    /// Appends records for a range of the file to the log buffer.
+    /// @param data is the current contents of the file.
+    /// @param begin first changed byte.
+    /// @param end one past the last changed byte.
+    void add_records(const uint8_t *data, size_t begin, size_t end);
+
+    /// @return the checksum of a record.
+    static uint16_t record_crc(const RecordHeader &hdr, const uint8_t *data);
+
+    /// Name of the snapshot file.
+    std::string path_;
+    /// Name of the log file.
+    std::string logPath_;
+    /// Limit on the log size before a new snapshot is written.
+    size_t maxLogSize_;
+    /// In-memory file with the current contents.
+    int fd_;
+    /// Log file, open for appending.
+    int logFd_;
+    /// Number of bytes in the log file. The log header is only written
+    /// together with the first records.
+    size_t logSize_{0};
+    /// Generation of the current snapshot.
+    uint32_t generation_{0};
+    /// The file contents as of the last sync.
+    std::vector<uint8_t> persisted_;
+    /// Scratch buffer for reading the in-memory file.
+    std::vector<uint8_t> current_;
+    /// Records to append to the log in the current sync.
+    std::vector<uint8_t> logBuf_;
+    /// Storage operation counters.
+    Stats stats_{0, 0, 0, 0, 0};
+    /// true if we registered to the ConfigUpdateService.
+    bool syncRegistered_{false};
+};
+
+} // namespace openlcb
+
+#endif // __linux__
+
+#endif // _OPENLCB_LOGSTRUCTUREDCONFIGFILE_HXX_
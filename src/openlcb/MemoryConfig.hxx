@@ -78,6 +78,8 @@ struct MemoryConfigDefs {
         COMMAND_READ_REPLY        = 0x50, /**< reply to read data from address space */
         COMMAND_READ_FAILED       = 0x58, /**< failed to read data from address space */
         COMMAND_READ_STREAM       = 0x60, /**< command to read data using a stream */
+        COMMAND_READ_STREAM_REPLY = 0x70, /**< reply to read data using a stream */
+        COMMAND_READ_STREAM_FAILED= 0x78, /**< failed to read data using a stream */
         COMMAND_MAX_FOR_RW        = 0x80, /**< command <= this value have fixed bit arrangement. */
         COMMAND_OPTIONS           = 0x80,
         COMMAND_OPTIONS_REPLY     = 0x82,
@@ -162,6 +164,15 @@ struct MemoryConfigDefs {
         return space > SPACE_SPECIAL;
     }
 
+    /// @return true if the writes to a memory space change the config file
+    /// and have to be reported to the ConfigUpdateService. The ACDI user
+    /// space is stored at the beginning of the config file, at the same
+    /// addresses.
+    static bool is_config_file_space(uint8_t space)
+    {
+        return space == SPACE_CONFIG || space == SPACE_ACDI_USR;
+    }
+
     static DatagramPayload write_datagram(
         uint8_t space, uint32_t offset, const string &data = "")
     {
@@ -633,6 +644,20 @@ public:
         HASSERT(client_ == client);
         client_ = nullptr;
     }
+
+    /// Registers a handler to forward the read stream and write stream
+    /// commands to (see MemoryConfigStreamHandler). Without such a handler
+    /// these commands are rejected.
+    void set_stream_handler(DatagramHandlerFlow* handler) {
+        HASSERT(streamHandler_ == nullptr || streamHandler_ == handler);
+        streamHandler_ = handler;
+    }
+
+    /// Unregisters the previously registered stream handler.
+    void clear_stream_handler(DatagramHandlerFlow* handler) {
+        HASSERT(streamHandler_ == handler);
+        streamHandler_ = nullptr;
+    }
     
 private:
     typedef MemorySpace::address_t address_t;
@@ -662,6 +687,18 @@ private:
         {
             return call_immediately(STATE(handle_write));
         }
+        else if ((cmd & MemoryConfigDefs::COMMAND_MASK) ==
+                     MemoryConfigDefs::COMMAND_WRITE_STREAM ||
+                 (cmd & MemoryConfigDefs::COMMAND_MASK) ==
+                     MemoryConfigDefs::COMMAND_READ_STREAM)
+        {
+            if (streamHandler_)
+            {
+                streamHandler_->send(transfer_message());
+                return exit();
+            }
+            return respond_reject(Defs::ERROR_UNIMPLEMENTED_SUBCMD);
+        }
         switch (cmd)
         {
             case MemoryConfigDefs::COMMAND_LOCK:
@@ -718,6 +755,8 @@ private:
             case MemoryConfigDefs::COMMAND_WRITE_STREAM_FAILED:
             case MemoryConfigDefs::COMMAND_READ_REPLY:
             case MemoryConfigDefs::COMMAND_READ_FAILED:
+            case MemoryConfigDefs::COMMAND_READ_STREAM_REPLY:
+            case MemoryConfigDefs::COMMAND_READ_STREAM_FAILED:
             case MemoryConfigDefs::COMMAND_OPTIONS_REPLY:
             case MemoryConfigDefs::COMMAND_INFORMATION_REPLY:
             case MemoryConfigDefs::COMMAND_LOCK_REPLY:
@@ -810,9 +849,14 @@ private:
         response_.push_back(available_commands >> 8);
         response_.push_back(available_commands & 0xff);
         // Write lengths
-        response_.push_back(static_cast<char> (
-            MemoryConfigDefs::LENGTH_1 | MemoryConfigDefs::LENGTH_2 |
-            MemoryConfigDefs::LENGTH_4 | MemoryConfigDefs::LENGTH_ARBITRARY));
+        uint8_t write_lengths = MemoryConfigDefs::LENGTH_1 |
+            MemoryConfigDefs::LENGTH_2 | MemoryConfigDefs::LENGTH_4 |
+            MemoryConfigDefs::LENGTH_ARBITRARY;
+        if (streamHandler_)
+        {
+            write_lengths |= MemoryConfigDefs::LENGTH_STREAM;
+        }
+        response_.push_back(static_cast<char>(write_lengths));
 
         uint8_t min_space = 0xFF;
         uint8_t max_space = 0;
@@ -1010,6 +1054,15 @@ private:
         {
             size_t written = space->write(address, in_bytes() + data_offset,
                                           write_len, &error, this);
+            if (written &&
+                MemoryConfigDefs::is_config_file_space(get_space_number()) &&
+                Singleton<ConfigUpdateService>::exists())
+            {
+                // Lets the config update flow know which listeners need to be
+                // called at the next update.
+                Singleton<ConfigUpdateService>::instance()->mark_dirty(
+                    address, written);
+            }
             currentOffset_ += written;
             write_len -= written;
             if (error == MemorySpace::ERROR_AGAIN)
@@ -1206,6 +1259,8 @@ private:
     /// If there is a memory config client, we will forward response traffic to
     /// it.
     DatagramHandlerFlow* client_{nullptr};
+    /// If there is a stream handler, we forward the stream commands to it.
+    DatagramHandlerFlow* streamHandler_{nullptr};
 
     /** Offset withing the current write/read datagram. This does not include
      * the offset from the incoming datagram. */
@@ -0,0 +1,281 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MemoryConfigStream.cxx
+ *
+ * Server side of the stream-based read and write commands of the memory
+ * configuration protocol.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "openlcb/MemoryConfigStream.hxx"
+
+namespace openlcb
+{
+
+MemoryConfigStreamHandler::MemoryConfigStreamHandler(
+    MemoryConfigHandler *parent, StreamTransport *transport)
+    : DefaultDatagramHandler(parent->dg_service())
+    , parent_(parent)
+    , transport_(transport)
+    , receiver_(transport)
+    , writer_(transport->iface())
+    , sender_(transport)
+{
+    parent_->set_stream_handler(this);
+}
+
+MemoryConfigStreamHandler::~MemoryConfigStreamHandler()
+{
+    parent_->clear_stream_handler(this);
+}
+
+unsigned MemoryConfigStreamHandler::get_space_number()
+{
+    uint8_t cmd = in_bytes()[1];
+    if (has_custom_space())
+    {
+        return in_bytes()[6];
+    }
+    return MemoryConfigDefs::COMMAND_MASK +
+        (cmd & ~MemoryConfigDefs::COMMAND_MASK);
+}
+
+MemorySpace *MemoryConfigStreamHandler::get_space()
+{
+    Node *node = message()->data()->dst;
+    MemorySpace *space =
+        parent_->registry()->lookup(node, get_space_number());
+    if (!space || !space->set_node(node))
+    {
+        return nullptr;
+    }
+    return space;
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::entry()
+{
+    response_.clear();
+    size_t len = message()->data()->payload.size();
+    if (len < 2)
+    {
+        return respond_reject(Defs::ERROR_INVALID_ARGS_MESSAGE_TOO_SHORT);
+    }
+    switch (in_bytes()[1] & MemoryConfigDefs::COMMAND_MASK)
+    {
+        case MemoryConfigDefs::COMMAND_WRITE_STREAM:
+            return call_immediately(STATE(handle_write_stream));
+        case MemoryConfigDefs::COMMAND_READ_STREAM:
+            return call_immediately(STATE(handle_read_stream));
+        default:
+            return respond_reject(Defs::ERROR_UNIMPLEMENTED_SUBCMD);
+    }
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::respond_failed(
+    uint8_t failed_cmd, uint16_t error)
+{
+    unsigned ofs = args_offset();
+    response_.assign((const char *)in_bytes(), ofs);
+    response_[1] =
+        failed_cmd | (in_bytes()[1] & ~MemoryConfigDefs::COMMAND_MASK);
+    response_.push_back(error >> 8);
+    response_.push_back(error & 0xff);
+    return respond_ok(DatagramDefs::REPLY_PENDING);
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::handle_write_stream()
+{
+    size_t len = message()->data()->payload.size();
+    unsigned ofs = args_offset();
+    if (len <= ofs)
+    {
+        return respond_reject(Defs::ERROR_INVALID_ARGS_MESSAGE_TOO_SHORT);
+    }
+    MemorySpace *space = get_space();
+    if (!space)
+    {
+        return respond_failed(MemoryConfigDefs::COMMAND_WRITE_STREAM_FAILED,
+            MemoryConfigDefs::ERROR_SPACE_NOT_KNOWN);
+    }
+    if (space->read_only())
+    {
+        return respond_failed(MemoryConfigDefs::COMMAND_WRITE_STREAM_FAILED,
+            MemoryConfigDefs::ERROR_WRITE_TO_RO);
+    }
+    uint8_t src_stream_id = in_bytes()[ofs];
+    uint8_t dst_stream_id = receiver_.start(message()->data()->dst,
+        message()->data()->src, src_stream_id, &writer_);
+    if (dst_stream_id == StreamDefs::INVALID_STREAM_ID)
+    {
+        return respond_failed(MemoryConfigDefs::COMMAND_WRITE_STREAM_FAILED,
+            DatagramDefs::BUFFER_UNAVAILABLE);
+    }
+    writer_.reset(space, get_address(),
+        MemoryConfigDefs::is_config_file_space(get_space_number()));
+    response_.assign((const char *)in_bytes(), ofs + 1);
+    response_[1] |= MemoryConfigDefs::COMMAND_REPLY_BIT_FOR_RW;
+    response_.push_back(dst_stream_id);
+    return respond_ok(DatagramDefs::REPLY_PENDING);
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::handle_read_stream()
+{
+    size_t len = message()->data()->payload.size();
+    unsigned ofs = args_offset();
+    if (len < ofs + 5)
+    {
+        return respond_reject(Defs::ERROR_INVALID_ARGS_MESSAGE_TOO_SHORT);
+    }
+    MemorySpace *space = get_space();
+    if (!space)
+    {
+        return respond_failed(MemoryConfigDefs::COMMAND_READ_STREAM_FAILED,
+            MemoryConfigDefs::ERROR_SPACE_NOT_KNOWN);
+    }
+    address_t address = get_address();
+    if (address > space->max_address())
+    {
+        return respond_failed(MemoryConfigDefs::COMMAND_READ_STREAM_FAILED,
+            MemoryConfigDefs::ERROR_OUT_OF_BOUNDS);
+    }
+    uint32_t count = load_be32(in_bytes() + ofs + 1);
+    if (!count)
+    {
+        count = space->max_address() - address + 1;
+    }
+    readNode_ = message()->data()->dst;
+    readDst_ = message()->data()->src;
+    readSpace_ = space;
+    readAddress_ = address;
+    readLength_ = count;
+    readStreamId_ = in_bytes()[ofs];
+    response_.assign((const char *)in_bytes(), ofs + 5);
+    response_[1] |= MemoryConfigDefs::COMMAND_REPLY_BIT_FOR_RW;
+    return respond_ok(DatagramDefs::REPLY_PENDING);
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::ok_response_sent()
+{
+    if (!response_.empty())
+    {
+        return allocate_and_call(
+            STATE(client_allocated), dg_service()->client_allocator());
+    }
+    return release_and_exit();
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::client_allocated()
+{
+    responseFlow_ = full_allocation_result(dg_service()->client_allocator());
+    return allocate_and_call(
+        dg_service()->iface()->dispatcher(), STATE(send_response_datagram));
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::send_response_datagram()
+{
+    auto *b = get_allocation_result(dg_service()->iface()->dispatcher());
+    b->set_done(b_.reset(this));
+    b->data()->reset(Defs::MTI_DATAGRAM, message()->data()->dst->node_id(),
+        message()->data()->src, EMPTY_PAYLOAD);
+    b->data()->payload.swap(response_);
+    release();
+    responseFlow_->write_datagram(b);
+    return wait_and_call(STATE(response_flow_complete));
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::response_flow_complete()
+{
+    bool success = responseFlow_->result() & DatagramClient::OPERATION_SUCCESS;
+    if (!success)
+    {
+        LOG(WARNING,
+            "MemoryConfigStream: Failed to send response datagram. error code "
+            "%x",
+            (unsigned)responseFlow_->result());
+    }
+    dg_service()->client_allocator()->typed_insert(responseFlow_);
+    if (readSpace_)
+    {
+        // The reply to a read stream command is out; now we can open the
+        // stream.
+        if (success)
+        {
+            auto *b = sender_.alloc();
+            b->data()->reset(readNode_, readDst_, readSpace_, readAddress_,
+                readLength_, readStreamId_);
+            b->data()->done.reset(EmptyNotifiable::DefaultInstance());
+            sender_.send(b);
+        }
+        readSpace_ = nullptr;
+    }
+    return exit();
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::SpaceWriter::entry()
+{
+    if (message()->data()->mti != Defs::MTI_STREAM_DATA)
+    {
+        // Stream complete.
+        if (error_)
+        {
+            LOG(WARNING, "MemoryConfigStream: write stream failed: %04x",
+                error_);
+        }
+        return release_and_exit();
+    }
+    offset_ = 1;
+    return call_immediately(STATE(try_write));
+}
+
+StateFlowBase::Action MemoryConfigStreamHandler::SpaceWriter::try_write()
+{
+    const Payload &p = message()->data()->payload;
+    if (error_ || offset_ >= p.size())
+    {
+        return release_and_exit();
+    }
+    errorcode_t error = 0;
+    size_t written = space_->write(address_,
+        (const uint8_t *)p.data() + offset_, p.size() - offset_, &error, this);
+    if (written && isConfig_ && Singleton<ConfigUpdateService>::exists())
+    {
+        Singleton<ConfigUpdateService>::instance()->mark_dirty(
+            address_, written);
+    }
+    address_ += written;
+    offset_ += written;
+    if (error == MemorySpace::ERROR_AGAIN)
+    {
+        return wait();
+    }
+    error_ = error;
+    return again();
+}
+
+} // namespace openlcb
@@ -0,0 +1,193 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MemoryConfigStream.hxx
+ *
+ * Server side of the stream-based read and write commands of the memory
+ * configuration protocol.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_MEMORYCONFIGSTREAM_HXX_
+#define _OPENLCB_MEMORYCONFIGSTREAM_HXX_
+
+#include "openlcb/DatagramHandlerDefault.hxx"
+#include "openlcb/MemoryConfig.hxx"
+#include "openlcb/StreamTransport.hxx"
+
+namespace openlcb
+{
+
+/// Handles the Read Stream and Write Stream commands of the memory
+/// configuration protocol on behalf of a MemoryConfigHandler. Uses the memory
+/// spaces registered with the parent handler.
+///
+/// Write Stream: {0x20, 0x20+f, address(4), [space], src stream ID}. The
+/// reply is {0x20, 0x30+f, address(4), [space], src stream ID, dst stream
+/// ID}, after which the client opens the stream towards us.
+///
+/// Read Stream: {0x20, 0x60+f, address(4), [space], dst stream ID,
+/// count(4)}; a count of zero reads until the end of the space. The reply
+/// echoes the request with 0x70+f, then we open a stream to the client,
+/// proposing the given dst stream ID.
+///
+/// One stream of each direction is handled at a time; the datagram handler
+/// itself is not blocked while a stream is running.
+class MemoryConfigStreamHandler : public DefaultDatagramHandler
+{
+public:
+    /// Constructor.
+    /// @param parent the memory config handler whose spaces to use. This
+    /// object registers itself with parent for the stream commands.
+    /// @param transport the stream service of the interface.
+    MemoryConfigStreamHandler(
+        MemoryConfigHandler *parent, StreamTransport *transport);
+    ~MemoryConfigStreamHandler();
+
+private:
+    typedef MemorySpace::address_t address_t;
+    typedef MemorySpace::errorcode_t errorcode_t;
+
+    /// Sink for the incoming data of a write stream command. Writes the
+    /// stream bytes into the memory space.
+    class SpaceWriter : public StateFlow<Buffer<GenMessage>, QList<1>>
+    {
+    public:
+        SpaceWriter(Service *s)
+            : StateFlow<Buffer<GenMessage>, QList<1>>(s)
+        {
+        }
+
+        /// Sets where the next stream should go.
+        /// @param space the memory space to write.
+        /// @param address where to write the first byte.
+        /// @param is_config true if the space is stored in the config file,
+        /// so the writes have to be reported to the config update service.
+        void reset(MemorySpace *space, address_t address, bool is_config)
+        {
+            space_ = space;
+            address_ = address;
+            isConfig_ = is_config;
+            error_ = 0;
+        }
+
+    private:
+        Action entry() override;
+        Action try_write();
+
+        /// Where to write.
+        MemorySpace *space_{nullptr};
+        /// Next address to write.
+        address_t address_{0};
+        /// Offset of the next byte to write in the current message payload.
+        unsigned offset_{0};
+        /// First error returned by the memory space.
+        errorcode_t error_{0};
+        /// True if we are writing a space stored in the config file.
+        bool isConfig_{false};
+    };
+
+    Action entry() override;
+    Action handle_write_stream();
+    Action handle_read_stream();
+    /// Sends a failed response with the given error code.
+    Action respond_failed(uint8_t failed_cmd, uint16_t error);
+
+    Action ok_response_sent() override;
+    Action client_allocated();
+    Action send_response_datagram();
+    Action response_flow_complete();
+
+    /// @return true if the incoming command has the space number in byte 6.
+    bool has_custom_space()
+    {
+        return !(in_bytes()[1] & ~MemoryConfigDefs::COMMAND_MASK);
+    }
+
+    /// @return the offset after the address and space number in the
+    /// incoming command.
+    unsigned args_offset()
+    {
+        return has_custom_space() ? 7 : 6;
+    }
+
+    /// @return the memory space number of the incoming command.
+    unsigned get_space_number();
+
+    /// @return the memory space for the incoming command, or nullptr.
+    MemorySpace *get_space();
+
+    /// @return the address in the incoming command.
+    address_t get_address()
+    {
+        return load_be32(in_bytes() + 2);
+    }
+
+    /// @return a 4-byte big endian number from bytes.
+    static uint32_t load_be32(const uint8_t *bytes)
+    {
+        return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+            (uint32_t(bytes[2]) << 8) | bytes[3];
+    }
+
+    /// @returns the request datagram payload buffer.
+    const uint8_t *in_bytes()
+    {
+        return reinterpret_cast<const uint8_t *>(
+            message()->data()->payload.data());
+    }
+
+    /// Handler that we are helping.
+    MemoryConfigHandler *parent_;
+    /// Stream service to use.
+    StreamTransport *transport_;
+    /// Receives write streams.
+    StreamReceiver receiver_;
+    /// Writes the received data into the memory space.
+    SpaceWriter writer_;
+    /// Sends read streams.
+    StreamSender sender_;
+
+    DatagramPayload response_; //< reply payload to send back.
+    DatagramClient *responseFlow_{nullptr};
+    BarrierNotifiable b_;
+
+    /// @{ Parameters of a read stream to start after the response datagram
+    /// is sent.
+    Node *readNode_{nullptr};
+    NodeHandle readDst_;
+    MemorySpace *readSpace_{nullptr};
+    address_t readAddress_;
+    uint32_t readLength_;
+    uint8_t readStreamId_;
+    /// @}
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_MEMORYCONFIGSTREAM_HXX_
@@ -0,0 +1,111 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MmapMemoryBlock.cxx
+ *
+ * Read-only memory space serving the contents of a memory-mapped file.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "openlcb/MmapMemoryBlock.hxx"
+
+#if defined(__linux__) || defined(__MACH__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/logging.h"
+
+namespace openlcb
+{
+
+MappedFile::MappedFile(const char *name, bool add_terminator)
+{
+    int fd = ::open(name, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG(WARNING, "Error opening file %s : %s", name, strerror(errno));
+        return;
+    }
+    struct stat buf;
+    HASSERT(fstat(fd, &buf) >= 0);
+    size_t len = buf.st_size;
+    // Reserves zero-filled pages for the entire region first, then maps the
+    // file over the beginning. The bytes after the end of the file are zero
+    // both in the last page of the file and in the reserved pages; this
+    // gives us the terminator without copying anything.
+    if (alloc_region(len + (add_terminator ? 1 : 0), PROT_READ) && len &&
+        mmap(region_, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+            MAP_FAILED)
+    {
+        LOG(WARNING, "Error mapping file %s : %s", name, strerror(errno));
+        release();
+    }
+    // The mapping stays valid after the file is closed.
+    ::close(fd);
+}
+
+bool MappedFile::alloc_region(size_t len, int prot)
+{
+    if (!len)
+    {
+        return false;
+    }
+    size_t page = sysconf(_SC_PAGESIZE);
+    regionLen_ = (len + page - 1) / page * page;
+    region_ = mmap(
+        nullptr, regionLen_, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region_ == MAP_FAILED)
+    {
+        region_ = nullptr;
+        return false;
+    }
+    mapData_ = static_cast<const uint8_t *>(region_);
+    mapLen_ = len;
+    return true;
+}
+
+void MappedFile::release()
+{
+    if (region_)
+    {
+        munmap(region_, regionLen_);
+    }
+    region_ = nullptr;
+    regionLen_ = 0;
+    mapData_ = nullptr;
+    mapLen_ = 0;
+}
+
+} // namespace openlcb
+
+#endif // __linux__ || __MACH__
@@ -0,0 +1,141 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MmapMemoryBlock.hxx
+ *
+ * Read-only memory space serving the contents of a memory-mapped file.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_MMAPMEMORYBLOCK_HXX_
+#define _OPENLCB_MMAPMEMORYBLOCK_HXX_
+
+#include "openlcb/MemoryConfig.hxx"
+
+#if defined(__linux__) || defined(__MACH__)
+
+namespace openlcb
+{
+
+/// Holds a read-only memory mapping of the contents of a file. Base class of
+/// @ref MmapMemoryBlock, which needs the mapping to exist before its
+/// ReadOnlyMemoryBlock base is constructed.
+class MappedFile
+{
+public:
+    /// @return true if the file was successfully loaded.
+    bool valid()
+    {
+        return mapData_ != nullptr;
+    }
+
+    /// @return the contents of the file. The pointer is valid so long as
+    /// *this is alive.
+    const uint8_t *data()
+    {
+        return mapData_;
+    }
+
+    /// @return the number of bytes in the mapping (including the terminator,
+    /// if any).
+    size_t size()
+    {
+        return mapLen_;
+    }
+
+protected:
+    /// Creates an empty mapping. Used by subclasses that produce the data
+    /// themselves.
+    MappedFile()
+    {
+    }
+
+    /// Maps a file into memory.
+    /// @param name is the path of the file.
+    /// @param add_terminator if true, a zero byte is appended after the file
+    /// contents.
+    MappedFile(const char *name, bool add_terminator);
+
+    ~MappedFile()
+    {
+        release();
+    }
+
+    /// Allocates zero-filled anonymous memory pages for the data. Sets
+    /// mapLen_.
+    /// @param len is the number of bytes needed.
+    /// @param prot is the page protection to set.
+    /// @return true on success.
+    bool alloc_region(size_t len, int prot);
+
+    /// Unmaps all memory and clears the data.
+    void release();
+
+    /// Start of the data, or nullptr if the mapping failed.
+    const uint8_t *mapData_{nullptr};
+    /// Number of bytes of data (including the terminator, if any).
+    size_t mapLen_{0};
+    /// Start of the mapped region.
+    void *region_{nullptr};
+    /// Length of the mapped region in bytes (page size multiple).
+    size_t regionLen_{0};
+};
+
+/// Read-only memory space exporting the contents of a file, without copying
+/// the file into the heap. The file is memory-mapped, so the reads of the
+/// memory space copy the data straight from the page cache into the outgoing
+/// datagram or stream buffers. This is intended for serving large CDI or FDI
+/// XML files on hosted platforms, for example the .xmlout file written by
+/// CompileCdiMain with -r.
+///
+/// For gzip compressed files see @ref GzipMemoryBlock.
+class MmapMemoryBlock : private MappedFile, public ReadOnlyMemoryBlock
+{
+public:
+    /// Creates a memory block from a file. If the file cannot be opened or
+    /// mapped, logs a warning and the memory space will be empty.
+    ///
+    /// @param name is the path of the file to serve.
+    /// @param add_terminator if true, the memory space will have a zero byte
+    /// after the file contents. CDI memory spaces need this.
+    MmapMemoryBlock(const char *name, bool add_terminator = true)
+        : MappedFile(name, add_terminator)
+        , ReadOnlyMemoryBlock(mapData_, mapLen_)
+    {
+    }
+
+    using MappedFile::valid;
+    using MappedFile::data;
+    using MappedFile::size;
+};
+
+} // namespace openlcb
+
+#endif // __linux__ || __MACH__
+
+#endif // _OPENLCB_MMAPMEMORYBLOCK_HXX_
@@ -81,6 +81,7 @@ public:
     {
         // Mismatched sizing of the GPIO array from the configuration array.
         HASSERT(size == N);
+        set_config_range(config);
         ConfigUpdateService::instance()->register_update_listener(this);
     }
 
@@ -135,6 +135,7 @@ public:
     {
         // Mismatched sizing of the GPIO array from the configuration array.
         HASSERT(size == N);
+        set_config_range(config);
         ConfigUpdateService::instance()->register_update_listener(this);
         producedEvents_ = new EventId[size * 2];
         std::allocator<debouncer_type> alloc;
@@ -26,6 +26,7 @@ public:
         , consumer_(&gpioImpl_) // don't connect consumer to PWM yet
         , cfg_(cfg)
     {
+        set_config_range(cfg);
     }
 
     UpdateAction apply_configuration(
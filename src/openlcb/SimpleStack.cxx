@@ -140,7 +140,7 @@ void SimpleStackBase::default_start_node()
     }
 #if (!defined(ARDUINO)) || defined(ESP32)
     {
-        auto *space = new FileMemorySpace(
+        auto *space = create_file_space(
             SNIP_DYNAMIC_FILENAME, sizeof(SimpleNodeDynamicValues));
         memoryConfigHandler_.registry()->insert(
             node(), MemoryConfigDefs::SPACE_ACDI_USR, space);
@@ -159,7 +159,7 @@ void SimpleStackBase::default_start_node()
 #if (!defined(ARDUINO)) || defined(ESP32)
     if (CONFIG_FILENAME != nullptr)
     {
-        auto *space = new FileMemorySpace(CONFIG_FILENAME, CONFIG_FILE_SIZE);
+        auto *space = create_file_space(CONFIG_FILENAME, CONFIG_FILE_SIZE);
         memory_config_handler()->registry()->insert(
             node(), openlcb::MemoryConfigDefs::SPACE_CONFIG, space);
         additionalComponents_.emplace_back(space);
@@ -228,6 +228,27 @@ void SimpleStackBase::restart_stack()
     new ReinitAllNodes(iface());
 }
 
+FileMemorySpace *SimpleStackBase::create_file_space(
+    const char *name, size_t len)
+{
+#if defined(__linux__)
+    if (logConfigFile_ && name == CONFIG_FILENAME)
+    {
+        return new FileMemorySpace(logConfigFile_->fd(), len);
+    }
+#endif
+    return new FileMemorySpace(name, len);
+}
+
+#if defined(__linux__)
+void SimpleStackBase::use_log_structured_config_file()
+{
+    HASSERT(CONFIG_FILENAME);
+    logConfigFile_.reset(new LogStructuredConfigFile(CONFIG_FILENAME));
+    configUpdateFlow_.set_fd(logConfigFile_->fd());
+}
+#endif
+
 int SimpleStackBase::create_config_file_if_needed(const InternalConfigData &cfg,
     uint16_t expected_version, unsigned file_size)
 {
@@ -48,6 +48,7 @@
 #include "openlcb/EventHandlerTemplates.hxx"
 #include "openlcb/EventService.hxx"
 #include "openlcb/IfCan.hxx"
+#include "openlcb/LogStructuredConfigFile.hxx"
 #include "openlcb/MemoryConfig.hxx"
 #include "openlcb/NodeInitializeFlow.hxx"
 #include "openlcb/ProtocolIdentification.hxx"
@@ -205,6 +206,15 @@ public:
     int check_version_and_factory_reset(const InternalConfigData &ofs,
         uint16_t expected_version, bool force = false);
 
+#if defined(__linux__)
+    /// Stores the config file as a snapshot at CONFIG_FILENAME and an
+    /// append-only log of changes (see @ref LogStructuredConfigFile). The
+    /// changes are persisted upon every configuration update. Must be called
+    /// before create_config_file_if_needed or
+    /// check_version_and_factory_reset.
+    void use_log_structured_config_file();
+#endif
+
     /// Overwrites all events in the eeprom with a brand new event ID.
     static void factory_reset_all_events(
         const InternalConfigData &ofs, uint64_t node_id, int fd);
@@ -289,6 +299,19 @@ protected:
     std::unique_ptr<GCAdapterBase> gcAdapter_;
     /// Stores and keeps ownership of optional components.
     std::vector<std::unique_ptr<Destructable>> additionalComponents_;
+#if defined(__linux__)
+    /// Storage of the config file, if use_log_structured_config_file was
+    /// called.
+    std::unique_ptr<LogStructuredConfigFile> logConfigFile_;
+#endif
+
+private:
+    /// Creates a memory space for a file. Uses the config file descriptor if
+    /// the file is the config file.
+    /// @param name is the file name.
+    /// @param len is the size of the memory space.
+    /// @return the new memory space.
+    FileMemorySpace *create_file_space(const char *name, size_t len);
 };
 
 /// SimpleStack with a CAN-bus based interface and IO functions for CAN-bus.
@@ -31,6 +31,9 @@
  * @date 14 December 2014
  */
 
+#ifndef _OPENLCB_STREAMDEFS_HXX_
+#define _OPENLCB_STREAMDEFS_HXX_
+
 #include "openlcb/If.hxx"
 
 namespace openlcb
@@ -41,6 +44,19 @@ struct StreamDefs
 {
     static const uint16_t MAX_PAYLOAD = 0xffff;
 
+    /// Stream ID value that is not assigned to any stream.
+    static const uint8_t INVALID_STREAM_ID = 0xff;
+
+    /// Buffer size that a receiver offers if the caller does not specify
+    /// anything. Two windows of this size may be held by the receiver at any
+    /// given time.
+    static const uint16_t DEFAULT_BUFFER_SIZE = 1008;
+
+    /// Maximum number of data bytes that we put into a single stream data
+    /// message. Multiple of 7 to fill every CAN frame, and keeps the payload
+    /// below 256 bytes, which is the limit of the CAN fragmentation code.
+    static const unsigned MAX_DATA_PER_MESSAGE = 252;
+
     enum Flags
     {
         FLAG_CARRIES_ID = 0x01,
@@ -59,9 +75,15 @@ struct StreamDefs
         REJECT_TEMPORARY_OUT_OF_ORDER = 0x40,
     };
 
+    /// Creates the payload of a stream initiate request message.
+    /// @param max_buffer_size proposed buffer size
+    /// @param has_ident true if the stream will carry a content UID
+    /// @param src_stream_id local stream ID of the sender
+    /// @param dst_stream_id proposed stream ID at the receiver;
+    /// INVALID_STREAM_ID to leave it to the receiver
     static Payload create_initiate_request(uint16_t max_buffer_size,
-                                           bool has_ident,
-                                           uint8_t src_stream_id)
+        bool has_ident, uint8_t src_stream_id,
+        uint8_t dst_stream_id = INVALID_STREAM_ID)
     {
         Payload p(5, 0);
         p[0] = max_buffer_size >> 8;
@@ -69,6 +91,40 @@ struct StreamDefs
         p[2] = has_ident ? FLAG_CARRIES_ID : 0;
         p[3] = 0;
         p[4] = src_stream_id;
+        if (dst_stream_id != INVALID_STREAM_ID)
+        {
+            p.push_back(dst_stream_id);
+        }
+        return p;
+    }
+
+    /// Creates the payload of a stream initiate reply message.
+    /// @param max_buffer_size the negotiated buffer size (zero if rejected)
+    /// @param src_stream_id stream ID of the sender (copied from the request)
+    /// @param dst_stream_id local stream ID of the receiver
+    /// @param flags FLAG_ACCEPT, or the error flags for a rejection
+    /// @param additional_flags the detailed rejection reason
+    static Payload create_initiate_response(uint16_t max_buffer_size,
+        uint8_t src_stream_id, uint8_t dst_stream_id,
+        uint8_t flags = FLAG_ACCEPT, uint8_t additional_flags = 0)
+    {
+        Payload p(6, 0);
+        p[0] = max_buffer_size >> 8;
+        p[1] = max_buffer_size & 0xff;
+        p[2] = flags;
+        p[3] = additional_flags;
+        p[4] = src_stream_id;
+        p[5] = dst_stream_id;
+        return p;
+    }
+
+    /// Creates the payload of a stream data proceed message.
+    static Payload create_data_proceed(
+        uint8_t src_stream_id, uint8_t dst_stream_id)
+    {
+        Payload p(4, 0);
+        p[0] = src_stream_id;
+        p[1] = dst_stream_id;
         return p;
     }
 
@@ -82,3 +138,5 @@ struct StreamDefs
 };
 
 } // namespace openlcb
+
+#endif // _OPENLCB_STREAMDEFS_HXX_
@@ -0,0 +1,680 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file StreamTransport.cxx
+ *
+ * Implementation of the OpenLCB Stream Transport protocol: stream ID
+ * management, flow-controlled receiver and sender flows.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "openlcb/StreamTransport.hxx"
+
+#include <algorithm>
+
+#include "openlcb/MemoryConfig.hxx"
+
+namespace openlcb
+{
+
+/// The stream MTIs that the transport registers on the dispatcher.
+static const Defs::MTI STREAM_MTIS[] = {
+    Defs::MTI_STREAM_INITIATE_REQUEST, Defs::MTI_STREAM_INITIATE_REPLY,
+    Defs::MTI_STREAM_DATA, Defs::MTI_STREAM_PROCEED,
+    Defs::MTI_STREAM_COMPLETE};
+
+StreamTransport::StreamTransport(If *iface)
+    : iface_(iface)
+{
+    memset(usedIds_, 0, sizeof(usedIds_));
+    // The invalid stream ID may never be handed out.
+    usedIds_[StreamDefs::INVALID_STREAM_ID >> 5] |=
+        1u << (StreamDefs::INVALID_STREAM_ID & 31);
+    for (auto mti : STREAM_MTIS)
+    {
+        iface_->dispatcher()->register_handler(&handler_, mti, Defs::MTI_EXACT);
+    }
+}
+
+StreamTransport::~StreamTransport()
+{
+    for (auto mti : STREAM_MTIS)
+    {
+        iface_->dispatcher()->unregister_handler(
+            &handler_, mti, Defs::MTI_EXACT);
+    }
+}
+
+uint8_t StreamTransport::allocate_id()
+{
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        uint8_t id = nextId_++;
+        if (!(usedIds_[id >> 5] & (1u << (id & 31))))
+        {
+            usedIds_[id >> 5] |= 1u << (id & 31);
+            return id;
+        }
+    }
+    return StreamDefs::INVALID_STREAM_ID;
+}
+
+void StreamTransport::free_id(uint8_t id)
+{
+    HASSERT(id != StreamDefs::INVALID_STREAM_ID);
+    usedIds_[id >> 5] &= ~(1u << (id & 31));
+}
+
+uint8_t StreamTransport::register_receiver(StreamReceiver *r)
+{
+    uint8_t id = allocate_id();
+    if (id != StreamDefs::INVALID_STREAM_ID)
+    {
+        receivers_.push_back(r);
+    }
+    return id;
+}
+
+void StreamTransport::unregister_receiver(StreamReceiver *r)
+{
+    auto it = std::find(receivers_.begin(), receivers_.end(), r);
+    if (it != receivers_.end())
+    {
+        receivers_.erase(it);
+        free_id(r->local_stream_id());
+    }
+}
+
+uint8_t StreamTransport::register_sender(StreamSender *s)
+{
+    uint8_t id = allocate_id();
+    if (id != StreamDefs::INVALID_STREAM_ID)
+    {
+        senders_.push_back(s);
+    }
+    return id;
+}
+
+void StreamTransport::unregister_sender(StreamSender *s)
+{
+    auto it = std::find(senders_.begin(), senders_.end(), s);
+    if (it != senders_.end())
+    {
+        senders_.erase(it);
+        free_id(s->local_stream_id());
+    }
+}
+
+StreamReceiver *StreamTransport::find_receiver(Node *dst, uint8_t local_id)
+{
+    for (auto *r : receivers_)
+    {
+        if (r->localId_ == local_id && r->node_ == dst)
+        {
+            return r;
+        }
+    }
+    return nullptr;
+}
+
+StreamSender *StreamTransport::find_sender(Node *dst, uint8_t local_id)
+{
+    for (auto *s : senders_)
+    {
+        if (s->localId_ == local_id && s->request()->src == dst)
+        {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+void StreamTransport::send_message(
+    Defs::MTI mti, Node *src, NodeHandle dst, const Payload &payload)
+{
+    auto *b = iface_->addressed_message_write_flow()->alloc();
+    b->data()->reset(mti, src->node_id(), dst, payload);
+    iface_->addressed_message_write_flow()->send(b);
+}
+
+void StreamTransport::reject_initiate(GenMessage *m)
+{
+    LOG(INFO,
+        "Stream: rejecting unexpected initiate request from %012" PRIx64
+        " src stream %02x",
+        m->src.id, (uint8_t)m->payload[4]);
+    send_message(Defs::MTI_STREAM_INITIATE_REPLY, m->dstNode, m->src,
+        StreamDefs::create_initiate_response(0, m->payload[4],
+            StreamDefs::INVALID_STREAM_ID, StreamDefs::FLAG_PERMANENT_ERROR,
+            StreamDefs::REJECT_PERMANENT_INVALID_REQUEST));
+}
+
+void StreamTransport::handle_message(Buffer<GenMessage> *message)
+{
+    GenMessage *m = message->data();
+    const uint8_t *bytes = (const uint8_t *)m->payload.data();
+    size_t len = m->payload.size();
+    if (!m->dstNode)
+    {
+        message->unref();
+        return;
+    }
+    switch (m->mti)
+    {
+        case Defs::MTI_STREAM_INITIATE_REQUEST:
+        {
+            if (len < 5)
+            {
+                break;
+            }
+            for (auto *r : receivers_)
+            {
+                if (r->matches_initiate(m))
+                {
+                    r->send(message);
+                    return;
+                }
+            }
+            reject_initiate(m);
+            break;
+        }
+        case Defs::MTI_STREAM_DATA:
+        {
+            StreamReceiver *r;
+            if (len >= 1 && (r = find_receiver(m->dstNode, bytes[0])))
+            {
+                r->send(message);
+                return;
+            }
+            break;
+        }
+        case Defs::MTI_STREAM_COMPLETE:
+        {
+            StreamReceiver *r;
+            if (len >= 2 && (r = find_receiver(m->dstNode, bytes[1])))
+            {
+                r->send(message);
+                return;
+            }
+            break;
+        }
+        case Defs::MTI_STREAM_INITIATE_REPLY:
+        {
+            StreamSender *s;
+            if (len >= 6 && (s = find_sender(m->dstNode, bytes[4])))
+            {
+                s->initiate_reply_received(message);
+                return;
+            }
+            break;
+        }
+        case Defs::MTI_STREAM_PROCEED:
+        {
+            StreamSender *s;
+            if (len >= 2 && (s = find_sender(m->dstNode, bytes[0])))
+            {
+                s->proceed_received(message);
+                return;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    message->unref();
+}
+
+//
+// StreamReceiver
+//
+
+void StreamReceiver::WindowNotifiable::notify()
+{
+    Notifiable *n;
+    {
+        AtomicHolder h(this);
+        done_ = true;
+        n = waiter_;
+        waiter_ = nullptr;
+    }
+    if (n)
+    {
+        n->notify();
+    }
+}
+
+void StreamReceiver::WindowNotifiable::reset()
+{
+    AtomicHolder h(this);
+    done_ = false;
+    waiter_ = nullptr;
+}
+
+bool StreamReceiver::WindowNotifiable::check_or_wait(Notifiable *n)
+{
+    AtomicHolder h(this);
+    if (done_)
+    {
+        return true;
+    }
+    waiter_ = n;
+    return false;
+}
+
+StreamReceiver::StreamReceiver(StreamTransport *transport)
+    : StateFlow<Buffer<GenMessage>, QList<1>>(transport->iface())
+    , transport_(transport)
+    , curWindow_(0)
+    , waiting_(0)
+{
+}
+
+StreamReceiver::~StreamReceiver()
+{
+    cancel();
+}
+
+uint8_t StreamReceiver::start(Node *dst, NodeHandle src, uint8_t src_stream_id,
+    MessageHandler *sink, uint16_t max_buffer_size)
+{
+    if (state_ != STATE_IDLE || waiting_ || !windows_[0].is_done() ||
+        !windows_[1].is_done())
+    {
+        // Still busy with the previous stream.
+        return StreamDefs::INVALID_STREAM_ID;
+    }
+    localId_ = transport_->register_receiver(this);
+    if (localId_ == StreamDefs::INVALID_STREAM_ID)
+    {
+        return localId_;
+    }
+    node_ = dst;
+    remote_ = src;
+    srcStreamId_ = src_stream_id;
+    sink_ = sink;
+    maxBufferSize_ = max_buffer_size;
+    bytesReceived_ = 0;
+    state_ = STATE_WAIT_INITIATE;
+    return localId_;
+}
+
+void StreamReceiver::cancel()
+{
+    if (state_ != STATE_IDLE)
+    {
+        close();
+    }
+}
+
+void StreamReceiver::close()
+{
+    transport_->unregister_receiver(this);
+    if (state_ == STATE_OPEN && !waiting_)
+    {
+        windows_[curWindow_].maybe_done();
+    }
+    state_ = STATE_IDLE;
+}
+
+bool StreamReceiver::matches_initiate(GenMessage *m)
+{
+    if (state_ != STATE_WAIT_INITIATE || m->dstNode != node_)
+    {
+        return false;
+    }
+    const Payload &p = m->payload;
+    if (p.size() > 5 && (uint8_t)p[5] == localId_)
+    {
+        // The sender proposed our stream ID.
+        return true;
+    }
+    if (!remote_.id && !remote_.alias)
+    {
+        return srcStreamId_ == (uint8_t)p[4];
+    }
+    if (!transport_->iface()->matching_node(remote_, m->src))
+    {
+        return false;
+    }
+    return srcStreamId_ == StreamDefs::INVALID_STREAM_ID ||
+        srcStreamId_ == (uint8_t)p[4];
+}
+
+StateFlowBase::Action StreamReceiver::entry()
+{
+    switch (message()->data()->mti)
+    {
+        case Defs::MTI_STREAM_INITIATE_REQUEST:
+            return handle_initiate();
+        case Defs::MTI_STREAM_DATA:
+            return handle_data();
+        case Defs::MTI_STREAM_COMPLETE:
+            return handle_complete();
+        default:
+            return release_and_exit();
+    }
+}
+
+StateFlowBase::Action StreamReceiver::handle_initiate()
+{
+    if (state_ != STATE_WAIT_INITIATE)
+    {
+        return release_and_exit();
+    }
+    GenMessage *m = message()->data();
+    const uint8_t *bytes = (const uint8_t *)m->payload.data();
+    uint16_t proposed = (bytes[0] << 8) | bytes[1];
+    remote_ = m->src;
+    srcStreamId_ = bytes[4];
+    if (!proposed)
+    {
+        transport_->send_message(Defs::MTI_STREAM_INITIATE_REPLY, node_,
+            remote_,
+            StreamDefs::create_initiate_response(0, srcStreamId_, localId_,
+                StreamDefs::FLAG_PERMANENT_ERROR,
+                StreamDefs::REJECT_PERMANENT_INVALID_REQUEST));
+        close();
+        return release_and_exit();
+    }
+    windowSize_ = std::min(proposed, maxBufferSize_);
+    windowRemaining_ = windowSize_;
+    curWindow_ = 0;
+    windowDone_[0].reset();
+    windows_[0].reset(&windowDone_[0]);
+    state_ = STATE_OPEN;
+    transport_->send_message(Defs::MTI_STREAM_INITIATE_REPLY, node_, remote_,
+        StreamDefs::create_initiate_response(
+            windowSize_, srcStreamId_, localId_));
+    return release_and_exit();
+}
+
+StateFlowBase::Action StreamReceiver::handle_data()
+{
+    if (state_ != STATE_OPEN)
+    {
+        return release_and_exit();
+    }
+    unsigned len = message()->data()->payload.size() - 1;
+    if (len > windowRemaining_)
+    {
+        LOG(WARNING,
+            "Stream %02x: sender overran the window by %u bytes.", localId_,
+            len - windowRemaining_);
+        len = windowRemaining_;
+    }
+    windowRemaining_ -= len;
+    bytesReceived_ += message()->data()->payload.size() - 1;
+    message()->set_done(windows_[curWindow_].new_child());
+    sink_->send(transfer_message());
+    if (windowRemaining_ == 0)
+    {
+        return call_immediately(STATE(window_full));
+    }
+    return exit();
+}
+
+StateFlowBase::Action StreamReceiver::window_full()
+{
+    windows_[curWindow_].maybe_done();
+    waiting_ = 1;
+    if (windowDone_[curWindow_ ^ 1].check_or_wait(this))
+    {
+        return call_immediately(STATE(send_proceed));
+    }
+    return wait_and_call(STATE(send_proceed));
+}
+
+StateFlowBase::Action StreamReceiver::send_proceed()
+{
+    waiting_ = 0;
+    if (state_ != STATE_OPEN)
+    {
+        return exit();
+    }
+    curWindow_ ^= 1;
+    windowDone_[curWindow_].reset();
+    windows_[curWindow_].reset(&windowDone_[curWindow_]);
+    windowRemaining_ = windowSize_;
+    transport_->send_message(Defs::MTI_STREAM_PROCEED, node_, remote_,
+        StreamDefs::create_data_proceed(srcStreamId_, localId_));
+    return exit();
+}
+
+StateFlowBase::Action StreamReceiver::handle_complete()
+{
+    const uint8_t *bytes = (const uint8_t *)message()->data()->payload.data();
+    if (state_ != STATE_OPEN || bytes[0] != srcStreamId_)
+    {
+        return release_and_exit();
+    }
+    sink_->send(transfer_message());
+    close();
+    return exit();
+}
+
+//
+// StreamSender
+//
+
+long long StreamSender::TIMEOUT_NSEC = SEC_TO_NSEC(5);
+
+StreamSender::StreamSender(StreamTransport *transport)
+    : CallableFlow<StreamSendRequest>(transport->iface())
+    , transport_(transport)
+    , replied_(0)
+    , sleeping_(0)
+{
+}
+
+StreamSender::~StreamSender()
+{
+}
+
+StateFlowBase::Action StreamSender::entry()
+{
+    errorCode_ = 0;
+    replied_ = 0;
+    credit_ = 0;
+    bufferSize_ = 0;
+    remoteId_ = request()->dstStreamId;
+    localId_ = transport_->register_sender(this);
+    if (localId_ == StreamDefs::INVALID_STREAM_ID)
+    {
+        return return_with_error(Defs::ERROR_TEMPORARY);
+    }
+    transport_->send_message(Defs::MTI_STREAM_INITIATE_REQUEST,
+        request()->src, request()->dst,
+        StreamDefs::create_initiate_request(
+            request()->maxBufferSize, false, localId_, remoteId_));
+    sleeping_ = 1;
+    return sleep_and_call(&timer_, TIMEOUT_NSEC, STATE(initiate_done));
+}
+
+void StreamSender::initiate_reply_received(Buffer<GenMessage> *message)
+{
+    GenMessage *m = message->data();
+    if (replied_ ||
+        !transport_->iface()->matching_node(request()->dst, m->src))
+    {
+        return message->unref();
+    }
+    const uint8_t *bytes = (const uint8_t *)m->payload.data();
+    replied_ = 1;
+    bufferSize_ = (bytes[0] << 8) | bytes[1];
+    remoteId_ = bytes[5];
+    if (!(bytes[2] & StreamDefs::FLAG_ACCEPT))
+    {
+        errorCode_ = ((bytes[2] & StreamDefs::FLAG_PERMANENT_ERROR)
+                             ? Defs::ERROR_PERMANENT
+                             : Defs::ERROR_TEMPORARY) |
+            bytes[3];
+        bufferSize_ = 0;
+    }
+    else if (!bufferSize_)
+    {
+        errorCode_ = Defs::ERROR_PERMANENT;
+    }
+    credit_ = bufferSize_;
+    // Saves the alias of the remote node for the data messages.
+    if (m->src.alias)
+    {
+        request()->dst.alias = m->src.alias;
+    }
+    message->unref();
+    if (sleeping_)
+    {
+        timer_.trigger();
+    }
+}
+
+void StreamSender::proceed_received(Buffer<GenMessage> *message)
+{
+    // Only the receiving node may grant more credit.
+    if (replied_ && !errorCode_ &&
+        transport_->iface()->matching_node(
+            request()->dst, message->data()->src))
+    {
+        credit_ += bufferSize_;
+        if (sleeping_)
+        {
+            timer_.trigger();
+        }
+    }
+    message->unref();
+}
+
+StateFlowBase::Action StreamSender::initiate_done()
+{
+    sleeping_ = 0;
+    if (!replied_)
+    {
+        LOG(INFO, "Stream %02x: no reply to initiate request.", localId_);
+        transport_->unregister_sender(this);
+        return return_with_error(Defs::OPENMRN_TIMEOUT);
+    }
+    if (errorCode_)
+    {
+        LOG(INFO, "Stream %02x: initiate request rejected: %04x", localId_,
+            errorCode_);
+        transport_->unregister_sender(this);
+        return return_with_error(errorCode_);
+    }
+    return call_immediately(STATE(send_next));
+}
+
+StateFlowBase::Action StreamSender::send_next()
+{
+    if (request()->bytesSent >= request()->length)
+    {
+        return call_immediately(STATE(close_stream));
+    }
+    if (!credit_)
+    {
+        sleeping_ = 1;
+        return sleep_and_call(&timer_, TIMEOUT_NSEC, STATE(proceed_wait_done));
+    }
+    return allocate_and_call(
+        transport_->iface()->addressed_message_write_flow(), STATE(fill_data));
+}
+
+StateFlowBase::Action StreamSender::proceed_wait_done()
+{
+    sleeping_ = 0;
+    if (!credit_)
+    {
+        LOG(INFO, "Stream %02x: timeout waiting for proceed.", localId_);
+        errorCode_ = Defs::OPENMRN_TIMEOUT;
+        return call_immediately(STATE(close_stream));
+    }
+    return call_immediately(STATE(send_next));
+}
+
+StateFlowBase::Action StreamSender::fill_data()
+{
+    pending_ = get_allocation_result(
+        transport_->iface()->addressed_message_write_flow());
+    uint32_t len = std::min(credit_, request()->length - request()->bytesSent);
+    len = std::min(len, (uint32_t)StreamDefs::MAX_DATA_PER_MESSAGE);
+    chunkLen_ = len;
+    chunkFilled_ = 0;
+    pending_->data()->reset(Defs::MTI_STREAM_DATA, request()->src->node_id(),
+        request()->dst, EMPTY_PAYLOAD);
+    pending_->data()->payload.resize(len + 1);
+    pending_->data()->payload[0] = remoteId_;
+    return call_immediately(STATE(read_data));
+}
+
+StateFlowBase::Action StreamSender::read_data()
+{
+    MemorySpace::errorcode_t error = 0;
+    uint8_t *dst = (uint8_t *)&pending_->data()->payload[1];
+    size_t n = request()->space->read(
+        request()->offset + request()->bytesSent + chunkFilled_,
+        dst + chunkFilled_, chunkLen_ - chunkFilled_, &error, this);
+    chunkFilled_ += n;
+    if (error == MemorySpace::ERROR_AGAIN)
+    {
+        return wait();
+    }
+    if (!error && chunkFilled_ < chunkLen_)
+    {
+        return again();
+    }
+    if (error)
+    {
+        // Stops at the end of the space (or any other error) after sending
+        // the data we got so far.
+        request()->length = request()->bytesSent + chunkFilled_;
+        if (error != MemoryConfigDefs::ERROR_OUT_OF_BOUNDS)
+        {
+            errorCode_ = error;
+        }
+    }
+    if (!chunkFilled_)
+    {
+        pending_->unref();
+        pending_ = nullptr;
+        return call_immediately(STATE(close_stream));
+    }
+    pending_->data()->payload.resize(chunkFilled_ + 1);
+    credit_ -= chunkFilled_;
+    request()->bytesSent += chunkFilled_;
+    transport_->iface()->addressed_message_write_flow()->send(pending_);
+    pending_ = nullptr;
+    return call_immediately(STATE(send_next));
+}
+
+StateFlowBase::Action StreamSender::close_stream()
+{
+    transport_->send_message(Defs::MTI_STREAM_COMPLETE, request()->src,
+        request()->dst, StreamDefs::create_close_request(localId_, remoteId_));
+    transport_->unregister_sender(this);
+    return return_with_error(errorCode_);
+}
+
+} // namespace openlcb
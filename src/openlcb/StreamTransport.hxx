@@ -0,0 +1,371 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file StreamTransport.hxx
+ *
+ * Implementation of the OpenLCB Stream Transport protocol: stream ID
+ * management, flow-controlled receiver and sender flows.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _OPENLCB_STREAMTRANSPORT_HXX_
+#define _OPENLCB_STREAMTRANSPORT_HXX_
+
+#include <vector>
+
+#include "executor/CallableFlow.hxx"
+#include "openlcb/If.hxx"
+#include "openlcb/StreamDefs.hxx"
+#include "utils/Atomic.hxx"
+
+namespace openlcb
+{
+
+class MemorySpace;
+class StreamReceiver;
+class StreamSender;
+
+/// Stream transport service for one interface. Owns the registration of the
+/// stream MTIs on the interface dispatcher, allocates the local stream IDs,
+/// and routes the incoming stream messages to the active StreamReceiver and
+/// StreamSender objects.
+///
+/// All methods must be called on the interface's executor.
+class StreamTransport
+{
+public:
+    /// Constructor. @param iface is the interface to send and receive stream
+    /// messages on.
+    StreamTransport(If *iface);
+    ~StreamTransport();
+
+    /// @return the interface this service is bound to.
+    If *iface()
+    {
+        return iface_;
+    }
+
+    /// Registers a receiver and allocates a stream ID for it.
+    /// @return the allocated local stream ID, or INVALID_STREAM_ID if all
+    /// stream IDs are in use.
+    uint8_t register_receiver(StreamReceiver *r);
+    /// Removes a receiver and releases its stream ID.
+    void unregister_receiver(StreamReceiver *r);
+
+    /// Registers a sender and allocates a stream ID for it.
+    /// @return the allocated local stream ID, or INVALID_STREAM_ID if all
+    /// stream IDs are in use.
+    uint8_t register_sender(StreamSender *s);
+    /// Removes a sender and releases its stream ID.
+    void unregister_sender(StreamSender *s);
+
+    /// Sends a stream control message. The buffer is allocated synchronously.
+    /// @param mti the message type
+    /// @param src local node
+    /// @param dst remote node
+    /// @param payload message contents
+    void send_message(
+        Defs::MTI mti, Node *src, NodeHandle dst, const Payload &payload);
+
+private:
+    /// Callback from the interface dispatcher with all stream messages.
+    void handle_message(Buffer<GenMessage> *message);
+
+    /// Sends a reject response to an initiate request that no receiver was
+    /// waiting for.
+    void reject_initiate(GenMessage *m);
+
+    /// @return a free stream ID, or INVALID_STREAM_ID.
+    uint8_t allocate_id();
+    /// Returns a stream ID to the free pool.
+    void free_id(uint8_t id);
+
+    /// Finds an active receiver by its local stream ID.
+    StreamReceiver *find_receiver(Node *dst, uint8_t local_id);
+    /// Finds an active sender by its local stream ID.
+    StreamSender *find_sender(Node *dst, uint8_t local_id);
+
+    /// Interface we are bound to.
+    If *iface_;
+    /// Receivers that are waiting for or handling an incoming stream.
+    std::vector<StreamReceiver *> receivers_;
+    /// Senders that have a stream open.
+    std::vector<StreamSender *> senders_;
+    /// One bit for every stream ID: 1 if used.
+    uint32_t usedIds_[8];
+    /// Where to start searching for the next free stream ID. Rotates to avoid
+    /// reusing the ID of a stream that was just closed.
+    uint8_t nextId_{0};
+    /// Dispatcher registration.
+    MessageHandler::GenericHandler handler_{
+        this, &StreamTransport::handle_message};
+};
+
+/// Receives one stream at a time and hands the data to a sink flow.
+///
+/// Each incoming Stream Data message buffer is forwarded to the sink as-is
+/// (the stream bytes start at payload offset 1), so no data is copied. At
+/// the end of the stream the Stream Complete message is forwarded to the
+/// sink as well.
+///
+/// Flow control: the receiver tracks the buffers of each window using a
+/// BarrierNotifiable. The Proceed message for a window is sent when that
+/// window has been fully received and the sink released all buffers of the
+/// previous window. Thus at most two windows of data are held in memory.
+class StreamReceiver : public StateFlow<Buffer<GenMessage>, QList<1>>
+{
+public:
+    /// Constructor. @param transport is the stream service to register with.
+    StreamReceiver(StreamTransport *transport);
+    ~StreamReceiver();
+
+    /// Starts waiting for an incoming stream. Must be called on the
+    /// interface executor.
+    /// @param dst the local node that will receive the stream
+    /// @param src the node that will send the stream; if empty, any node is
+    /// accepted.
+    /// @param src_stream_id the stream ID at the sender, or INVALID_STREAM_ID
+    /// if not known (then only requests that propose our stream ID will be
+    /// accepted, unless src is also specified).
+    /// @param sink will get all stream data messages and the stream complete
+    /// message.
+    /// @param max_buffer_size the largest window to offer to the sender.
+    /// @return the local stream ID, or INVALID_STREAM_ID if the receiver is
+    /// busy or no stream ID is available.
+    uint8_t start(Node *dst, NodeHandle src, uint8_t src_stream_id,
+        MessageHandler *sink,
+        uint16_t max_buffer_size = StreamDefs::DEFAULT_BUFFER_SIZE);
+
+    /// Stops waiting for or receiving the current stream. The sink will not
+    /// get a stream complete message. Must be called on the interface
+    /// executor.
+    void cancel();
+
+    /// @return true if a stream is being awaited or received.
+    bool is_active()
+    {
+        return state_ != STATE_IDLE;
+    }
+
+    /// @return the local stream ID.
+    uint8_t local_stream_id()
+    {
+        return localId_;
+    }
+
+    /// @return the number of stream bytes received in the current (or last)
+    /// stream.
+    uint32_t bytes_received()
+    {
+        return bytesReceived_;
+    }
+
+private:
+    friend class StreamTransport;
+
+    /// Gets notified when all buffers of a window are released. Forwards
+    /// the notification to the receiver flow when it is waiting for it.
+    class WindowNotifiable : public Notifiable, private Atomic
+    {
+    public:
+        void notify() override;
+        /// Re-arms this notifiable for a new window.
+        void reset();
+        /// @return true if the window is already released. Otherwise
+        /// registers n to be notified when that happens.
+        bool check_or_wait(Notifiable *n);
+
+    private:
+        /// true if the window's barrier has completed.
+        bool done_{true};
+        /// Who to notify when the window completes.
+        Notifiable *waiter_{nullptr};
+    };
+
+    /// Called by the transport for incoming initiate requests. @return true
+    /// if this receiver wants to handle the request in m.
+    bool matches_initiate(GenMessage *m);
+
+    Action entry() override;
+    Action handle_initiate();
+    Action handle_data();
+    Action handle_complete();
+    /// The current window is fully received. Waits for the previous window
+    /// to be released by the sink.
+    Action window_full();
+    /// Opens the next window and sends the proceed message.
+    Action send_proceed();
+
+    /// Unregisters from the transport and drops the window references.
+    void close();
+
+    enum State : uint8_t
+    {
+        STATE_IDLE,
+        STATE_WAIT_INITIATE,
+        STATE_OPEN
+    };
+
+    StreamTransport *transport_;
+    /// Where to send the incoming data.
+    MessageHandler *sink_{nullptr};
+    /// Local node receiving the stream.
+    Node *node_{nullptr};
+    /// The remote node sending the stream.
+    NodeHandle remote_;
+    /// Number of bytes received in the current stream.
+    uint32_t bytesReceived_{0};
+    /// Largest window we offer.
+    uint16_t maxBufferSize_{0};
+    /// Negotiated window size.
+    uint16_t windowSize_{0};
+    /// How many bytes are still allowed in the current window.
+    uint16_t windowRemaining_{0};
+    State state_{STATE_IDLE};
+    /// Local stream ID.
+    uint8_t localId_{StreamDefs::INVALID_STREAM_ID};
+    /// Remote stream ID.
+    uint8_t srcStreamId_{StreamDefs::INVALID_STREAM_ID};
+    /// Index of the window currently being filled (0 or 1).
+    uint8_t curWindow_ : 1;
+    /// True if the flow is waiting for a window to be released.
+    uint8_t waiting_ : 1;
+    /// Tracks the data buffers of the two alternating windows.
+    BarrierNotifiable windows_[2];
+    /// Completion notification for the windows_ barriers.
+    WindowNotifiable windowDone_[2];
+};
+
+/// Request structure for the StreamSender flow. The data to send is read
+/// from a memory space.
+struct StreamSendRequest : public CallableFlowRequestBase
+{
+    /// Sets up a stream send request.
+    /// @param src local node to send from
+    /// @param dst remote node to send to
+    /// @param space memory space to take the data from
+    /// @param offset address of the first byte within space
+    /// @param length number of bytes to send; the stream is closed early if
+    /// the end of the memory space is reached
+    /// @param dst_stream_id stream ID at the receiver, if known
+    /// @param max_buffer_size largest window to propose
+    void reset(Node *src, NodeHandle dst, MemorySpace *space, uint32_t offset,
+        uint32_t length, uint8_t dst_stream_id = StreamDefs::INVALID_STREAM_ID,
+        uint16_t max_buffer_size = StreamDefs::MAX_PAYLOAD)
+    {
+        reset_base();
+        this->src = src;
+        this->dst = dst;
+        this->space = space;
+        this->offset = offset;
+        this->length = length;
+        dstStreamId = dst_stream_id;
+        maxBufferSize = max_buffer_size;
+        bytesSent = 0;
+    }
+
+    /// Local node.
+    Node *src;
+    /// Remote node.
+    NodeHandle dst;
+    /// Data source.
+    MemorySpace *space;
+    /// Starting address in space.
+    uint32_t offset;
+    /// How many bytes to send.
+    uint32_t length;
+    /// Output: how many bytes were sent.
+    uint32_t bytesSent;
+    /// Proposed buffer size.
+    uint16_t maxBufferSize;
+    /// Stream ID at the receiver.
+    uint8_t dstStreamId;
+};
+
+/// Sends a block of data from a memory space over a stream. The data is read
+/// from the memory space directly into the outgoing message buffers. Sending
+/// is throttled by the window size negotiated with the receiver.
+class StreamSender : public CallableFlow<StreamSendRequest>
+{
+public:
+    /// Constructor. @param transport is the stream service to register with.
+    StreamSender(StreamTransport *transport);
+    ~StreamSender();
+
+    /// How long to wait for the initiate reply and for each proceed message.
+    static long long TIMEOUT_NSEC;
+
+    /// @return the local stream ID of the stream being sent.
+    uint8_t local_stream_id()
+    {
+        return localId_;
+    }
+
+private:
+    friend class StreamTransport;
+
+    /// Called by the transport with an initiate reply for our stream.
+    void initiate_reply_received(Buffer<GenMessage> *message);
+    /// Called by the transport with a proceed message for our stream.
+    void proceed_received(Buffer<GenMessage> *message);
+
+    Action entry() override;
+    Action initiate_done();
+    Action send_next();
+    Action proceed_wait_done();
+    Action fill_data();
+    Action read_data();
+    Action close_stream();
+
+    StreamTransport *transport_;
+    StateFlowTimer timer_{this};
+    /// Outgoing data message being filled.
+    Buffer<GenMessage> *pending_{nullptr};
+    /// How many bytes we may send before the next proceed.
+    uint32_t credit_;
+    /// Error to return to the caller.
+    int errorCode_;
+    /// Negotiated window size.
+    uint16_t bufferSize_;
+    /// Number of bytes to put into the current data message.
+    uint16_t chunkLen_;
+    /// Number of bytes already read into the current data message.
+    uint16_t chunkFilled_;
+    /// Local stream ID.
+    uint8_t localId_{StreamDefs::INVALID_STREAM_ID};
+    /// Stream ID at the receiver.
+    uint8_t remoteId_;
+    /// 1 if the initiate reply has arrived.
+    uint8_t replied_ : 1;
+    /// 1 if the flow is sleeping on timer_.
+    uint8_t sleeping_ : 1;
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_STREAMTRANSPORT_HXX_
@@ -47,6 +47,9 @@ static const int READ_RETRY_COUNT_ON_UNKNOWN = 10;
 // Maximum time we keep trying to read or write a given CV.
 static const int RAILCOM_POM_OP_TIMEOUT_MSEC = 2000;
 
+// How long we wait for the railcom response to a single POM packet.
+static const int RAILCOM_POM_RESPONSE_TIMEOUT_MSEC = 500;
+
 
 namespace openlcb
 {
@@ -54,14 +57,19 @@ namespace openlcb
 TractionCvSpace::TractionCvSpace(MemoryConfigHandler *parent,
                                  dcc::PacketFlowInterface *track,
                                  dcc::RailcomHubFlow *railcom_hub,
-                                 uint8_t space_id)
+                                 uint8_t space_id,
+                                 unsigned pipeline_depth)
     : StateFlowBase(parent->service())
     , parent_(parent)
     , track_(track)
     , railcomHub_(railcom_hub)
     , errorCode_(ERROR_NOOP)
     , spaceId_(space_id)
+    , done_(nullptr)
     , timer_(this)
+    , pipelineDepth_(std::min(pipeline_depth, MAX_PIPELINE_DEPTH))
+    , pipelineRunning_(0)
+    , pipelineDraining_(0)
 {
     parent_->registry()->insert(nullptr, spaceId_, this);
     // We purposefully do not start the state flow until a request comes in.
@@ -70,10 +78,14 @@ TractionCvSpace::TractionCvSpace(MemoryConfigHandler *parent,
 TractionCvSpace::~TractionCvSpace()
 {
     parent_->registry()->erase(nullptr, spaceId_, this);
-    if (errorCode_ == ERROR_PENDING)
+    if (errorCode_ == ERROR_PENDING || pipelineRunning_)
     {
         timer_.cancel();
     }
+    if (pipelineRunning_)
+    {
+        railcomHub_->unregister_port(this);
+    }
 }
 
 bool TractionCvSpace::set_node(Node *node)
@@ -103,6 +115,7 @@ bool TractionCvSpace::set_node(Node *node)
 }
 
 const unsigned TractionCvSpace::MAX_CV;
+constexpr unsigned TractionCvSpace::MAX_PIPELINE_DEPTH;
 
 size_t TractionCvSpace::read(const address_t source, uint8_t *dst, size_t len,
     errorcode_t *error, Notifiable *again)
@@ -139,6 +152,15 @@ size_t TractionCvSpace::read(const address_t source, uint8_t *dst, size_t len,
         errorCode_ = ERROR_NOOP;
         return 0;
     }
+    if (pipelineDepth_ && source != OFFSET_CV_VERIFY_RESULT)
+    {
+        if (source == OFFSET_CV_VALUE)
+        {
+            len = 1;
+        }
+        return pipeline_read(cv, dst, std::min(len, size_t(MAX_CV + 1 - cv)),
+            error, again);
+    }
     if (cv == cvNumber_)
     {
         if (errorCode_ == ERROR_OK)
@@ -160,6 +182,11 @@ size_t TractionCvSpace::read(const address_t source, uint8_t *dst, size_t len,
             return 0;
         }
     }
+    if (pipeline_drain(again))
+    {
+        *error = ERROR_AGAIN;
+        return 0;
+    }
     done_ = again;
     cvNumber_ = cv;
     errorCode_ = ERROR_NOOP;
@@ -360,6 +387,12 @@ size_t TractionCvSpace::write(address_t destination, const uint8_t *src,
     if (errorCode_ == ERROR_OK && destination == cvNumber_)
     {
         errorCode_ = ERROR_NOOP;
+        if (cache_ && cache_->address == dccAddress_ &&
+            !write_invalidates_all(destination))
+        {
+            cache_->values[destination] = cvData_;
+            cache_->valid[destination] = true;
+        }
         return 1;
     }
     if (errorCode_ == _ERROR_TIMEOUT && destination == cvNumber_)
@@ -368,6 +401,22 @@ size_t TractionCvSpace::write(address_t destination, const uint8_t *src,
         errorCode_ = ERROR_NOOP;
         return 0;
     }
+    if (pipeline_drain(again))
+    {
+        *error = ERROR_AGAIN;
+        return 0;
+    }
+    if (cache_)
+    {
+        if (write_invalidates_all(destination))
+        {
+            invalidate_cache();
+        }
+        else
+        {
+            cache_->valid[destination] = false;
+        }
+    }
     done_ = again;
     cvNumber_ = destination;
     cvData_ = *src;
@@ -448,19 +497,44 @@ void TractionCvSpace::record_railcom_status(unsigned code)
 void TractionCvSpace::send(Buffer<dcc::RailcomHubData> *b, unsigned priority)
 {
     AutoReleaseBuffer<dcc::RailcomHubData> ar(b);
+    const dcc::Feedback &f = *b->data();
+    if (f.channel == 0xff)
+    {
+        // Skip the railcom-based occupancy information packets.
+        return;
+    }
+    if (f.feedbackKey >= reinterpret_cast<uintptr_t>(slots_) &&
+        f.feedbackKey < reinterpret_cast<uintptr_t>(slots_ + pipelineDepth_))
+    {
+        PomSlot *slot = reinterpret_cast<PomSlot *>(f.feedbackKey);
+        if (slot->status != ERROR_PENDING)
+        {
+            return;
+        }
+        slot->status = parse_pom_response(f, &slot->value);
+        if (slot->status != ERROR_PENDING)
+        {
+            timer_.ensure_triggered();
+        }
+        return;
+    }
     if (errorCode_ != ERROR_PENDING)
         return;
-    const dcc::Feedback &f = *b->data();
-    if (f.feedbackKey != (reinterpret_cast<uintptr_t>(this)) || f.channel == 0xff)
+    if (f.feedbackKey != (reinterpret_cast<uintptr_t>(this)))
     {
-        // Skip railcom from other packets; also skip the railcom-based
-        // occupancy information packets.
+        // Skip railcom from other packets.
         return;
     }
+    return record_railcom_status(parse_pom_response(f, &cvData_));
+}
+
+unsigned TractionCvSpace::parse_pom_response(
+    const dcc::Feedback &f, uint8_t *value)
+{
     LOG(INFO, "CV railcom feedback ch=%d: %s", f.channel, railcom_debug(f).c_str());
     if (!f.ch2Size)
     {
-        return record_railcom_status(ERROR_NO_RAILCOM_CH2_DATA);
+        return ERROR_NO_RAILCOM_CH2_DATA;
     }
     dcc::parse_railcom_data(f, &interpretedResponse_);
     unsigned new_status = ERROR_PENDING;
@@ -492,7 +566,7 @@ void TractionCvSpace::send(Buffer<dcc::RailcomHubData> *b, unsigned priority)
             }
             break;
         case dcc::RailcomPacket::MOB_POM:
-            cvData_ = e.argument;
+            *value = e.argument;
             new_status = ERROR_OK;
             break;
         default:
@@ -502,7 +576,254 @@ void TractionCvSpace::send(Buffer<dcc::RailcomHubData> *b, unsigned priority)
             break;
         }
     }
-    return record_railcom_status(new_status);
+    return new_status;
+}
+
+void TractionCvSpace::invalidate_cache()
+{
+    if (!cache_)
+    {
+        return;
+    }
+    cache_->started = os_get_time_monotonic();
+    cache_->valid.reset();
+    cache_->failed.reset();
+}
+
+size_t TractionCvSpace::pipeline_read(uint16_t cv, uint8_t *dst, size_t len,
+    errorcode_t *error, Notifiable *again)
+{
+    if (cache_ &&
+        os_get_time_monotonic() - cache_->started > CACHE_MAX_AGE_NSEC)
+    {
+        // The values may have been changed by someone else meanwhile.
+        invalidate_cache();
+    }
+    if (!cache_ || cache_->address != dccAddress_)
+    {
+        // The cache and the outstanding packets belong to a different
+        // locomotive.
+        if (pipeline_drain(again))
+        {
+            *error = ERROR_AGAIN;
+            return 0;
+        }
+        if (!cache_)
+        {
+            cache_.reset(new CvCache);
+        }
+        cache_->address = dccAddress_;
+        cache_->started = os_get_time_monotonic();
+        cache_->valid.reset();
+        cache_->failed.reset();
+    }
+    pipelineDraining_ = 0;
+    if (cache_->failed[cv])
+    {
+        cache_->failed[cv] = false;
+        *error = Defs::ERROR_OPENLCB_TIMEOUT;
+        return 0;
+    }
+    size_t count = 0;
+    while (count < len && cache_->valid[cv + count])
+    {
+        dst[count] = cache_->values[cv + count];
+        ++count;
+    }
+    // Reads ahead the CVs after the ones returned.
+    windowStart_ = cv + count;
+    windowEnd_ =
+        std::min(cv + std::max(len, size_t(pipelineDepth_)), size_t(MAX_CV + 1));
+    if (!count)
+    {
+        done_ = again;
+        *error = ERROR_AGAIN;
+        pipeline_kick();
+        return 0;
+    }
+    if (pipelineRunning_)
+    {
+        pipeline_kick();
+        return count;
+    }
+    // Starts the flow only if there is a CV in the window we have not read
+    // yet.
+    for (unsigned i = windowStart_; i < windowEnd_; ++i)
+    {
+        if (!cache_->valid[i] && !cache_->failed[i])
+        {
+            pipeline_kick();
+            break;
+        }
+    }
+    return count;
+}
+
+void TractionCvSpace::pipeline_kick()
+{
+    if (pipelineRunning_)
+    {
+        timer_.ensure_triggered();
+        return;
+    }
+    pipelineRunning_ = 1;
+    railcomHub_->register_port(this);
+    start_flow(STATE(pipeline_run));
+}
+
+bool TractionCvSpace::pipeline_drain(Notifiable *again)
+{
+    if (!pipelineRunning_)
+    {
+        return false;
+    }
+    pipelineDraining_ = 1;
+    done_ = again;
+    timer_.ensure_triggered();
+    return true;
+}
+
+bool TractionCvSpace::pipeline_has(uint16_t cv)
+{
+    for (unsigned i = 0; i < pipelineDepth_; ++i)
+    {
+        if (slots_[i].status != ERROR_NOOP && slots_[i].cv == cv)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+StateFlowBase::Action TractionCvSpace::pipeline_run()
+{
+    long long now = os_get_time_monotonic();
+    long long next_timeout = now + MSEC_TO_NSEC(RAILCOM_POM_RESPONSE_TIMEOUT_MSEC);
+    bool in_flight = false;
+    // Collects the results.
+    for (unsigned i = 0; i < pipelineDepth_; ++i)
+    {
+        PomSlot &s = slots_[i];
+        switch (s.status)
+        {
+            case ERROR_NOOP:
+            case _SLOT_SEND:
+                continue;
+            case ERROR_PENDING:
+            {
+                long long t =
+                    s.sent + MSEC_TO_NSEC(RAILCOM_POM_RESPONSE_TIMEOUT_MSEC);
+                if (t > now)
+                {
+                    in_flight = true;
+                    next_timeout = std::min(next_timeout, t);
+                    continue;
+                }
+                cache_->failed[s.cv] = true;
+                break;
+            }
+            case ERROR_OK:
+                cache_->values[s.cv] = s.value;
+                cache_->valid[s.cv] = true;
+                break;
+            case _ERROR_BUSY:
+                if (now > s.deadline)
+                {
+                    cache_->failed[s.cv] = true;
+                    break;
+                }
+                s.status = _SLOT_SEND;
+                continue;
+            default:
+                if (s.numTry >= READ_RETRY_COUNT_ON_UNKNOWN)
+                {
+                    cache_->failed[s.cv] = true;
+                    break;
+                }
+                s.numTry++;
+                s.status = _SLOT_SEND;
+                continue;
+        }
+        LOG(VERBOSE, "railcom pipelined read cv %u status %d value %d",
+            s.cv, s.status, s.value);
+        s.status = ERROR_NOOP;
+    }
+    if (done_ && !pipelineDraining_ && windowStart_ <= MAX_CV &&
+        (cache_->valid[windowStart_] || cache_->failed[windowStart_]))
+    {
+        // The CV the caller is waiting for is done; the caller will pick it
+        // up from the cache.
+        Notifiable *n = done_;
+        done_ = nullptr;
+        n->notify();
+    }
+    // Assigns free slots to the CVs in the read window.
+    unsigned next_cv = windowStart_;
+    for (unsigned i = 0; i < pipelineDepth_ && !pipelineDraining_; ++i)
+    {
+        PomSlot &s = slots_[i];
+        if (s.status != ERROR_NOOP)
+        {
+            continue;
+        }
+        while (next_cv < windowEnd_ &&
+            (cache_->valid[next_cv] || cache_->failed[next_cv] ||
+                pipeline_has(next_cv)))
+        {
+            ++next_cv;
+        }
+        if (next_cv >= windowEnd_)
+        {
+            break;
+        }
+        s.cv = next_cv;
+        s.numTry = 0;
+        s.deadline = now + MSEC_TO_NSEC(RAILCOM_POM_OP_TIMEOUT_MSEC);
+        s.status = _SLOT_SEND;
+    }
+    for (unsigned i = 0; i < pipelineDepth_; ++i)
+    {
+        if (slots_[i].status == _SLOT_SEND)
+        {
+            sendSlot_ = i;
+            return allocate_and_call(track_, STATE(pipeline_fill_packet));
+        }
+    }
+    if (in_flight)
+    {
+        return sleep_and_call(
+            &timer_, next_timeout - now, STATE(pipeline_run));
+    }
+    // Nothing more to do.
+    railcomHub_->unregister_port(this);
+    pipelineRunning_ = 0;
+    pipelineDraining_ = 0;
+    if (done_)
+    {
+        return async_done();
+    }
+    return exit();
+}
+
+StateFlowBase::Action TractionCvSpace::pipeline_fill_packet()
+{
+    auto *b = get_allocation_result(track_);
+    PomSlot &s = slots_[sendSlot_];
+    b->data()->start_dcc_packet();
+    if (cache_->address >= 0x80)
+    {
+        b->data()->add_dcc_address(dcc::DccLongAddress(cache_->address));
+    }
+    else
+    {
+        b->data()->add_dcc_address(dcc::DccShortAddress(cache_->address));
+    }
+    b->data()->add_dcc_pom_read1(s.cv);
+    b->data()->feedback_key = reinterpret_cast<uintptr_t>(&s);
+    s.status = ERROR_PENDING;
+    s.sent = os_get_time_monotonic();
+    track_->send(b);
+    return call_immediately(STATE(pipeline_run));
 }
 
 } // namespace openlcb
@@ -36,6 +36,9 @@
 #ifndef _OPENLCB_TRACTIONCVSPACE_HXX_
 #define _OPENLCB_TRACTIONCVSPACE_HXX_
 
+#include <bitset>
+#include <memory>
+
 #include "openlcb/MemoryConfig.hxx"
 #include "executor/StateFlow.hxx"
 #include "dcc/PacketFlowInterface.hxx"
@@ -61,6 +64,16 @@ namespace openlcb
 /// assumption that node IDs lower, than 128 are shoprt addresses, and higher
 /// addresses are long addresses.
 ///
+/// Pipelined mode: when constructed with a nonzero pipeline depth, CV reads
+/// keep up to that many POM read packets outstanding on the track at the same
+/// time, each with its own feedback key, and read ahead the CVs following the
+/// requested one. The CV values of the most recently accessed locomotive are
+/// cached, and repeated or multi-byte reads are served from the cache. Writes
+/// update the cache; writing CV8 (decoder reset) or the index CVs 31 and 32
+/// drops the whole cache. The cache is also dropped after
+/// CACHE_MAX_AGE_NSEC, and by invalidate_cache(). In the default mode (depth
+/// 0) every CV is read one at a time, and nothing is cached.
+///
 /// @TODO(balazs.racz) Wire up a link to the traction service to somehow remove
 /// these restrictions.
 class TractionCvSpace : private MemorySpace,
@@ -68,12 +81,32 @@ class TractionCvSpace : private MemorySpace,
                         public StateFlowBase
 {
 public:
+    /// Constructor.
+    /// @param parent memory config handler to register with.
+    /// @param track where to send the POM packets to.
+    /// @param railcom_hub where the railcom feedback comes from.
+    /// @param space_id memory space number to register as.
+    /// @param pipeline_depth how many POM read packets may be outstanding at
+    /// the same time. 0 disables the pipelined mode and the CV cache. At most
+    /// MAX_PIPELINE_DEPTH.
     TractionCvSpace(MemoryConfigHandler *parent,
                     dcc::PacketFlowInterface *track,
-                    dcc::RailcomHubFlow *railcom_hub, uint8_t space_id);
+                    dcc::RailcomHubFlow *railcom_hub, uint8_t space_id,
+                    unsigned pipeline_depth = 0);
 
     ~TractionCvSpace();
 
+    /// Largest supported pipeline depth.
+    static constexpr unsigned MAX_PIPELINE_DEPTH = 8;
+    /// How long the cached CV values are used, counted from when the cache
+    /// was started.
+    static constexpr long long CACHE_MAX_AGE_NSEC = SEC_TO_NSEC(30);
+
+    /// Drops all cached CV values. Call this when the decoder's CVs may have
+    /// changed without going through this space, e.g. on the programming
+    /// track. Must be called on the executor of the interface.
+    void invalidate_cache();
+
 private:
     static const unsigned MAX_CV = 1023;
 
@@ -112,9 +145,44 @@ private:
     Action pgm_verify_reset_done();
     Action pgm_verify_exit();
 
+    /// Pipelined read of a CV. Serves the request from the cache if possible,
+    /// otherwise schedules the POM reads.
+    /// @param cv wire CV number of the first byte to read.
+    /// @param dst where to copy the CV values.
+    /// @param len how many consecutive CVs are requested.
+    /// @param error set to the error code or ERROR_AGAIN.
+    /// @param again notified when the CV read completed.
+    /// @return number of bytes filled in dst.
+    size_t pipeline_read(uint16_t cv, uint8_t *dst, size_t len,
+        errorcode_t *error, Notifiable *again);
+    /// Starts the pipeline flow if it is not running, or wakes it up.
+    void pipeline_kick();
+    /// If the pipeline flow is running, asks it to stop sending new packets,
+    /// and to notify when it is done.
+    /// @param again to notify when the pipeline became idle.
+    /// @return true if the caller has to wait (with ERROR_AGAIN).
+    bool pipeline_drain(Notifiable *again);
+    /// @return true if the pipeline has a slot for this wire CV.
+    bool pipeline_has(uint16_t cv);
+    /// @param cv wire CV number.
+    /// @return true if writing this CV may change the value of other CVs.
+    static bool write_invalidates_all(uint16_t cv)
+    {
+        // CV8: decoder reset; CV31, CV32: index of the paged CV range.
+        return cv == 7 || cv == 30 || cv == 31;
+    }
+
+    Action pipeline_run();
+    Action pipeline_fill_packet();
+
     // Railcom feedback
     void send(Buffer<dcc::RailcomHubData> *b, unsigned priority) OVERRIDE;
     void record_railcom_status(unsigned code);
+    /// Interprets the channel 2 data of a POM response.
+    /// @param f the railcom feedback.
+    /// @param value will be set to the CV value if the response had one.
+    /// @return one of the ERROR_* status codes.
+    unsigned parse_pom_response(const dcc::Feedback &f, uint8_t *value);
 
     MemoryConfigHandler *parent_;
     dcc::PacketFlowInterface *track_;
@@ -135,6 +203,8 @@ private:
         ERROR_GARBAGE = 5,
         ERROR_UNKNOWN_RESPONSE = 6,
         _ERROR_TIMEOUT = 8,
+        /// Pipeline slot that needs a (new) POM packet sent.
+        _SLOT_SEND = 9,
     };
 
 public:
@@ -167,6 +237,54 @@ private:
     StateFlowTimer timer_;
     long long deadline_;  //< time when we should give up and return error.
     vector<dcc::RailcomPacket> interpretedResponse_;
+
+    /// One outstanding POM read of the pipelined mode. The address of the
+    /// slot is the feedback key of the packets.
+    struct PomSlot
+    {
+        /// Wire CV number.
+        uint16_t cv;
+        /// One of the ERROR_* codes. ERROR_NOOP means the slot is free.
+        uint8_t status{ERROR_NOOP};
+        /// Value from the railcom response.
+        uint8_t value;
+        /// How many times we got an unknown response.
+        uint8_t numTry;
+        /// When the last packet was sent.
+        long long sent;
+        /// When we give up retrying a busy decoder.
+        long long deadline;
+    };
+
+    /// Cached CV values of one locomotive.
+    struct CvCache
+    {
+        /// DCC address the values belong to.
+        uint16_t address;
+        /// When the cache was (re)started, in os_get_time_monotonic() time.
+        long long started;
+        /// Which entries of values are valid.
+        std::bitset<MAX_CV + 1> valid;
+        /// Which CVs we gave up reading. Reported as an error once.
+        std::bitset<MAX_CV + 1> failed;
+        uint8_t values[MAX_CV + 1];
+    };
+
+    /// Pipeline depth (number of usable slots), 0 if pipelining is off.
+    uint8_t pipelineDepth_;
+    /// True while the pipeline flow is running.
+    uint8_t pipelineRunning_ : 1;
+    /// True if the pipeline should not start any new reads.
+    uint8_t pipelineDraining_ : 1;
+    /// Which slot pipeline_fill_packet should send.
+    uint8_t sendSlot_;
+    /// First wire CV of the read window (the one the caller is waiting for).
+    uint16_t windowStart_;
+    /// End (exclusive) of the read window.
+    uint16_t windowEnd_;
+    /// Cached CV values. Allocated on first use in pipelined mode.
+    std::unique_ptr<CvCache> cache_;
+    PomSlot slots_[MAX_PIPELINE_DEPTH];
 };
 
 } // namespace openlcb
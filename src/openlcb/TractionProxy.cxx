@@ -73,6 +73,34 @@ Node *allocate_train_node(uint8_t system, uint8_t addr_hi, uint8_t addr_lo, Trai
     return train_node;
 }
 
+/// Finds an existing train node for a proxy allocate request.
+///
+/// @param system legacy technology ID from the request.
+/// @param addr_hi high byte of the address from the request.
+/// @param addr_lo low byte of the address from the request.
+/// @param traction_service where the train nodes are registered.
+/// @return the train node that serves this address or nullptr if there is
+/// none yet.
+static Node *find_train_node(uint8_t system, uint8_t addr_hi, uint8_t addr_lo,
+    TrainService *traction_service)
+{
+    uint16_t addr = (static_cast<uint16_t>(addr_hi) << 8) | addr_lo;
+    if (system == TractionDefs::PROXYTYPE_MARKLIN_DIGITAL)
+    {
+        // Same address as allocate_train_node uses.
+        return traction_service->find_train(
+            dcc::TrainAddressType::MM, addr_lo);
+    }
+    else if (system == TractionDefs::PROXYTYPE_DCC)
+    {
+        return traction_service->find_train(addr_hi == 0 && addr_lo < 128
+                ? dcc::TrainAddressType::DCC_SHORT_ADDRESS
+                : dcc::TrainAddressType::DCC_LONG_ADDRESS,
+            addr);
+    }
+    return nullptr;
+}
+
 /// PImpl Implementation structure for the Traction Proxy service. Owns all
 /// implementation flows, which are important for the correct function of the
 /// service, but are not needed to be visible on the API.
@@ -235,8 +263,19 @@ public:
             uint8_t system = payload()[1];
             uint8_t addr_hi = payload()[2];
             uint8_t addr_lo = payload()[3];
-            Node *train_node =
-                allocate_train_node(system, addr_hi, addr_lo, impl_->traction_service());
+            if (system == TractionDefs::PROXYTYPE_MARKLIN_DIGITAL &&
+                addr_hi != 0)
+            {
+                LOG(VERBOSE, "proxy allocate with invalid MM address.");
+                return reject_permanent();
+            }
+            Node *train_node = find_train_node(
+                system, addr_hi, addr_lo, impl_->traction_service());
+            if (!train_node)
+            {
+                train_node = allocate_train_node(
+                    system, addr_hi, addr_lo, impl_->traction_service());
+            }
 
             if (!train_node)
             {
@@ -219,6 +219,7 @@ public:
 
     ~TractionThrottle()
     {
+        updateFlow_.shutdown();
         iface()->dispatcher()->unregister_handler_all(&listenReplyHandler_);
         iface()->dispatcher()->unregister_handler_all(&speedReplyHandler_);
     }
@@ -238,8 +239,41 @@ public:
         ERROR_ASSIGNED = 0x4010000,
     };
 
+    /// Enables coalescing of speed and function updates. When enabled, the
+    /// updates are sent to the train at most once per period; updates made in
+    /// between overwrite the pending (not yet sent) ones, so only the latest
+    /// speed and the latest value of each function goes out. This avoids
+    /// flooding the bus with obsolete commands when the user spins a knob.
+    /// Emergency stop is always sent immediately, and it cancels the pending
+    /// speed update.
+    ///
+    /// Updates that are still pending when the throttle is destroyed are
+    /// dropped. While updates are pending, the throttle must not be destroyed
+    /// on the executor of the interface.
+    ///
+    /// @param period_nsec minimum time between two batches of updates sent to
+    /// the train. 0 (the default) disables coalescing: every update is sent
+    /// immediately.
+    void set_min_update_period(long long period_nsec)
+    {
+        OSMutexLock l(&pendingLock_);
+        minUpdatePeriod_ = period_nsec;
+    }
+
     void set_speed(SpeedType speed) override
     {
+        {
+            OSMutexLock l(&pendingLock_);
+            if (minUpdatePeriod_)
+            {
+                pendingSpeed_ = speed;
+                hasPendingSpeed_ = true;
+                lastSetSpeed_ = speed;
+                estopActive_ = false;
+                updateFlow_.trigger_locked();
+                return;
+            }
+        }
         send_traction_message(TractionDefs::speed_set_payload(speed));
         lastSetSpeed_ = speed;
         estopActive_ = false;
@@ -254,6 +288,12 @@ public:
 
     void set_emergencystop() override
     {
+        {
+            OSMutexLock l(&pendingLock_);
+            // A speed update that has not gone out yet must not override the
+            // emergency stop.
+            hasPendingSpeed_ = false;
+        }
         send_traction_message(TractionDefs::estop_set_payload());
         estopActive_ = true;
         lastSetSpeed_.set_mph(0);
@@ -268,6 +308,16 @@ public:
 
     void set_fn(uint32_t address, uint16_t value) override
     {
+        {
+            OSMutexLock l(&pendingLock_);
+            if (minUpdatePeriod_)
+            {
+                pendingFn_[address] = value;
+                lastKnownFn_[address] = value;
+                updateFlow_.trigger_locked();
+                return;
+            }
+        }
         send_traction_message(TractionDefs::fn_set_payload(address, value));
         lastKnownFn_[address] = value;
     }
@@ -816,6 +866,143 @@ private:
         lastSetSpeed_ = nan_to_speed();
         estopActive_ = false;
         lastKnownFn_.clear();
+        // Pending updates were meant for the train we just released.
+        OSMutexLock l(&pendingLock_);
+        hasPendingSpeed_ = false;
+        pendingFn_.clear();
+    }
+
+    /// Sends the coalesced updates to the train, at most once per
+    /// minUpdatePeriod_.
+    class UpdateFlow : public StateFlowBase
+    {
+    public:
+        UpdateFlow(TractionThrottle *parent)
+            : StateFlowBase(parent->service())
+            , parent_(parent)
+        {
+        }
+
+        /// Wakes up the flow if it is waiting for updates. Must be called with
+        /// the parent's pendingLock_ held.
+        void trigger_locked()
+        {
+            if (!idle_)
+            {
+                return;
+            }
+            idle_ = false;
+            if (is_terminated())
+            {
+                // First update ever.
+                start_flow(STATE(check_pending));
+            }
+            else
+            {
+                notify();
+            }
+        }
+
+        /// Drops the pending updates, cuts short the period timer and blocks
+        /// until the flow is idle. Called from the parent's destructor; must
+        /// not be called on the executor unless the flow is idle.
+        void shutdown()
+        {
+            SyncNotifiable n;
+            {
+                OSMutexLock l(&parent_->pendingLock_);
+                parent_->minUpdatePeriod_ = 0;
+                parent_->hasPendingSpeed_ = false;
+                parent_->pendingFn_.clear();
+                if (idle_)
+                {
+                    return;
+                }
+                idleNotify_ = &n;
+            }
+            service()->executor()->sync_run(
+                [this]() { timer_.ensure_triggered(); });
+            n.wait_for_notification();
+            // The flow notified us from within check_pending(); waits until
+            // it has returned to the executor.
+            service()->executor()->sync_run([]() {});
+        }
+
+    private:
+        /// Sends the pending updates, then sleeps for the update period.
+        Action check_pending()
+        {
+            PendingUpdates u;
+            long long period;
+            {
+                OSMutexLock l(&parent_->pendingLock_);
+                if (!parent_->hasPendingSpeed_ && parent_->pendingFn_.empty())
+                {
+                    idle_ = true;
+                    if (idleNotify_)
+                    {
+                        idleNotify_->notify();
+                        idleNotify_ = nullptr;
+                    }
+                    return wait();
+                }
+                parent_->take_pending_locked(&u);
+                period = parent_->minUpdatePeriod_;
+            }
+            // Sending may block for a free buffer; the lock must not be held
+            // by then, or set_speed() from the user's thread would block too.
+            parent_->send_pending(u);
+            return sleep_and_call(&timer_, period, STATE(check_pending));
+        }
+
+        TractionThrottle *parent_;
+        StateFlowTimer timer_{this};
+        /// True if the flow is waiting for a trigger. Protected by the
+        /// parent's pendingLock_.
+        bool idle_{true};
+        /// Notified when the flow becomes idle. Protected by the parent's
+        /// pendingLock_.
+        Notifiable *idleNotify_{nullptr};
+    };
+
+    /// Coalesced updates taken out of the pending state.
+    struct PendingUpdates
+    {
+        /// True if speed needs to be sent to the train.
+        bool hasSpeed{false};
+        /// Speed update to send.
+        SpeedType speed;
+        /// Function updates to send.
+        std::map<uint32_t, uint16_t> fns;
+    };
+
+    /// Moves the pending speed and function updates to u. Must be called with
+    /// pendingLock_ held.
+    void take_pending_locked(PendingUpdates *u)
+    {
+        u->hasSpeed = hasPendingSpeed_;
+        u->speed = pendingSpeed_;
+        u->fns.swap(pendingFn_);
+        hasPendingSpeed_ = false;
+    }
+
+    /// Sends updates taken by take_pending_locked() to the train. Must be
+    /// called without pendingLock_ held.
+    void send_pending(const PendingUpdates &u)
+    {
+        if (!dst_)
+        {
+            return;
+        }
+        if (u.hasSpeed)
+        {
+            send_traction_message(TractionDefs::speed_set_payload(u.speed));
+        }
+        for (const auto &it : u.fns)
+        {
+            send_traction_message(
+                TractionDefs::fn_set_payload(it.first, it.second));
+        }
     }
 
     TractionThrottleInput *input()
@@ -854,6 +1041,19 @@ private:
     SpeedType lastSetSpeed_;
     /// Cache: all known function values.
     std::map<uint32_t, uint16_t> lastKnownFn_;
+
+    /// Protects the coalesced update state below.
+    OSMutex pendingLock_;
+    /// Minimum time between coalesced updates. 0 if coalescing is disabled.
+    long long minUpdatePeriod_{0};
+    /// True if pendingSpeed_ needs to be sent to the train.
+    bool hasPendingSpeed_{false};
+    /// Speed update that was not yet sent to the train.
+    SpeedType pendingSpeed_;
+    /// Function updates that were not yet sent to the train.
+    std::map<uint32_t, uint16_t> pendingFn_;
+    /// Sends the coalesced updates.
+    UpdateFlow updateFlow_{this};
 };
 
 } // namespace openlcb
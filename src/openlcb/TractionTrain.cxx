@@ -62,6 +62,11 @@ TrainNodeForProxy::TrainNodeForProxy(TrainService *service, TrainImpl *train)
     service_->register_train(this);
 }
 
+TrainNodeForProxy::~TrainNodeForProxy()
+{
+    service_->unregister_train(this);
+}
+
 TrainNodeWithId::TrainNodeWithId(
     TrainService *service, TrainImpl *train, NodeID node_id)
     : TrainNode(service, train)
@@ -70,6 +75,11 @@ TrainNodeWithId::TrainNodeWithId(
     service_->register_train(this);
 }
 
+TrainNodeWithId::~TrainNodeWithId()
+{
+    service_->unregister_train(this);
+}
+
 NodeID TrainNodeForProxy::node_id()
 {
     return TractionDefs::train_node_id_from_legacy(
@@ -150,8 +160,8 @@ struct TrainService::Impl
                 return release_and_exit();
             }
             // Checks if destination is a local traction-enabled node.
-            if (trainService_->nodes_.find(train_node()) ==
-                trainService_->nodes_.end())
+            if (trainService_->find_train(nmsg()->dstNode->node_id()) !=
+                nmsg()->dstNode)
             {
                 LOG(VERBOSE, "Traction message for node %p that is not "
                              "traction enabled.",
@@ -177,7 +187,6 @@ struct TrainService::Impl
                 {
                     SpeedType sp = fp16_to_speed(payload() + 1);
                     train_node()->train()->set_speed(sp);
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_SET_FN:
@@ -191,13 +200,11 @@ struct TrainService::Impl
                     value <<= 8;
                     value |= payload()[5];
                     train_node()->train()->set_fn(address, value);
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_EMERGENCY_STOP:
                 {
                     train_node()->train()->set_emergencystop();
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_QUERY_SPEED: // fall through
@@ -414,88 +421,88 @@ struct TrainService::Impl
             }
         }
 
+        /// Forwards the incoming command to all consist members in one pass.
+        ///
+        /// The buffers for the forwarded messages are allocated
+        /// synchronously, and all messages are handed to the write flow in
+        /// this single executor step, so the trailing units of a long consist
+        /// do not lag behind the lead by one allocation round-trip each. The
+        /// incoming message buffer is reused for the last recipient.
         Action maybe_forward_consist()
         {
-            auto* train_node = this->train_node();
-            unsigned count = train_node->query_consist_length();
-            if (count <= nextConsistIndex_)
-                return release_and_exit();
-            uint8_t flags = 0;
-            NodeID dst = train_node->query_consist(nextConsistIndex_, &flags);
-            if (iface()->matching_node(nmsg()->src, NodeHandle(dst)))
+            auto *train_node = this->train_node();
+            uint8_t cmd = payload()[0];
+            uint32_t fn_address = 0;
+            if (cmd == TractionDefs::REQ_SET_FN)
             {
-                ++nextConsistIndex_;
-                return again();
+                fn_address = payload()[1];
+                fn_address <<= 8;
+                fn_address |= payload()[2];
+                fn_address <<= 8;
+                fn_address |= payload()[3];
             }
-            uint8_t cmd = payload()[0];
-            bool flip_speed = false;
-            if (cmd == TractionDefs::REQ_SET_SPEED) {
-                if (flags & TractionDefs::CNSTFLAGS_REVERSE) {
-                    flip_speed = true;
+            // The last recipient found. Sending it is deferred until we know
+            // whether there are more.
+            NodeID pending_dst = 0;
+            bool pending_flip = false;
+            for (auto it = train_node->consist_begin();
+                 it != train_node->consist_end(); ++it)
+            {
+                NodeID dst = it->get_slave();
+                uint8_t flags = it->get_flags();
+                if (iface()->matching_node(nmsg()->src, NodeHandle(dst)))
+                {
+                    continue;
                 }
-            } else if (cmd == TractionDefs::REQ_SET_FN) {
-                uint32_t address = payload()[1];
-                address <<= 8;
-                address |= payload()[2];
-                address <<= 8;
-                address |= payload()[3];
-                if (address == 0) {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKF0) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
-                    }
-                } else {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKFN) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
+                if (cmd == TractionDefs::REQ_SET_FN)
+                {
+                    uint8_t link = fn_address == 0
+                        ? TractionDefs::CNSTFLAGS_LINKF0
+                        : TractionDefs::CNSTFLAGS_LINKFN;
+                    if ((flags & link) == 0)
+                    {
+                        continue;
                     }
                 }
+                if (pending_dst)
+                {
+                    forward_copy(pending_dst, pending_flip);
+                }
+                pending_dst = dst;
+                pending_flip = (cmd == TractionDefs::REQ_SET_SPEED) &&
+                    (flags & TractionDefs::CNSTFLAGS_REVERSE);
             }
-            if (count == nextConsistIndex_ + 1u)
+            if (!pending_dst)
             {
-                // last node: we can transfer the message.
-                auto *b = transfer_message();
-                b->data()->src = NodeHandle(train_node->node_id());
-                b->data()->dst = NodeHandle(dst);
-                b->data()->dstNode = nullptr;
-                if (flip_speed) {
-                    b->data()->payload[1] ^= 0x80;
-                }
-                iface()->addressed_message_write_flow()->send(b);
-                return exit();
+                return release_and_exit();
             }
-            else
+            // last node: we can transfer the message.
+            auto *b = transfer_message();
+            b->data()->src = NodeHandle(train_node->node_id());
+            b->data()->dst = NodeHandle(pending_dst);
+            b->data()->dstNode = nullptr;
+            if (pending_flip)
             {
-                return allocate_and_call(
-                    iface()->addressed_message_write_flow(),
-                    STATE(forward_consist));
+                b->data()->payload[1] ^= 0x80;
             }
+            iface()->addressed_message_write_flow()->send(b);
+            return exit();
         }
 
-        Action forward_consist()
+        /// Sends a copy of the incoming command to a consist member.
+        /// @param dst node ID of the consist member.
+        /// @param flip_speed true if the direction of the speed shall be
+        /// reversed.
+        void forward_copy(NodeID dst, bool flip_speed)
         {
-            auto *b =
-                get_allocation_result(iface()->addressed_message_write_flow());
-            uint8_t flags;
-            NodeID dst = train_node()->query_consist(nextConsistIndex_, &flags);
-            if (!dst)
-            {
-                // Strange. The consist destination should exist and never be
-                // zero once we got here.
-                b->unref();
-                return release_and_exit();
-            }
+            auto *b = iface()->addressed_message_write_flow()->alloc();
             b->data()->reset(message()->data()->mti, train_node()->node_id(),
-                             NodeHandle(dst), message()->data()->payload);
-            if ((payload()[0] == TractionDefs::REQ_SET_SPEED) &&
-                (flags & TractionDefs::CNSTFLAGS_REVERSE)) {
+                NodeHandle(dst), message()->data()->payload);
+            if (flip_speed)
+            {
                 b->data()->payload[1] ^= 0x80;
             }
             iface()->addressed_message_write_flow()->send(b);
-            ++nextConsistIndex_;
-            return call_immediately(STATE(maybe_forward_consist));
         }
 
         Action handle_traction_mgmt()
@@ -595,7 +602,6 @@ struct TrainService::Impl
     private:
         /// error code for reject_permanent().
         unsigned errorCode_ : 16;
-        unsigned nextConsistIndex_ : 8;
         /// 1 if the voluntary lock protocol has set this train to be reserved.
         unsigned reserved_ : 1;
         TrainService *trainService_;
@@ -623,9 +629,41 @@ void TrainService::register_train(TrainNode *node)
     extern void StartInitializationFlow(Node * node);
     StartInitializationFlow(node);
     AtomicHolder h(this);
-    nodes_.insert(node);
+    nodes_.add(node);
     LOG(VERBOSE, "Registered node %p for traction.", node);
-    HASSERT(nodes_.find(node) != nodes_.end());
+    HASSERT(nodes_.find(node->node_id()) == node);
+}
+
+void TrainService::unregister_train(TrainNode *node)
+{
+    AtomicHolder h(this);
+    nodes_.remove(node);
+}
+
+void TrainNodeIndex::add(TrainNode *node)
+{
+    byId_[node->node_id()] = node;
+    TrainImpl *train = node->train();
+    byAddress_.emplace(
+        address_key(train->legacy_address_type(), train->legacy_address()),
+        node);
+}
+
+void TrainNodeIndex::remove(TrainNode *node)
+{
+    auto it = byId_.find(node->node_id());
+    if (it == byId_.end() || it->second != node)
+    {
+        return;
+    }
+    byId_.erase(it);
+    TrainImpl *train = node->train();
+    auto ait = byAddress_.find(
+        address_key(train->legacy_address_type(), train->legacy_address()));
+    if (ait != byAddress_.end() && ait->second == node)
+    {
+        byAddress_.erase(ait);
+    }
 }
 
 } // namespace openlcb
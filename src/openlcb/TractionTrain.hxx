@@ -35,7 +35,7 @@
 #ifndef _OPENLCB_TRACTIONTRAIN_HXX_
 #define _OPENLCB_TRACTIONTRAIN_HXX_
 
-#include <set>
+#include <unordered_map>
 
 #include "executor/Service.hxx"
 #include "openlcb/Node.hxx"
@@ -183,6 +183,22 @@ public:
         return 0;
     }
 
+    /// Iterator over the consist targets.
+    typedef TypedQueue<ConsistEntry>::iterator consist_iterator;
+
+    /** @return iterator to the first consist target. Used for forwarding
+     * commands to the entire consist in one pass. */
+    consist_iterator consist_begin()
+    {
+        return consistSlaves_.begin();
+    }
+
+    /** @return iterator past the last consist target. */
+    SimpleQueue::end_iterator consist_end()
+    {
+        return consistSlaves_.end();
+    }
+
     /** Returns the number of slaves in this consist. */
     int query_consist_length()
     {
@@ -211,6 +227,7 @@ private:
 class TrainNodeForProxy : public TrainNode {
 public:
     TrainNodeForProxy(TrainService *service, TrainImpl *train);
+    ~TrainNodeForProxy();
 
     NodeID node_id() OVERRIDE;
 };
@@ -220,6 +237,7 @@ public:
 class TrainNodeWithId : public TrainNode {
 public:
     TrainNodeWithId(TrainService *service, TrainImpl *train, NodeID node_id);
+    ~TrainNodeWithId();
 
     NodeID node_id() OVERRIDE {
         return nodeId_;
@@ -229,6 +247,63 @@ private:
     NodeID nodeId_;
 };
 
+/// Hashed index of train nodes, by NodeID and by legacy address. Lookups take
+/// constant time, independent of the number of trains.
+///
+/// This class is thread-compatible; the TrainService serializes access.
+class TrainNodeIndex
+{
+public:
+    /// Adds a train node to the index. The node's ID and legacy address must
+    /// not change while it is in the index. If another node already has the
+    /// same legacy address, the lookup by address keeps returning the earlier
+    /// node.
+    /// @param node the train node to add.
+    void add(TrainNode *node);
+
+    /// Removes a train node from the index. Must be called before the node
+    /// becomes unable to report its node ID (i.e. from the most derived
+    /// destructor).
+    /// @param node the train node to remove. No-op if not in the index.
+    void remove(TrainNode *node);
+
+    /// @param id node ID to look up.
+    /// @return the train node with the given ID or nullptr if not found.
+    TrainNode *find(NodeID id) const
+    {
+        auto it = byId_.find(id);
+        return it == byId_.end() ? nullptr : it->second;
+    }
+
+    /// @param type legacy address type to look up.
+    /// @param address legacy address to look up.
+    /// @return the train node with the given legacy address or nullptr if
+    /// not found.
+    TrainNode *find(dcc::TrainAddressType type, uint32_t address) const
+    {
+        auto it = byAddress_.find(address_key(type, address));
+        return it == byAddress_.end() ? nullptr : it->second;
+    }
+
+    /// @return the number of train nodes in the index.
+    size_t size() const
+    {
+        return byId_.size();
+    }
+
+private:
+    /// @return the key in the byAddress_ map.
+    static uint64_t address_key(dcc::TrainAddressType type, uint32_t address)
+    {
+        return (uint64_t(type) << 32) | address;
+    }
+
+    /// Train nodes by their node ID.
+    std::unordered_map<NodeID, TrainNode *> byId_;
+    /// Train nodes by their legacy address, keyed by address_key().
+    std::unordered_map<uint64_t, TrainNode *> byAddress_;
+};
+
 /// Collection of control flows necessary for implementing the Traction
 /// Protocol.
 ///
@@ -249,14 +324,34 @@ public:
         initialization flow for the train. */
     void register_train(TrainNode *node);
 
+    /** Removes a train from the train service. Called by the train node's
+        destructor. The node stays registered with the interface. */
+    void unregister_train(TrainNode *node);
+
+    /** @return the registered train node with node ID id, or nullptr if there
+        is no such train. */
+    TrainNode *find_train(NodeID id)
+    {
+        AtomicHolder h(this);
+        return nodes_.find(id);
+    }
+
+    /** @return the registered train node with the given legacy address, or
+        nullptr if there is no such train. */
+    TrainNode *find_train(dcc::TrainAddressType type, uint32_t address)
+    {
+        AtomicHolder h(this);
+        return nodes_.find(type, address);
+    }
+
 private:
     struct Impl;
     /** Implementation flows. */
     Impl *impl_;
 
     If *iface_;
-    /** List of train nodes managed by this Service. */
-    std::set<TrainNode *> nodes_;
+    /** Train nodes managed by this Service. */
+    TrainNodeIndex nodes_;
 };
 
 } // namespace openlcb
@@ -33,8 +33,86 @@
 
 #include "openlcb/Velocity.hxx"
 
+#include <algorithm>
+
 namespace openlcb
 {
+
+/// Smallest wire speed (absolute value) for the speed steps 2..14 of a 14
+/// speed step decoder. Generated by evaluating the float formula in
+/// Velocity::wire_to_speed_step for every wire value.
+static const uint16_t STEP_THRESHOLDS_14[] = {
+    0x4406, 0x4806, 0x4a09, 0x4c06, 0x4d08, 0x4e09, 0x4f0b, 0x5006,
+    0x5087, 0x5108, 0x5189, 0x5209, 0x528a};
+
+/// Smallest wire speed (absolute value) for the speed steps 2..28 of a 28
+/// speed step decoder.
+static const uint16_t STEP_THRESHOLDS_28[] = {
+    0x4006, 0x4406, 0x4609, 0x4806, 0x4908, 0x4a09, 0x4b0b, 0x4c06,
+    0x4c87, 0x4d08, 0x4d89, 0x4e09, 0x4e8a, 0x4f0b, 0x4f8c, 0x5006,
+    0x5047, 0x5087, 0x50c8, 0x5108, 0x5148, 0x5189, 0x51c9, 0x5209,
+    0x524a, 0x528a, 0x52cb};
+
+/// Smallest wire speed (absolute value) for the speed steps 2..126 of a 128
+/// speed step decoder.
+static const uint16_t STEP_THRESHOLDS_126[] = {
+    0x3728, 0x3b28, 0x3d5e, 0x3f28, 0x4079, 0x415e, 0x4243, 0x4328,
+    0x4406, 0x4479, 0x44eb, 0x455e, 0x45d0, 0x4643, 0x46b5, 0x4728,
+    0x479a, 0x4806, 0x4840, 0x4879, 0x48b2, 0x48eb, 0x4925, 0x495e,
+    0x4997, 0x49d0, 0x4a09, 0x4a43, 0x4a7c, 0x4ab5, 0x4aee, 0x4b28,
+    0x4b61, 0x4b9a, 0x4bd3, 0x4c06, 0x4c23, 0x4c40, 0x4c5c, 0x4c79,
+    0x4c96, 0x4cb2, 0x4ccf, 0x4ceb, 0x4d08, 0x4d25, 0x4d41, 0x4d5e,
+    0x4d7a, 0x4d97, 0x4db4, 0x4dd0, 0x4ded, 0x4e09, 0x4e26, 0x4e43,
+    0x4e5f, 0x4e7c, 0x4e99, 0x4eb5, 0x4ed2, 0x4eee, 0x4f0b, 0x4f28,
+    0x4f44, 0x4f61, 0x4f7d, 0x4f9a, 0x4fb7, 0x4fd3, 0x4ff0, 0x5006,
+    0x5015, 0x5023, 0x5031, 0x5040, 0x504e, 0x505c, 0x506b, 0x5079,
+    0x5087, 0x5096, 0x50a4, 0x50b2, 0x50c0, 0x50cf, 0x50dd, 0x50eb,
+    0x50fa, 0x5108, 0x5116, 0x5125, 0x5133, 0x5141, 0x5150, 0x515e,
+    0x516c, 0x517a, 0x5189, 0x5197, 0x51a5, 0x51b4, 0x51c2, 0x51d0,
+    0x51df, 0x51ed, 0x51fb, 0x5209, 0x5218, 0x5226, 0x5234, 0x5243,
+    0x5251, 0x525f, 0x526e, 0x527c, 0x528a, 0x5299, 0x52a7, 0x52b5,
+    0x52c3, 0x52d2, 0x52e0, 0x52ee, 0x52fd};
+
+unsigned Velocity::wire_to_speed_step(float16_t value, unsigned num_steps)
+{
+    value &= 0x7FFFu;
+    if (value == 0 || value > 0x7C00u)
+    {
+        // Zero or NaN.
+        return 0;
+    }
+    if (value == 0x7C00u)
+    {
+        return num_steps;
+    }
+    const uint16_t *begin;
+    const uint16_t *end;
+    switch (num_steps)
+    {
+        case 14:
+            begin = STEP_THRESHOLDS_14;
+            end = begin + ARRAYSIZE(STEP_THRESHOLDS_14);
+            break;
+        case 28:
+            begin = STEP_THRESHOLDS_28;
+            end = begin + ARRAYSIZE(STEP_THRESHOLDS_28);
+            break;
+        case 126:
+            begin = STEP_THRESHOLDS_126;
+            end = begin + ARRAYSIZE(STEP_THRESHOLDS_126);
+            break;
+        default:
+        {
+            float f_speed = Velocity(value).mph();
+            f_speed *= ((num_steps * 1.0) / 126);
+            unsigned sp = f_speed;
+            sp++; // makes sure it is at least speed step 1.
+            return std::min(sp, num_steps);
+        }
+    }
+    // Positive half floats order the same way as their bit patterns.
+    return 1 + (std::upper_bound(begin, end, value) - begin);
+}
     
 /** Get the speed in DCC 128 speed step format.
  *  The mapping from meters/sec is strait forward.  First convert to
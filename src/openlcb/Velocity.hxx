@@ -36,6 +36,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
 #include "utils/macros.h"
 
@@ -123,7 +124,7 @@ public:
      * @param value starting value for Velocity as IEEE half precision float.
      */
     Velocity(float16_t value)
-        : velocity(halfp2singles(&velocity, &value, 1))
+        : velocity(wire_to_float(value))
     {
     }
 
@@ -283,9 +284,7 @@ public:
      */
     float16_t get_wire() const
     {
-        float16_t result;
-        singles2halfp(&result, &velocity, 1);
-        return result;
+        return float_to_wire(velocity);
     }
     
     /** Set the value based on the wire version of velocity.
@@ -293,9 +292,101 @@ public:
      */
     void set_wire(float16_t value)
     {
-        halfp2singles(&velocity, &value, 1);
+        velocity = wire_to_float(value);
+    }
+
+    /** Converts a single precision float to IEEE half precision. The result
+     * is bit-identical to singles2halfp() (including its rounding of ties
+     * away from zero), but uses only integer operations and is inlined.
+     * @param value single precision float
+     * @return half precision representation of value
+     */
+    static float16_t float_to_wire(float value)
+    {
+        uint32_t x;
+        memcpy(&x, &value, sizeof(x));
+        uint16_t hs = (x >> 16) & 0x8000u;
+        uint32_t xe = x & 0x7F800000u;
+        uint32_t xm = x & 0x007FFFFFu;
+        if (xe == 0)
+        {
+            // Zero or denormal; both underflow to a signed zero.
+            return hs;
+        }
+        if (xe == 0x7F800000u)
+        {
+            // Inf or NaN. For NaN only the top mantissa bits are kept.
+            return xm ? (x >> 16) : (hs | 0x7C00u);
+        }
+        int hes = (int)(xe >> 23) - 127 + 15;
+        if (hes >= 0x1F)
+        {
+            return hs | 0x7C00u;
+        }
+        if (hes <= 0)
+        {
+            if (14 - hes > 24)
+            {
+                return hs;
+            }
+            xm |= 0x00800000u;
+            uint16_t hm = xm >> (14 - hes);
+            hm += (xm >> (13 - hes)) & 1;
+            return hs | hm;
+        }
+        // Rounding may overflow into the exponent, that is intended.
+        return (hs | (hes << 10) | (xm >> 13)) + ((xm >> 12) & 1);
     }
 
+    /** Converts IEEE half precision to a single precision float. The result
+     * is bit-identical to halfp2singles(), but uses only integer operations
+     * and is inlined.
+     * @param value half precision float
+     * @return value as a single precision float
+     */
+    static float wire_to_float(float16_t value)
+    {
+        uint32_t xs = ((uint32_t)(value & 0x8000u)) << 16;
+        uint32_t he = value & 0x7C00u;
+        uint32_t hm = value & 0x03FFu;
+        uint32_t x;
+        if (he == 0)
+        {
+            if (hm == 0)
+            {
+                x = xs;
+            }
+            else
+            {
+                // Denormal, normalizes to a single.
+                unsigned shift = __builtin_clz(hm) - 21;
+                x = xs | ((113 - shift) << 23) | (((hm << shift) & 0x3FFu) << 13);
+            }
+        }
+        else if (he == 0x7C00u)
+        {
+            x = hm ? (((uint32_t)value) << 16) : (xs | 0x7F800000u);
+        }
+        else
+        {
+            x = xs | ((he + (112 << 10) + hm) << 13);
+        }
+        float ret;
+        memcpy(&ret, &x, sizeof(ret));
+        return ret;
+    }
+
+    /** Computes the speed step to send to a decoder, directly from the wire
+     * format. The result is the same as scaling mph() to num_steps / 126 of
+     * its value, truncating, adding one and saturating at num_steps (which is
+     * what the DCC and Marklin-Motorola trains do). For 14, 28 and 126 steps
+     * this uses only integer operations, and infinity gives num_steps.
+     * @param value velocity in the wire format; the sign is ignored.
+     * @param num_steps largest speed step of the decoder
+     * @return speed step, 0 for stopped (or NaN).
+     */
+    static unsigned wire_to_speed_step(float16_t value, unsigned num_steps);
+
     /** Overloaded addition operator. */
     Velocity operator + (const Velocity& v) const
     {
@@ -0,0 +1,523 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file AsyncLogging.cxx
+ *
+ * Logging backend that defers the formatting and output of log messages to a
+ * background thread.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "utils/AsyncLogging.hxx"
+
+#if defined(__linux__) || defined(__MACH__)
+
+#include <atomic>
+#include <vector>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "os/OS.hxx"
+#include "utils/logging.h"
+
+namespace async_log
+{
+
+namespace
+{
+
+/// Header of a record in the ring. Followed by the payload. A header with
+/// size == 0 means that the rest of the ring until the end is unused, and
+/// the next record is at the beginning of the ring.
+struct RecordHeader
+{
+    /// Number of bytes of the header and the payload together, a multiple of
+    /// ALIGN.
+    uint32_t size;
+    /// Unused.
+    uint32_t reserved;
+    /// Global sequence number, for merging the rings in the logging order.
+    uint64_t seq;
+    /// Renders the record.
+    FormatFn fn;
+    /// Format string.
+    const char *fmt;
+};
+
+static_assert(sizeof(RecordHeader) % ALIGN == 0, "Unaligned header");
+
+/// Single producer single consumer ring of log records. The producer is the
+/// thread that owns the ring; the consumer is the background thread.
+struct Ring
+{
+    /// Constructor.
+    /// @param size number of bytes, a power of two.
+    Ring(size_t size)
+        : size_(size)
+        , data_(new uint8_t[size])
+    {
+    }
+
+    ~Ring()
+    {
+        delete[] data_;
+    }
+
+    /// Number of bytes in the ring.
+    const size_t size_;
+    /// Record storage.
+    uint8_t *const data_;
+    /// Bytes ever committed by the producer.
+    std::atomic<uint64_t> head_{0};
+    /// Bytes ever released by the consumer.
+    std::atomic<uint64_t> tail_{0};
+    /// The value of head_ after the record being reserved is committed. Only
+    /// accessed by the producer.
+    uint64_t pending_{0};
+    /// Number of messages dropped because the ring was full.
+    std::atomic<uint64_t> dropped_{0};
+    /// How many of the dropped messages were reported. Only accessed by the
+    /// consumer.
+    uint64_t reportedDropped_{0};
+    /// Set when the owning thread exits. The consumer deletes the ring after
+    /// draining it.
+    std::atomic<bool> abandoned_{false};
+    /// Next ring in the list of all rings.
+    Ring *next_{nullptr};
+};
+
+/// Background thread that renders and writes the log messages.
+class Logger : public OSThread
+{
+public:
+    Logger()
+    {
+        start("async_log", 0, 0);
+    }
+
+    /// @return the singleton instance, which is created upon first use and
+    /// never destroyed, so that threads can log during the process exit.
+    static Logger *instance()
+    {
+        static Logger *logger = create();
+        return logger;
+    }
+
+    /// Adds a new ring to the list of rings.
+    /// @return the new ring.
+    Ring *create_ring()
+    {
+        Ring *r = new Ring(ringSize_.load());
+        OSMutexLock l(&lock_);
+        r->next_ = rings_.load(std::memory_order_relaxed);
+        // The background thread walks the list without the lock.
+        rings_.store(r, std::memory_order_release);
+        return r;
+    }
+
+    /// Wakes up the background thread if it is sleeping.
+    void wakeup()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) &&
+            sleeping_.exchange(false))
+        {
+            sem_.post();
+        }
+    }
+
+    /// Blocks until all records committed before the call are written.
+    void flush()
+    {
+        std::vector<std::pair<Ring *, uint64_t>> targets;
+        {
+            OSMutexLock l(&lock_);
+            for (Ring *r = rings_; r; r = r->next_)
+            {
+                targets.emplace_back(r, r->head_.load());
+            }
+            // The rings may not be deleted while we are waiting.
+            ++flushing_;
+        }
+        sleeping_ = false;
+        sem_.post();
+        for (auto &t : targets)
+        {
+            while (t.first->tail_.load() < t.second)
+            {
+                usleep(100);
+            }
+        }
+        OSMutexLock l(&lock_);
+        --flushing_;
+    }
+
+    /// Writes out the pending records on the calling thread. Used when the
+    /// process is about to die, and the background thread may not get to run
+    /// anymore (or does not exist, e.g. in a forked child).
+    void flush_now()
+    {
+        if (os_thread_self() == get_handle())
+        {
+            // Crashed while writing the messages.
+            return;
+        }
+        // Waits at most a second for the background thread to finish the
+        // record it is writing.
+        for (unsigned i = 0; draining_.exchange(true); ++i)
+        {
+            if (i >= 1000)
+            {
+                return;
+            }
+            usleep(1000);
+        }
+        drain(false);
+        draining_ = false;
+    }
+
+    /// Total number of messages written.
+    std::atomic<unsigned long long> written_{0};
+    /// Messages dropped by the rings that were deleted already.
+    std::atomic<unsigned long long> droppedDeleted_{0};
+    /// Where to write the messages.
+    std::atomic<void (*)(char *, int)> output_{&::log_output};
+    /// Size of new rings.
+    std::atomic<size_t> ringSize_{64 * 1024};
+    /// Protects adding and removing rings. Walking the list needs it too,
+    /// except for the thread that is draining the rings, which is the only
+    /// one that removes rings.
+    OSMutex lock_;
+    /// List of all rings.
+    std::atomic<Ring *> rings_{nullptr};
+
+private:
+    /// Creates the instance and arranges that the pending messages are
+    /// written when the process exits or crashes.
+    static Logger *create()
+    {
+        Logger *l = new Logger();
+        atexit(&async_log::flush);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = &fatal_signal;
+        sigemptyset(&sa.sa_mask);
+        for (unsigned i = 0; i < NUM_FATAL_SIGNALS; ++i)
+        {
+            sigaction(FATAL_SIGNALS[i], &sa, &oldActions_[i]);
+        }
+        return l;
+    }
+
+    /// Signals that terminate the process. HASSERT, DIE and LOG(FATAL) end
+    /// in abort(), which raises SIGABRT.
+    static constexpr int FATAL_SIGNALS[] = {
+        SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+    /// Number of entries in FATAL_SIGNALS.
+    static constexpr unsigned NUM_FATAL_SIGNALS =
+        sizeof(FATAL_SIGNALS) / sizeof(FATAL_SIGNALS[0]);
+    /// Handlers of FATAL_SIGNALS before we installed ours.
+    static struct sigaction oldActions_[NUM_FATAL_SIGNALS];
+
+    /// Handler of the fatal signals. Writes out the pending messages (this is
+    /// not async-signal-safe, but the process is dying anyway), then
+    /// restores the previous handler and raises the signal again.
+    static void fatal_signal(int sig)
+    {
+        instance()->flush_now();
+        for (unsigned i = 0; i < NUM_FATAL_SIGNALS; ++i)
+        {
+            if (FATAL_SIGNALS[i] == sig)
+            {
+                sigaction(sig, &oldActions_[i], nullptr);
+            }
+        }
+        raise(sig);
+    }
+
+    void *entry() override
+    {
+        while (true)
+        {
+            if (!drain_locked())
+            {
+                sleeping_ = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (drain_locked())
+                {
+                    sleeping_ = false;
+                    continue;
+                }
+                sem_.timedwait(MSEC_TO_NSEC(100));
+                sleeping_ = false;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @param r ring to look at.
+    /// @return the oldest record in the ring, or nullptr if the ring is
+    /// empty.
+    static RecordHeader *peek(Ring *r)
+    {
+        uint64_t head = r->head_.load(std::memory_order_acquire);
+        uint64_t tail = r->tail_.load(std::memory_order_relaxed);
+        while (tail < head)
+        {
+            size_t ofs = tail & (r->size_ - 1);
+            RecordHeader *h = (RecordHeader *)(r->data_ + ofs);
+            if (h->size)
+            {
+                return h;
+            }
+            // Wrap marker.
+            tail += r->size_ - ofs;
+            r->tail_.store(tail, std::memory_order_release);
+        }
+        return nullptr;
+    }
+
+    /// Takes the drainer role, then writes out the pending records.
+    /// @return true if anything was written.
+    bool drain_locked()
+    {
+        while (draining_.exchange(true))
+        {
+            // A dying thread is writing the messages.
+            usleep(1000);
+        }
+        bool ret = drain(true);
+        draining_ = false;
+        return ret;
+    }
+
+    /// Writes out all records from all rings in sequence order. The caller
+    /// must have set draining_. The records are rendered and written without
+    /// holding lock_, so a thread creating its ring does not wait for the
+    /// output.
+    /// @param cleanup true if the abandoned rings should be deleted.
+    /// @return true if anything was written.
+    bool drain(bool cleanup)
+    {
+        bool any = false;
+        while (true)
+        {
+            Ring *best = nullptr;
+            RecordHeader *best_h = nullptr;
+            for (Ring *r = rings_.load(std::memory_order_acquire); r;
+                 r = r->next_)
+            {
+                RecordHeader *h = peek(r);
+                if (h && (!best_h || h->seq < best_h->seq))
+                {
+                    best = r;
+                    best_h = h;
+                }
+            }
+            if (!best)
+            {
+                break;
+            }
+            int len = best_h->fn(buf_, sizeof(buf_), best_h->fmt,
+                (const uint8_t *)(best_h + 1));
+            if (len >= (int)sizeof(buf_))
+            {
+                len = sizeof(buf_) - 1;
+            }
+            output_.load()(buf_, len);
+            ++written_;
+            best->tail_.fetch_add(best_h->size, std::memory_order_release);
+            any = true;
+        }
+        for (Ring *r = rings_.load(std::memory_order_acquire); r;
+             r = r->next_)
+        {
+            uint64_t dropped = r->dropped_.load();
+            if (dropped != r->reportedDropped_)
+            {
+                int len = snprintf(buf_, sizeof(buf_),
+                    "async log: %u messages dropped",
+                    (unsigned)(dropped - r->reportedDropped_));
+                output_.load()(buf_, len);
+                r->reportedDropped_ = dropped;
+            }
+        }
+        if (!cleanup)
+        {
+            return any;
+        }
+        OSMutexLock l(&lock_);
+        if (flushing_)
+        {
+            return any;
+        }
+        Ring *head = rings_.load(std::memory_order_relaxed);
+        Ring **pp = &head;
+        while (*pp)
+        {
+            Ring *r = *pp;
+            if (r->abandoned_ && !peek(r))
+            {
+                *pp = r->next_;
+                droppedDeleted_ += r->dropped_.load();
+                delete r;
+                continue;
+            }
+            pp = &r->next_;
+        }
+        rings_.store(head, std::memory_order_release);
+        return any;
+    }
+
+    /// Wakes up the background thread.
+    OSSem sem_;
+    /// true if the background thread is waiting on sem_.
+    std::atomic<bool> sleeping_{false};
+    /// Number of flush calls in progress. Protected by lock_.
+    unsigned flushing_{0};
+    /// Set by the thread that is reading the rings.
+    std::atomic<bool> draining_{false};
+    /// Messages are rendered here. Owned by the thread that set draining_.
+    char buf_[4096];
+};
+
+constexpr int Logger::FATAL_SIGNALS[];
+struct sigaction Logger::oldActions_[Logger::NUM_FATAL_SIGNALS];
+
+/// Global sequence number of the messages.
+std::atomic<uint64_t> g_seq{0};
+
+/// Marks the ring of a thread abandoned when the thread exits.
+struct RingHolder
+{
+    ~RingHolder()
+    {
+        if (ring)
+        {
+            ring->abandoned_ = true;
+        }
+    }
+    /// The ring of the current thread.
+    Ring *ring = nullptr;
+};
+
+/// Ring of the current thread.
+thread_local RingHolder t_ring;
+
+} // namespace
+
+uint8_t *reserve(size_t payload_size, const char *fmt, FormatFn fn)
+{
+    Ring *r = t_ring.ring;
+    if (!r)
+    {
+        r = t_ring.ring = Logger::instance()->create_ring();
+    }
+    size_t need =
+        (sizeof(RecordHeader) + payload_size + ALIGN - 1) & ~(ALIGN - 1);
+    if (need > r->size_ / 2)
+    {
+        ++r->dropped_;
+        return nullptr;
+    }
+    uint64_t head = r->head_.load(std::memory_order_relaxed);
+    uint64_t tail = r->tail_.load(std::memory_order_acquire);
+    size_t ofs = head & (r->size_ - 1);
+    size_t to_end = r->size_ - ofs;
+    size_t total = to_end < need ? to_end + need : need;
+    if (head + total - tail > r->size_)
+    {
+        ++r->dropped_;
+        return nullptr;
+    }
+    if (to_end < need)
+    {
+        // Wrap marker; the record goes to the beginning of the ring.
+        ((RecordHeader *)(r->data_ + ofs))->size = 0;
+        head += to_end;
+        ofs = 0;
+    }
+    RecordHeader *h = (RecordHeader *)(r->data_ + ofs);
+    h->size = need;
+    h->seq = g_seq.fetch_add(1, std::memory_order_relaxed);
+    h->fn = fn;
+    h->fmt = fmt;
+    r->pending_ = head + need;
+    return (uint8_t *)(h + 1);
+}
+
+void commit()
+{
+    Ring *r = t_ring.ring;
+    r->head_.store(r->pending_, std::memory_order_release);
+    Logger::instance()->wakeup();
+}
+
+Stats stats()
+{
+    Logger *l = Logger::instance();
+    Stats s;
+    s.written = l->written_;
+    s.dropped = l->droppedDeleted_;
+    OSMutexLock lk(&l->lock_);
+    for (Ring *r = l->rings_; r; r = r->next_)
+    {
+        s.dropped += r->dropped_;
+    }
+    return s;
+}
+
+void flush()
+{
+    Logger::instance()->flush();
+}
+
+void flush_now()
+{
+    Logger::instance()->flush_now();
+}
+
+void set_output(void (*output)(char *buf, int size))
+{
+    Logger::instance()->output_ = output;
+}
+
+void set_ring_size(size_t bytes)
+{
+    size_t size = 1024;
+    while (size < bytes)
+    {
+        size <<= 1;
+    }
+    Logger::instance()->ringSize_ = size;
+}
+
+} // namespace async_log
+
+#endif // __linux__ || __MACH__
@@ -0,0 +1,242 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file AsyncLogging.hxx
+ *
+ * Logging backend that defers the formatting and output of log messages to a
+ * background thread.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_ASYNCLOGGING_HXX_
+#define _UTILS_ASYNCLOGGING_HXX_
+
+#if defined(__linux__) || defined(__MACH__)
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace async_log
+{
+
+/// Renders a log record into text.
+/// @param buf where to put the text.
+/// @param size number of bytes available in buf.
+/// @param fmt printf format string.
+/// @param payload the stored arguments.
+/// @return the return value of snprintf.
+typedef int (*FormatFn)(
+    char *buf, size_t size, const char *fmt, const uint8_t *payload);
+
+/// Reserves space for a log record in the ring of the current thread.
+/// @param payload_size number of bytes needed for the arguments.
+/// @param fmt printf format string. Must stay valid forever (usually a string
+/// literal).
+/// @param fn renders the record.
+/// @return where to write the arguments, or nullptr if the ring is full (the
+/// message is dropped and counted).
+uint8_t *reserve(size_t payload_size, const char *fmt, FormatFn fn);
+
+/// Makes the last reserved record visible to the background thread.
+void commit();
+
+/// Alignment of the payload in the ring.
+static constexpr size_t ALIGN = 8;
+
+/// Describes how an argument of type T is stored in the ring. By default the
+/// value is copied.
+template <class T> struct ArgTraits
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Only trivially copyable types can be passed to LOG.");
+    /// Type stored in the ring.
+    typedef T Stored;
+    /// @return number of bytes needed beside the Stored value.
+    static size_t extra(T)
+    {
+        return 0;
+    }
+    /// Converts the argument to the stored representation.
+    /// @param v the argument.
+    /// @param payload start of the record payload.
+    /// @param extra where to put the extra data; advanced after the data.
+    static Stored store(T v, uint8_t *payload, uint8_t **extra)
+    {
+        return v;
+    }
+    /// @return the argument to pass to snprintf.
+    static T load(const Stored &s, const uint8_t *payload)
+    {
+        return s;
+    }
+};
+
+/// Strings are copied into the ring, because the caller may free them before
+/// the message is rendered. The format string is not parsed, so every char
+/// pointer argument is taken as a NUL-terminated string, whatever conversion
+/// it is used with (see the restrictions at LOG in utils/logging.h).
+template <> struct ArgTraits<const char *>
+{
+    /// Offset of the copy from the start of the payload, or NULL_STRING.
+    typedef uint32_t Stored;
+    /// Marks a null string pointer.
+    static constexpr uint32_t NULL_STRING = 0xFFFFFFFFu;
+    static size_t extra(const char *v)
+    {
+        return v ? strlen(v) + 1 : 0;
+    }
+    static Stored store(const char *v, uint8_t *payload, uint8_t **extra)
+    {
+        if (!v)
+        {
+            return NULL_STRING;
+        }
+        size_t len = strlen(v) + 1;
+        memcpy(*extra, v, len);
+        Stored ret = *extra - payload;
+        *extra += len;
+        return ret;
+    }
+    static const char *load(const Stored &s, const uint8_t *payload)
+    {
+        return s == NULL_STRING ? nullptr : (const char *)(payload + s);
+    }
+};
+
+/// Non-const strings are stored the same way as const strings.
+template <> struct ArgTraits<char *> : public ArgTraits<const char *>
+{
+};
+
+/// Tuple of the stored arguments.
+template <class... Args>
+using StoredTuple = std::tuple<typename ArgTraits<Args>::Stored...>;
+
+/// Calls snprintf with the arguments unpacked from the payload.
+template <class... Args, size_t... I>
+int format_impl(char *buf, size_t size, const char *fmt,
+    const uint8_t *payload, std::index_sequence<I...>)
+{
+    const StoredTuple<Args...> &t =
+        *reinterpret_cast<const StoredTuple<Args...> *>(payload);
+    (void)t;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    return snprintf(
+        buf, size, fmt, ArgTraits<Args>::load(std::get<I>(t), payload)...);
+#pragma GCC diagnostic pop
+}
+
+/// Renders a record that was stored by log<Args...>.
+template <class... Args>
+int format(char *buf, size_t size, const char *fmt, const uint8_t *payload)
+{
+    return format_impl<Args...>(
+        buf, size, fmt, payload, std::index_sequence_for<Args...>());
+}
+
+/// @return the number of extra bytes needed by the arguments.
+inline size_t extra_size()
+{
+    return 0;
+}
+
+/// @return the number of extra bytes needed by the arguments.
+template <class T, class... Rest>
+size_t extra_size(const T &first, const Rest &...rest)
+{
+    return ArgTraits<T>::extra(first) + extra_size(rest...);
+}
+
+/// Stores the format pointer and the arguments of a log message into the
+/// ring of the current thread. The message will be rendered and written by
+/// the background thread.
+/// @param fmt printf format string.
+/// @param args the printf arguments.
+template <class... Args> void log(const char *fmt, Args... args)
+{
+    size_t tuple_size =
+        (sizeof(StoredTuple<typename std::decay<Args>::type...>) + ALIGN - 1) &
+        ~(ALIGN - 1);
+    uint8_t *payload = reserve(tuple_size + extra_size(args...), fmt,
+        &format<typename std::decay<Args>::type...>);
+    if (!payload)
+    {
+        return;
+    }
+    uint8_t *extra = payload + tuple_size;
+    new (payload) StoredTuple<typename std::decay<Args>::type...>(
+        ArgTraits<typename std::decay<Args>::type>::store(
+            args, payload, &extra)...);
+    commit();
+}
+
+/// Counters about the asynchronous logging.
+struct Stats
+{
+    /// Number of messages written.
+    unsigned long long written;
+    /// Number of messages dropped because a ring was full.
+    unsigned long long dropped;
+};
+
+/// @return the counters.
+Stats stats();
+
+/// Blocks the caller until all messages logged before the call have been
+/// written.
+void flush();
+
+/// Writes out all pending messages on the calling thread. Used on the fatal
+/// paths (LOG(FATAL), and the handler of SIGABRT and the other crash
+/// signals, which is installed when the first message is logged), where the
+/// background thread may not get to run anymore.
+void flush_now();
+
+/// Changes where the background thread writes the rendered messages. The
+/// default is ::log_output. Used by the unit tests.
+/// @param output function to call with each message.
+void set_output(void (*output)(char *buf, int size));
+
+/// Sets the size of the ring buffers created for new threads after this
+/// call.
+/// @param bytes size of the ring, rounded up to a power of two.
+void set_ring_size(size_t bytes);
+
+} // namespace async_log
+
+#endif // __linux__ || __MACH__
+
+#endif // _UTILS_ASYNCLOGGING_HXX_
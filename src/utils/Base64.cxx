@@ -34,43 +34,189 @@
 
 #include "utils/Base64.hxx"
 
+#include <string.h>
+
 #include "utils/macros.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+/// Use the SSSE3 implementation if the CPU supports it.
+#define BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
 static const char nib64[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-std::string base64_encode(const std::string &binary)
+/// Value of each input character for the decoder, with the same meaning as
+/// the return value of nib64_to_byte().
+static const uint8_t byte64[256] = {
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 62, 65, 62, 65, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 65, 65, 65, 64, 65, 65,
+    65, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 65, 65, 65, 65, 63,
+    65, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+    65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65, 65,
+};
+
+#ifdef BASE64_SSSE3
+
+/// Encodes 12 bytes to 16 characters at a time.
+/// @param src input bytes. 16 bytes are read from here.
+/// @param len number of input bytes.
+/// @param dst output characters.
+/// @return number of input bytes consumed, always divisible by 3.
+__attribute__((target("ssse3"))) static size_t base64_encode_ssse3(
+    const uint8_t *src, size_t len, char *dst)
+{
+    const __m128i shuf =
+        _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t ofs = 0;
+    // The load reads 16 bytes, but only 12 are used.
+    while (ofs + 16 <= len)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + ofs));
+        in = _mm_shuffle_epi8(in, shuf);
+        // Moves each 6-bit group into a separate byte.
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t1, t3);
+        // Translates 0..63 to the alphabet.
+        __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        result =
+            _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+        result = _mm_shuffle_epi8(shift_lut, result);
+        result = _mm_add_epi8(result, indices);
+        _mm_storeu_si128((__m128i *)dst, result);
+        ofs += 12;
+        dst += 16;
+    }
+    return ofs;
+}
+
+/// Decodes 16 characters to 12 bytes at a time. Stops at the first block that
+/// has anything other than the standard alphabet (including padding).
+/// @param src input characters.
+/// @param len number of input characters.
+/// @param dst output bytes. 16 bytes are written here for each 12 bytes of
+/// output.
+/// @return number of input characters consumed, always divisible by 4.
+__attribute__((target("ssse3"))) static size_t base64_decode_ssse3(
+    const char *src, size_t len, uint8_t *dst)
+{
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+        0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll =
+        _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    const __m128i pack = _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t ofs = 0;
+    while (ofs + 16 <= len)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + ofs));
+        __m128i hi_nibbles =
+            _mm_and_si128(_mm_srli_epi32(in, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(in, mask_2f);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i invalid = _mm_and_si128(lo, hi);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) !=
+            0xFFFF)
+        {
+            // Padding, URL alphabet or garbage; handled by the caller.
+            break;
+        }
+        __m128i eq_2f = _mm_cmpeq_epi8(in, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        __m128i values = _mm_add_epi8(in, roll);
+        // Packs four 6-bit values into three bytes.
+        __m128i merged =
+            _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, pack);
+        _mm_storeu_si128((__m128i *)dst, merged);
+        ofs += 16;
+        dst += 12;
+    }
+    return ofs;
+}
+
+/// @return true if the SSSE3 implementation can be used.
+static bool base64_have_ssse3()
+{
+    static bool have = __builtin_cpu_supports("ssse3");
+    return have;
+}
+
+#endif // BASE64_SSSE3
+
+size_t base64_encode(const void *binary, size_t len, char *out)
 {
-    std::string ret;
-    ret.reserve((binary.size() + 2) / 3 * 4);
-    unsigned ofs = 0;
-    while (ofs + 3 <= binary.size())
+    const uint8_t *src = static_cast<const uint8_t *>(binary);
+    char *dst = out;
+    size_t ofs = 0;
+#ifdef BASE64_SSSE3
+    if (base64_have_ssse3())
+    {
+        ofs = base64_encode_ssse3(src, len, dst);
+        dst += ofs / 3 * 4;
+    }
+#endif
+    while (ofs + 3 <= len)
     {
-        uint32_t d = (((uint8_t)binary[ofs]) << 16) //
-            | (((uint8_t)binary[ofs + 1]) << 8)     //
-            | (((uint8_t)binary[ofs + 2]));
-        ret.push_back(nib64[(d >> 18) & 63]);
-        ret.push_back(nib64[(d >> 12) & 63]);
-        ret.push_back(nib64[(d >> 6) & 63]);
-        ret.push_back(nib64[(d >> 0) & 63]);
+        uint32_t d = (src[ofs] << 16) | (src[ofs + 1] << 8) | src[ofs + 2];
+        dst[0] = nib64[(d >> 18) & 63];
+        dst[1] = nib64[(d >> 12) & 63];
+        dst[2] = nib64[(d >> 6) & 63];
+        dst[3] = nib64[(d >> 0) & 63];
+        dst += 4;
         ofs += 3;
     }
-    if (ofs + 1 == binary.size())
+    if (ofs + 1 == len)
     {
-        uint32_t d = (((uint8_t)binary[ofs]) << 16);
-        ret.push_back(nib64[(d >> 18) & 63]);
-        ret.push_back(nib64[(d >> 12) & 63]);
-        ret.push_back('=');
-        ret.push_back('=');
+        uint32_t d = src[ofs] << 16;
+        dst[0] = nib64[(d >> 18) & 63];
+        dst[1] = nib64[(d >> 12) & 63];
+        dst[2] = '=';
+        dst[3] = '=';
+        dst += 4;
     }
-    else if (ofs + 2 == binary.size())
+    else if (ofs + 2 == len)
+    {
+        uint32_t d = (src[ofs] << 16) | (src[ofs + 1] << 8);
+        dst[0] = nib64[(d >> 18) & 63];
+        dst[1] = nib64[(d >> 12) & 63];
+        dst[2] = nib64[(d >> 6) & 63];
+        dst[3] = '=';
+        dst += 4;
+    }
+    return dst - out;
+}
+
+std::string base64_encode(const std::string &binary)
+{
+    std::string ret(base64_encoded_size(binary.size()), 0);
+    if (!binary.empty())
     {
-        uint32_t d = (((uint8_t)binary[ofs]) << 16) //
-            | (((uint8_t)binary[ofs + 1]) << 8);
-        ret.push_back(nib64[(d >> 18) & 63]);
-        ret.push_back(nib64[(d >> 12) & 63]);
-        ret.push_back(nib64[(d >> 6) & 63]);
-        ret.push_back('=');
+        base64_encode(binary.data(), binary.size(), &ret[0]);
     }
     return ret;
 }
@@ -81,56 +227,78 @@ std::string base64_encode(const std::string &binary)
 /// 0..63 if it's a valid nibble.
 unsigned nib64_to_byte(char c)
 {
-    switch (c)
-    {
-        case '=':
-            return 64;
-        case '-':
-        case '+':
-            return 62;
-        case '_':
-        case '/':
-            return 63;
-        default:
-            break;
-    }
-    if ('A' <= c && c <= 'Z')
-    {
-        return c - 'A';
-    }
-    if ('a' <= c && c <= 'z')
+    return byte64[(uint8_t)c];
+}
+
+bool base64_decode(
+    const char *base64, size_t len, void *data, size_t *data_len)
+{
+    HASSERT(data_len);
+    uint8_t *dst = static_cast<uint8_t *>(data);
+    uint8_t *const start = dst;
+    size_t ofs = 0;
+#ifdef BASE64_SSSE3
+    // The SSSE3 decoder writes 16 bytes for every 12. Leaving the last 8
+    // characters to the scalar loop keeps these writes within
+    // base64_decoded_max_size(len).
+    if (len >= 24 && base64_have_ssse3())
     {
-        return c - 'a' + 26;
+        ofs = base64_decode_ssse3(base64, len - 8, dst);
+        dst += ofs / 4 * 3;
     }
-    if ('0' <= c && c <= '9')
+#endif
+    // Four characters at a time while there is no padding or error.
+    while (ofs + 4 <= len)
     {
-        return c - '0' + 52;
+        unsigned a = byte64[(uint8_t)base64[ofs]];
+        unsigned b = byte64[(uint8_t)base64[ofs + 1]];
+        unsigned c = byte64[(uint8_t)base64[ofs + 2]];
+        unsigned d = byte64[(uint8_t)base64[ofs + 3]];
+        if ((a | b | c | d) >= 64)
+        {
+            break;
+        }
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        dst[0] = v >> 16;
+        dst[1] = v >> 8;
+        dst[2] = v;
+        dst += 3;
+        ofs += 4;
     }
-    return 65;
-}
-
-bool base64_decode(const std::string &base64, std::string *data)
-{
-    HASSERT(data);
-    data->clear();
+    // Remainder: padding, errors and incomplete groups.
     unsigned a = 0;
     unsigned have = 0; // how many bits we have in the accumulator
-    unsigned ofs = 0;  // next input byte.
-    while (ofs < base64.size())
+    bool ok = true;
+    while (ofs < len)
     {
-        int nib = nib64_to_byte(base64[ofs++]);
+        unsigned nib = byte64[(uint8_t)base64[ofs++]];
         if (nib >= 65)
-            return false;
+        {
+            ok = false;
+            break;
+        }
         if (nib == 64)
-            return true;
+            break;
         a <<= 6;
         a |= (nib & 63);
         have += 6;
         if (have >= 8)
         {
-            data->push_back((char)((a >> (have - 8)) & 0xff));
+            *dst++ = (a >> (have - 8)) & 0xff;
             have -= 8;
         }
     }
-    return true;
+    *data_len = dst - start;
+    return ok;
+}
+
+bool base64_decode(const std::string &base64, std::string *data)
+{
+    HASSERT(data);
+    data->resize(base64_decoded_max_size(base64.size()));
+    size_t len = 0;
+    bool ret = base64_decode(base64.data(), base64.size(),
+        data->empty() ? nullptr : &(*data)[0], &len);
+    data->resize(len);
+    return ret;
 }
@@ -35,13 +35,38 @@
 #ifndef _UTILS_BASE64_HXX_
 #define _UTILS_BASE64_HXX_
 
+#include <stddef.h>
 #include <string>
 
+/// @param len number of bytes to encode.
+/// @return the length of the base64 representation of len bytes.
+inline size_t base64_encoded_size(size_t len)
+{
+    return (len + 2) / 3 * 4;
+}
+
+/// @param len number of base64 characters to decode.
+/// @return the largest number of bytes that len characters of base64 can
+/// decode to.
+inline size_t base64_decoded_max_size(size_t len)
+{
+    return (len + 3) / 4 * 3;
+}
+
 /// Performs encoding of data in base64 format.
 /// @param binary data to encode
 /// @return base64 representation. The size will be (binary.size() + 2) / 3 * 4.
 std::string base64_encode(const std::string &binary);
 
+/// Performs encoding of data in base64 format into a caller-supplied buffer.
+/// @param binary data to encode
+/// @param len number of bytes in binary
+/// @param out the base64 representation will be written here. Must have
+/// space for base64_encoded_size(len) characters. No terminating null is
+/// written.
+/// @return number of characters written.
+size_t base64_encode(const void *binary, size_t len, char *out);
+
 /// Performs decoding of data from base64 format to binary.
 /// @param base64 base64 encoded data
 /// @param data decoded data will be written here.
@@ -49,4 +74,16 @@ std::string base64_encode(const std::string &binary);
 /// erroneous, in which case the content of data is undefined.
 bool base64_decode(const std::string &base64, std::string *data);
 
+/// Performs decoding of data from base64 format into a caller-supplied
+/// buffer.
+/// @param base64 base64 encoded data
+/// @param len number of characters in base64
+/// @param data decoded data will be written here. Must have space for
+/// base64_decoded_max_size(len) bytes.
+/// @param data_len will be set to the number of bytes decoded.
+/// @return true if decoding was successful. false if the encoding was
+/// erroneous, in which case the content of data is undefined.
+bool base64_decode(
+    const char *base64, size_t len, void *data, size_t *data_len);
+
 #endif // _UTILS_BASE64_HXX_
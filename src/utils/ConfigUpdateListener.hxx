@@ -36,6 +36,8 @@
 #ifndef _UTILS_CONFIGUPDATELISTENER_HXX_
 #define _UTILS_CONFIGUPDATELISTENER_HXX_
 
+#include <limits.h>
+
 #include "utils/QMember.hxx"
 #include "executor/Notifiable.hxx"
 
@@ -96,6 +98,43 @@ public:
     /// @param fd is the file descriptor for the EEPROM file. The current
     /// offset in this file is unspecified, callees must do lseek.
     virtual void factory_reset(int fd) = 0;
+
+    /// Declares which part of the configuration file this component reads in
+    /// apply_configuration. The update runner will skip calling the component
+    /// when a configuration update did not touch this range. By default the
+    /// component is called for every update.
+    ///
+    /// @param offset is the address of the first byte in the config file.
+    /// @param size is the number of bytes.
+    void set_config_range(unsigned offset, unsigned size)
+    {
+        configOffset_ = offset;
+        configSize_ = size;
+    }
+
+    /// Declares the configuration range of this component from a config
+    /// reference, such as a CDI group or a repeated group.
+    template <class Ref> void set_config_range(const Ref &cfg)
+    {
+        set_config_range(cfg.offset(), cfg.size());
+    }
+
+    /// @return true if any of the bytes [begin, end) of the configuration
+    /// file belong to this component.
+    bool config_range_overlaps(unsigned begin, unsigned end) const
+    {
+        // Either the range starts inside our range, or our range starts
+        // inside the range. Written so that it works with configSize_ ==
+        // UINT_MAX as well.
+        return (begin - configOffset_ < configSize_) ||
+            (configOffset_ - begin < end - begin);
+    }
+
+private:
+    /// First byte of the configuration file this component reads.
+    unsigned configOffset_ = 0;
+    /// Number of bytes of the configuration this component reads.
+    unsigned configSize_ = UINT_MAX;
 };
 
 
@@ -35,6 +35,8 @@
 #ifndef _UTILS_CONFIGUPDATESERVICE_HXX_
 #define _UTILS_CONFIGUPDATESERVICE_HXX_
 
+#include <stddef.h>
+
 #include "utils/Singleton.hxx"
 
 class ConfigUpdateListener;
@@ -61,6 +63,56 @@ public:
 
     /// Executes an update in response to the configuration having changed.
     virtual void trigger_update() = 0;
+
+    /// Adds a listener that will be called before all regular listeners in
+    /// every update. This is meant for components that cache writes to the
+    /// configuration file, and need to flush them before the other listeners
+    /// read the file. Sync listeners get no initial load call.
+    ///
+    /// @param listener pointer to the implementation that needs to be called
+    /// at the beginning of each update.
+    ///
+    virtual void register_sync_listener(ConfigUpdateListener *listener)
+    {
+        register_update_listener(listener);
+    }
+
+    /// Removes a listener added by \ref register_sync_listener.
+    ///
+    /// @param listener pointer to the implementation that needs to be removed.
+    ///
+    virtual void unregister_sync_listener(ConfigUpdateListener *listener)
+    {
+        unregister_update_listener(listener);
+    }
+
+    /// Records that a range of the configuration file was written. If the
+    /// implementation supports it and it is enabled, the next update will
+    /// only call the listeners whose configuration range overlaps a range
+    /// written since the previous update. If nothing was recorded, all
+    /// listeners are called.
+    ///
+    /// @param offset is the address of the first byte written.
+    /// @param len is the number of bytes written.
+    ///
+    virtual void mark_dirty(unsigned offset, size_t len)
+    {
+    }
+
+    /// Serves a read of the configuration file from an in-memory copy, if
+    /// there is one.
+    ///
+    /// @param fd is the file descriptor the caller would read from.
+    /// @param offset is the address of the first byte to read.
+    /// @param buf is where to copy the data.
+    /// @param len is the number of bytes to read.
+    /// @return true if the data was copied to buf, false if the caller needs
+    /// to read the file.
+    ///
+    virtual bool shadow_read(int fd, unsigned offset, void *buf, size_t len)
+    {
+        return false;
+    }
 };
 
 #endif // _UTILS_CONFIGUPDATESERVICE_HXX_
@@ -33,6 +33,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include "utils/Crc.hxx"
 #include "utils/macros.h"
@@ -85,6 +86,33 @@ inline uint16_t crc_16_ibm_finish(uint16_t state) {
     //return state;
     }*/
 
+#if defined(CRC16_IBM_SMALL_TABLE) &&                                         \
+    (defined(CRC16_IBM_BYTE_TABLE) || defined(CRC16_IBM_SLICE_BY_8))
+#error CRC16_IBM_SMALL_TABLE cannot be combined with CRC16_IBM_BYTE_TABLE or CRC16_IBM_SLICE_BY_8.
+#endif
+
+#if !defined(CRC16_IBM_SMALL_TABLE) && !defined(CRC16_IBM_BYTE_TABLE) &&     \
+    !defined(CRC16_IBM_SLICE_BY_8)
+#if (defined(__linux__) || defined(__MACH__)) && defined(__BYTE_ORDER__) &&   \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/// Hosts have plenty of memory, so they use the fastest software
+/// implementation.
+#define CRC16_IBM_SLICE_BY_8
+#else
+/// MCU builds (e.g. bootloaders) keep the flash footprint small by default.
+#define CRC16_IBM_SMALL_TABLE
+#endif
+#endif
+
+#ifdef CRC16_IBM_SMALL_TABLE
+
+/// CRC16-IBM of each 4-bit value. Processes the input one nibble at a time,
+/// for MCUs where flash space is more important than speed.
+static const uint16_t crc_16_ibm_nibble_table[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400,
+};
+
 /// Appends a byte to a CRC16 state machine.
 ///
 /// @param state the state machine of the CRC computer.
@@ -92,15 +120,60 @@ inline uint16_t crc_16_ibm_finish(uint16_t state) {
 ///
 inline void crc_16_ibm_add(uint16_t& state, uint8_t data) {
     state ^= data;
-    for (int i = 0; i < 8; i++) {
-        if (state & 1) {
-            state = (state >> 1) ^ crc_16_ibm_poly;
-        } else {
-            state = (state >> 1);
-        }
-    }
+    state = (state >> 4) ^ crc_16_ibm_nibble_table[state & 0xf];
+    state = (state >> 4) ^ crc_16_ibm_nibble_table[state & 0xf];
 }
 
+#else
+
+/// CRC16-IBM of each byte value, i.e. the effect of shifting a byte through
+/// the state machine with the polynomial crc_16_ibm_poly.
+static const uint16_t crc_16_ibm_table[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+/// Appends a byte to a CRC16 state machine.
+///
+/// @param state the state machine of the CRC computer.
+/// @param data next byte to add.
+///
+inline void crc_16_ibm_add(uint16_t& state, uint8_t data) {
+    state = (state >> 8) ^ crc_16_ibm_table[(state ^ data) & 0xff];
+}
+
+#endif // CRC16_IBM_SMALL_TABLE
+
 /// Finalizes the state machine of a CRC16-IBM calculator.
 ///
 /// @param state internal state of the machine.
@@ -116,12 +189,78 @@ inline uint16_t crc_16_ibm_finish(uint16_t state) {
 }
 
 
-uint16_t crc_16_ibm(const void* data, size_t length) {
-    const uint8_t *payload = static_cast<const uint8_t*>(data);
-    uint16_t state = crc_16_ibm_init_value;
+#ifdef CRC16_IBM_SLICE_BY_8
+
+/// Tables for computing the CRC 8 bytes at a time. Entry [k][i] is the state
+/// after adding byte i then k zero bytes to a zero state.
+static uint16_t crc_16_ibm_slice_table[8][256];
+
+/// Fills in crc_16_ibm_slice_table.
+/// @return true.
+static bool crc_16_ibm_init_slice_table() {
+    for (unsigned i = 0; i < 256; ++i) {
+        crc_16_ibm_slice_table[0][i] = crc_16_ibm_table[i];
+    }
+    for (unsigned k = 1; k < 8; ++k) {
+        for (unsigned i = 0; i < 256; ++i) {
+            uint16_t prev = crc_16_ibm_slice_table[k - 1][i];
+            crc_16_ibm_slice_table[k][i] =
+                (prev >> 8) ^ crc_16_ibm_table[prev & 0xff];
+        }
+    }
+    return true;
+}
+
+/// Adds a block of bytes to a CRC16 state machine, 8 bytes at a time.
+///
+/// @param state the state machine of the CRC computer.
+/// @param payload bytes to add.
+/// @param length number of bytes to add.
+///
+static void crc_16_ibm_add_block(
+    uint16_t &state, const uint8_t *payload, size_t length) {
+    // Thread-safe one-time initialization.
+    static bool init = crc_16_ibm_init_slice_table();
+    (void)init;
+    const auto &t = crc_16_ibm_slice_table;
+    uint32_t s = state;
+    for (; length >= 8; length -= 8, payload += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, payload, 4);
+        memcpy(&hi, payload + 4, 4);
+        lo ^= s;
+        s = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+            t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^
+            t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^
+            t[0][hi >> 24];
+    }
+    state = s;
+    for (size_t i = 0; i < length; ++i) {
+        crc_16_ibm_add(state, payload[i]);
+    }
+}
+
+#else
+
+/// Adds a block of bytes to a CRC16 state machine.
+///
+/// @param state the state machine of the CRC computer.
+/// @param payload bytes to add.
+/// @param length number of bytes to add.
+///
+static inline void crc_16_ibm_add_block(
+    uint16_t &state, const uint8_t *payload, size_t length) {
     for (size_t i = 0; i < length; ++i) {
         crc_16_ibm_add(state, payload[i]);
     }
+}
+
+#endif // CRC16_IBM_SLICE_BY_8
+
+uint16_t crc_16_ibm(const void* data, size_t length) {
+    const uint8_t *payload = static_cast<const uint8_t*>(data);
+    uint16_t state = crc_16_ibm_init_value;
+    crc_16_ibm_add_block(state, payload, length);
     return crc_16_ibm_finish(state);
 }
 
@@ -153,15 +292,16 @@ void crc3_crc16_ibm(const void* data, size_t length_bytes, uint16_t* checksum) {
   }
 #else
   const uint8_t *payload = static_cast<const uint8_t*>(data);
-  for (size_t i = 1; i <= length_bytes; ++i) {
-    crc_16_ibm_add(state1, payload[i-1]);
-    if (i & 1) {
-      // odd byte
-      crc_16_ibm_add(state2, payload[i-1]);
-    } else {
-      // even byte
-      crc_16_ibm_add(state3, payload[i-1]);
-    }
+  crc_16_ibm_add_block(state1, payload, length_bytes);
+  size_t i = 0;
+  for (; i + 1 < length_bytes; i += 2) {
+    // odd byte
+    crc_16_ibm_add(state2, payload[i]);
+    // even byte
+    crc_16_ibm_add(state3, payload[i + 1]);
+  }
+  if (i < length_bytes) {
+    crc_16_ibm_add(state2, payload[i]);
   }
 #endif
 
@@ -39,6 +39,14 @@
  * CRC16-IBM) settings. This involves zero init value, zero terminating value,
  * reversed polynomial 0xA001, reversing input bits and reversing output
  * bits. The example CRC value of "123456789" is 0xbb3d.
+ *
+ * The implementation is table-driven. Hosts use slice-by-8 with a 512-byte
+ * table and 4 KB of tables generated upon first use. MCU builds default to a
+ * 32-byte table (CRC16_IBM_SMALL_TABLE), which processes a nibble at a time.
+ * Defining CRC16_IBM_BYTE_TABLE when compiling Crc.cxx selects the 512-byte
+ * table instead, which is faster but costs 480 more bytes of flash; defining
+ * CRC16_IBM_SLICE_BY_8 forces slice-by-8 on a little-endian target.
+ * CRC16_IBM_SMALL_TABLE cannot be combined with the other two.
  * @param data what to compute the checksum over
  * @param length_bytes how long data is
  * @return the CRC-16-IBM value of the checksummed data.
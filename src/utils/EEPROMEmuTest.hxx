@@ -1,5 +1,9 @@
 #include "utils/test_main.hxx"
 
+#include <functional>
+
+#include "os/OS.hxx"
+
 // We have to avoid pulling in freertos stuff. We redefine the base class to
 // avoid dependency on hand-written fileio stuff.
 #define _FREERTOS_DRIVERS_COMMON_EEPROM_HXX_
@@ -44,6 +48,9 @@ public:
         return fileSize;
     }
 
+protected:
+    OSMutex lock_; ///< protects internal structures.
+
 private:
     size_t fileSize; ///< size of the eeprom.
 };
@@ -94,17 +101,40 @@ public:
         LOG(INFO, "sector count %d, active index %d, slot count %d, available count %d", sector_count(), activeSector_, slot_count(), avail());
     }
 
+    /// @return the lock that the device holds during reads and writes.
+    OSMutex *device_lock() {
+        return &lock_;
+    }
+
     /// @return how many blocks are available in the current sector.
     unsigned avail() {
         return availableSlots_;
     }
 
+    /// Simulated time it takes to erase a sector.
+    static constexpr long long ERASE_USEC = 20000;
+    /// Simulated time it takes to program a block.
+    static constexpr long long PROGRAM_USEC = 50;
+    /// Total simulated time spent in flash operations.
+    long long simTimeUsec_ = 0;
+    /// Called after every flash operation.
+    std::function<void()> onFlashOp_;
+    /// Called before every sector erase.
+    std::function<void()> onErase_;
+
 private:
     void flash_erase(unsigned sector) override {
+        if (onErase_) {
+            onErase_();
+        }
         ASSERT_LE(0u, sector);
         ASSERT_GT(EELEN / SECTOR_SIZE, sector);
         void* address = &foo::__eeprom_start[sector * SECTOR_SIZE];
         memset(address, 0xff, SECTOR_SIZE);
+        simTimeUsec_ += ERASE_USEC;
+        if (onFlashOp_) {
+            onFlashOp_();
+        }
     }
 
     void flash_program(unsigned sector, unsigned block, uint32_t *data, uint32_t byte_count) override {
@@ -115,6 +145,10 @@ private:
         ASSERT_EQ(0u, byte_count % BLOCK_SIZE);
         uint8_t* address = &foo::__eeprom_start[sector * SECTOR_SIZE + block * BLOCK_SIZE];
         memcpy(address, data, byte_count);
+        simTimeUsec_ += PROGRAM_USEC * (byte_count / BLOCK_SIZE);
+        if (onFlashOp_) {
+            onFlashOp_();
+        }
     }
 
     const uint32_t* block(unsigned sector, unsigned index) override {
@@ -155,6 +189,28 @@ protected:
         ee()->write(ofs, payload.data(), payload.size());
     }
 
+    /// Writes to the test eeprom holding the device lock, like the file
+    /// write of the device does.
+    ///
+    /// @param ofs where to write
+    /// @param payload what to write
+    ///
+    void device_write(unsigned ofs, const string &payload)
+    {
+        OSMutexLock l(e->device_lock());
+        write_to(ofs, payload);
+    }
+
+    /// Reads the entire test eeprom holding the device lock.
+    /// @return the eeprom contents.
+    string device_read()
+    {
+        OSMutexLock l(e->device_lock());
+        string ret(eeprom_size, 0);
+        ee()->read(0, &ret[0], eeprom_size);
+        return ret;
+    }
+
     /// @return the eeprom implementation under test.
     EEPROM* ee() {
         return static_cast<EEPROM*>(e.operator->());
@@ -289,3 +345,215 @@ TEST_F(EepromTest, many_overflow) {
     EXPECT_AT(13, "abcd");
     EXPECT_EQ(s, e->activeSector_);
 }
+
+/// Measures how long it takes after a reboot to load the entire config file
+/// from a journal that is almost full.
+TEST_F(EepromTest, boot_load) {
+    create();
+    string data;
+    for (unsigned i = 0; i < eeprom_size; ++i) {
+        data.push_back((i * 13) & 0xff);
+    }
+    write_to(0, data);
+    // Keeps updating a few variables until the sector is almost full.
+    for (unsigned i = 0; e->avail() > 10; ++i) {
+        unsigned ofs = 100 + (i % 50) * 2;
+        data[ofs] = i & 0xff;
+        write_to(ofs, data.substr(ofs, 1));
+    }
+    EXPECT_EQ(0, e->activeSector_);
+
+    static constexpr unsigned BOOTS = 20;
+    long long start = os_get_time_monotonic();
+    for (unsigned b = 0; b < BOOTS; ++b) {
+        create(false);
+        // Reads the config like the initial load of the config update flow.
+        string loaded(eeprom_size, 0);
+        for (unsigned ofs = 0; ofs < eeprom_size; ofs += 64) {
+            ee()->read(ofs, &loaded[ofs], std::min(64u, eeprom_size - ofs));
+        }
+        ASSERT_EQ(data, loaded);
+    }
+    printf("shadow %d index %d: mount and load of %u bytes took %.1f usec\n",
+        EEPROMEmulation::SHADOW_IN_RAM, EEPROMEmulation::INDEX_IN_RAM,
+        eeprom_size, (os_get_time_monotonic() - start) / 1000.0 / BOOTS);
+}
+
+/// Writes to an eeprom until it went through a few sectors, and measures the
+/// longest time (of simulated flash operations) a single write took.
+/// @param e the eeprom under test
+/// @param data current contents of the file, will be updated
+/// @param incremental if true, runs a compaction step after every write
+/// @return largest write latency in usec
+long long worst_write_latency(MyEEPROM *e, string *data, bool incremental) {
+    unsigned sector = e->activeSector_;
+    unsigned num_compactions = 0;
+    long long worst = 0;
+    for (unsigned i = 0; num_compactions < 3; ++i) {
+        unsigned ofs = 100 + (i % 50) * 2;
+        (*data)[ofs] = i & 0xff;
+        long long start = e->simTimeUsec_;
+        static_cast<EEPROM*>(e)->write(ofs, &(*data)[ofs], 1);
+        worst = std::max(worst, e->simTimeUsec_ - start);
+        if (incremental) {
+            e->compact_step();
+        }
+        if (e->activeSector_ != sector) {
+            sector = e->activeSector_;
+            ++num_compactions;
+        }
+    }
+    return worst;
+}
+
+TEST_F(EepromTest, incremental_compaction_latency) {
+    string data;
+    for (unsigned i = 0; i < eeprom_size; ++i) {
+        data.push_back((i * 13) & 0xff);
+    }
+    create();
+    write_to(0, data);
+    long long sync_worst = worst_write_latency(e.get(), &data, false);
+
+    create();
+    e->enable_incremental_compaction(64, 16);
+    write_to(0, data);
+    long long incremental_worst = worst_write_latency(e.get(), &data, true);
+    string loaded(eeprom_size, 0);
+    ee()->read(0, &loaded[0], eeprom_size);
+    EXPECT_EQ(data, loaded);
+    create(false);
+    ee()->read(0, &loaded[0], eeprom_size);
+    EXPECT_EQ(data, loaded);
+
+    printf("worst case write latency: synchronous compaction %lld usec, "
+           "incremental compaction %lld usec\n",
+        sync_worst, incremental_worst);
+    EXPECT_LT(incremental_worst * 10, sync_worst);
+}
+
+/// Simulates a power failure after every single flash operation while
+/// writing and compacting, and checks that the data is consistent after a
+/// reboot.
+TEST_F(EepromTest, incremental_compaction_crash) {
+    string before;
+    for (unsigned i = 0; i < eeprom_size; ++i) {
+        before.push_back((i * 13) & 0xff);
+    }
+    create();
+    write_to(0, before);
+    e->enable_incremental_compaction(64, 16);
+    string after = before;
+
+    unsigned num_checks = 0;
+    unsigned num_failures = 0;
+    std::unique_ptr<uint8_t[]> saved(new uint8_t[EELEN]);
+    e->onFlashOp_ = [&]() {
+        ++num_checks;
+        memcpy(saved.get(), foo::__eeprom_start, EELEN);
+        {
+            // Reboots from the current flash contents.
+            MyEEPROM rebooted(eeprom_size, false);
+            string loaded(eeprom_size, 0);
+            static_cast<EEPROM*>(&rebooted)->read(0, &loaded[0], eeprom_size);
+            if (loaded != before && loaded != after) {
+                ++num_failures;
+            }
+        }
+        memcpy(foo::__eeprom_start, saved.get(), EELEN);
+    };
+
+    unsigned sector = e->activeSector_;
+    unsigned num_compactions = 0;
+    for (unsigned i = 0; num_compactions < 2; ++i) {
+        unsigned ofs = (i * 37) % eeprom_size;
+        after[ofs] = i & 0xff;
+        write_to(ofs, after.substr(ofs, 1));
+        before = after;
+        e->compact_step();
+        if (e->activeSector_ != sector) {
+            sector = e->activeSector_;
+            ++num_compactions;
+        }
+    }
+    e->onFlashOp_ = nullptr;
+    EXPECT_EQ(0u, num_failures);
+    EXPECT_LT(2000u, num_checks);
+    create(false);
+    EXPECT_AT(0, after);
+}
+
+/// Writes from the test thread while a compaction thread compacts the
+/// eeprom in the background.
+TEST_F(EepromTest, compaction_thread) {
+    string data;
+    for (unsigned i = 0; i < eeprom_size; ++i) {
+        data.push_back((i * 13) & 0xff);
+    }
+    create();
+    e->enable_incremental_compaction(64, 16);
+    device_write(0, data);
+    EEPROMCompactionThread compactor(e.get());
+    compactor.start("eecompact", 0, 2048);
+
+    unsigned sector = e->activeSector_;
+    unsigned num_compactions = 0;
+    for (unsigned i = 0; num_compactions < 3; ++i) {
+        unsigned ofs = (i * 37) % eeprom_size;
+        data[ofs] = i & 0xff;
+        device_write(ofs, data.substr(ofs, 1));
+        if (i % 100 == 0) {
+            ASSERT_EQ(data, device_read());
+        }
+        OSMutexLock l(e->device_lock());
+        if (e->activeSector_ != sector) {
+            sector = e->activeSector_;
+            ++num_compactions;
+        }
+    }
+    compactor.stop();
+    EXPECT_EQ(data, device_read());
+    create(false);
+    EXPECT_EQ(data, device_read());
+}
+
+/// Checks that a write does not wait for the erase of the next sector that
+/// the compaction thread is performing.
+TEST_F(EepromTest, write_during_erase) {
+    string data(eeprom_size, 0x5a);
+    create();
+    e->enable_incremental_compaction(64, 16);
+    device_write(0, data);
+    EEPROMCompactionThread compactor(e.get());
+    compactor.start("eecompact", 0, 2048);
+
+    OSSem erase_started;
+    OSSem write_done;
+    bool write_blocked = false;
+    bool first_erase = true;
+    e->onErase_ = [&]() {
+        if (!first_erase) {
+            return;
+        }
+        first_erase = false;
+        erase_started.post();
+        // Holds up the erase until the test thread performed a write.
+        if (write_done.timedwait(MSEC_TO_NSEC(500)) != 0) {
+            write_blocked = true;
+        }
+    };
+    for (unsigned i = 0; erase_started.timedwait(0) != 0; ++i) {
+        unsigned ofs = (i * 37) % eeprom_size;
+        data[ofs] = i & 0xff;
+        device_write(ofs, data.substr(ofs, 1));
+        usleep(100);
+    }
+    data[7] = 0x17;
+    device_write(7, data.substr(7, 1));
+    write_done.post();
+    compactor.stop();
+    EXPECT_FALSE(write_blocked);
+    EXPECT_EQ(data, device_read());
+    create(false);
+    EXPECT_EQ(data, device_read());
+}
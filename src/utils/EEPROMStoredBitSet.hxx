@@ -73,6 +73,13 @@ protected:
     /// @param value is the data to write to that cell.
     static void write_cell(unsigned cell_offset, eeprom_t value);
 
+    /// Writes consecutive cells of the physical storage in one operation.
+    /// @param cell_offset the first eeprom cell to write.
+    /// @param values is the data to write, count entries.
+    /// @param count how many cells to write.
+    static void write_cells(
+        unsigned cell_offset, const eeprom_t *values, unsigned count);
+
     /// Reads from the physical storage.
     /// @param cell_offset the eeprom cell to read.
     /// @return the last written value of that cell.
@@ -90,15 +97,24 @@ public:
               HW::bits_per_cell())
     {
         mount();
+        clear_stats();
     }
 
+    /// Writes the dirty cells to the journal. All dirty cells are collected
+    /// into runs that are written with one storage operation each. The first
+    /// entry of a run is written last, which makes the entire run valid at
+    /// once.
     void flush() override
     {
+        eeprom_t run[MAX_RUN];
+        auto c = ShadowedStoredBitSet::next_dirty();
+        if (c == NO_CELL)
+        {
+            return;
+        }
+        count_flush();
         do
         {
-            auto c = ShadowedStoredBitSet::next_dirty();
-            if (c == NO_CELL)
-                break;
             if (writeOffset_ >= HW::physical_cell_count())
             {
                 // Wrap around.
@@ -107,19 +123,35 @@ public:
                 clear_all_dirty();
                 return;
             }
-            if (writeOffset_ + 1 < HW::physical_cell_count())
+            unsigned n = 0;
+            unsigned space = HW::physical_cell_count() - writeOffset_;
+            while (c != NO_CELL && n < MAX_RUN && n < space)
             {
-                auto v = HW::read_cell(writeOffset_ + 1);
+                // Clears the dirty bit first, so that a concurrent change
+                // after we read the value will make the cell dirty again.
+                clear_dirty(c);
+                run[n++] = get_vcell(c);
+                c = ShadowedStoredBitSet::next_dirty();
+            }
+            unsigned end = writeOffset_ + n;
+            if (end < HW::physical_cell_count())
+            {
+                auto v = HW::read_cell(end);
                 if ((v & MARKER_MASK) == currentMarker_)
                 {
-                    // This is a problem. If we write the second magic now, the
+                    // This is a problem. If we write the run now, the
                     // additional entry will become a valid journal entry.
-                    HW::write_cell(
-                        writeOffset_ + 1, (~currentMarker_) & MARKER_MASK);
+                    write_cell(end, (~currentMarker_) & MARKER_MASK);
                 }
             }
-            HW::write_cell(writeOffset_++, get_vcell(c));
-        } while (true);
+            if (n > 1)
+            {
+                HW::write_cells(writeOffset_ + 1, run + 1, n - 1);
+                count_write(n - 1);
+            }
+            write_cell(writeOffset_, run[0]);
+            writeOffset_ = end;
+        } while (c != NO_CELL);
     }
 
 private:
@@ -187,6 +219,15 @@ private:
         }
     }
 
+    /// Writes one cell of the physical storage.
+    /// @param cell_offset the eeprom cell to write.
+    /// @param value is the data to write to that cell.
+    void write_cell(unsigned cell_offset, eeprom_t value)
+    {
+        HW::write_cell(cell_offset, value);
+        count_write(1);
+    }
+
     void format()
     {
         for (unsigned j = JOURNAL_OFS; j < HW::physical_cell_count(); ++j)
@@ -194,7 +235,7 @@ private:
             eeprom_t v = HW::read_cell(j);
             if (v != 0)
             {
-                HW::write_cell(j, 0);
+                write_cell(j, 0);
             }
         }
         currentMarker_ = MARKER_MASK;
@@ -203,7 +244,7 @@ private:
 
     void write_header()
     {
-        HW::write_cell(FIRST_MAGIC_OFS, MAGIC | currentMarker_);
+        write_cell(FIRST_MAGIC_OFS, MAGIC | currentMarker_);
         for (unsigned i = 0; i < HW::virtual_cell_count(); ++i)
         {
             eeprom_t ov = HW::read_cell(i + HEADER_OFS);
@@ -213,16 +254,16 @@ private:
                 // Didn't change, skip write.
                 continue;
             }
-            HW::write_cell(i + HEADER_OFS, nv);
+            write_cell(i + HEADER_OFS, nv);
         }
         eeprom_t v = HW::read_cell(JOURNAL_OFS);
         if ((v & MARKER_MASK) == currentMarker_)
         {
             // This is a problem. If we write the second magic now, the
             // additional entry will become a valid journal entry.
-            HW::write_cell(JOURNAL_OFS, (~currentMarker_) & MARKER_MASK);
+            write_cell(JOURNAL_OFS, (~currentMarker_) & MARKER_MASK);
         }
-        HW::write_cell(SECOND_MAGIC_OFS, MAGIC | currentMarker_);
+        write_cell(SECOND_MAGIC_OFS, MAGIC | currentMarker_);
         writeOffset_ = JOURNAL_OFS;
     }
 
@@ -266,6 +307,10 @@ private:
 
     static constexpr eeprom_t ERASED = 0xFFFFFFFFU & EEPROM_MASK;
 
+    /// How many journal entries are written with one storage operation at
+    /// most.
+    static constexpr unsigned MAX_RUN = 16;
+
     static constexpr unsigned FIRST_MAGIC_OFS = 0;
     static constexpr unsigned SECOND_MAGIC_OFS = 1;
     static constexpr unsigned HEADER_OFS = 2;
@@ -61,6 +61,30 @@ struct FdUtils
         }
     }
 
+    /// Performs a reliable read from the given FD at a given offset, without
+    /// using or changing the file position. Crashes if the read fails.
+    ///
+    /// @param fd the file to read data from
+    /// @param buf the location to write data to
+    /// @param size how many bytes to read
+    /// @param offset where to read from in the file
+    static void repeated_pread(int fd, void *buf, size_t size, off_t offset)
+    {
+        uint8_t *dst = static_cast<uint8_t *>(buf);
+        while (size)
+        {
+            ssize_t ret = ::pread(fd, dst, size, offset);
+            ERRNOCHECK("pread", ret);
+            if (ret == 0)
+            {
+                DIE("Unexpected EOF reading the config file.");
+            }
+            size -= ret;
+            dst += ret;
+            offset += ret;
+        }
+    }
+
     /// Performs a reliable write to the given FD. Crashes if the write fails.
     ///
     /// @param fd the file to write data to
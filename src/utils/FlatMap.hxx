@@ -0,0 +1,180 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file FlatMap.hxx
+ *
+ * Map stored as a sorted array.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_FLATMAP_HXX_
+#define _UTILS_FLATMAP_HXX_
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+#include "utils/macros.h"
+
+/** Map that keeps its entries in a vector sorted by key, and finds them by
+ * binary search. Compared to a tree there is no per-entry allocation and no
+ * pointer chasing, so lookups are fast and the memory overhead is low;
+ * insertion and removal move the entries after the affected position, which
+ * is cheap for maps up to a few hundred entries.
+ *
+ * Has the same interface as @ref LinearMap and @ref StlMap, and iterates in
+ * key order like @ref StlMap. Adding or removing an entry invalidates the
+ * iterators and references.
+ *
+ * @param Key key type, needs operator<.
+ * @param Value value type, needs to be default constructible and movable.
+ */
+template <typename Key, typename Value> class FlatMap
+{
+public:
+    /** Default constructor. */
+    FlatMap()
+    {
+    }
+
+    /** Constructor.
+     * @param entries expected number of entries; the storage for this many
+     * entries is allocated upfront.
+     */
+    FlatMap(size_t entries)
+    {
+        entries_.reserve(entries);
+    }
+
+    /** Entry in the map. */
+    struct Pair
+    {
+        Key first; /**< mimic first element in an std::pair */
+        Value second; /**< mimic second element in an std::pair */
+    };
+
+    /** Iterator type. */
+    typedef typename std::vector<Pair>::iterator Iterator;
+
+    /** Removes all elements. */
+    void clear()
+    {
+        entries_.clear();
+    }
+
+    /** Remove an element.
+     * @param key key for the element to remove
+     * @return number of elements removed
+     */
+    size_t erase(const Key &key)
+    {
+        Iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        entries_.erase(it);
+        return 1;
+    }
+
+    /** Remove an element.
+     * @param it iterator pointing to the element to remove
+     */
+    void erase(Iterator it)
+    {
+        entries_.erase(it);
+    }
+
+    /** Find the element with the key and create it if it does not exist.
+     * @param key key to lookup
+     * @return value of the key by reference
+     */
+    Value &operator[](const Key &key)
+    {
+        Iterator it = lower_bound(key);
+        if (it == entries_.end() || key < it->first)
+        {
+            it = entries_.insert(it, Pair {key, Value()});
+        }
+        return it->second;
+    }
+
+    /** @return number of elements in the map */
+    size_t size()
+    {
+        return entries_.size();
+    }
+
+    /** @return maximum theoretical number of elements in the map */
+    size_t max_size()
+    {
+        return entries_.max_size();
+    }
+
+    /** Find an element.
+     * @param key key to search for
+     * @return iterator pointing to the element, or end() if not found
+     */
+    Iterator find(const Key &key)
+    {
+        Iterator it = lower_bound(key);
+        if (it != entries_.end() && !(key < it->first))
+        {
+            return it;
+        }
+        return end();
+    }
+
+    /** @return iterator pointing one past the last element */
+    Iterator end()
+    {
+        return entries_.end();
+    }
+
+    /** @return iterator pointing to the first element */
+    Iterator begin()
+    {
+        return entries_.begin();
+    }
+
+private:
+    /** @param key key to search for
+     * @return the first entry whose key is not less than key */
+    Iterator lower_bound(const Key &key)
+    {
+        return std::lower_bound(entries_.begin(), entries_.end(), key,
+            [](const Pair &p, const Key &k) { return p.first < k; });
+    }
+
+    /** The entries, sorted by key. */
+    std::vector<Pair> entries_;
+
+    DISALLOW_COPY_AND_ASSIGN(FlatMap);
+};
+
+#endif // _UTILS_FLATMAP_HXX_
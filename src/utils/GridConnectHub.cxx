@@ -48,6 +48,7 @@
 #endif
 #include "utils/Hub.hxx"
 #include "utils/GcStreamParser.hxx"
+#include "utils/StringBuilder.hxx"
 #include "utils/gc_format.h"
 
 /// Actual implementation for the gridconnect bridge between a string-typed Hub
@@ -347,9 +348,9 @@ struct GcPacketPrinter::Impl : public CanHubPortInterface
     void send(Buffer<CanHubData> *message, unsigned priority) OVERRIDE
     {
         AutoReleaseBuffer<CanHubData> b(message);
-        char str[40];
-        char* p = gc_format_generate(message->data(), str, false);
-        *p = 0;
+        // The whole line is rendered on the stack and written with a single
+        // call, instead of one printf for each part.
+        StringBuilder<96> line;
         if (timestamped_)
         {
 #if defined(__linux__) || defined(__MACH__)
@@ -357,16 +358,30 @@ struct GcPacketPrinter::Impl : public CanHubPortInterface
             gettimeofday(&tv, nullptr);
             struct tm t;
             localtime_r(&tv.tv_sec, &t);
-            printf("%04d-%02d-%02d %02d:%02d:%02d:%06ld [%p] ",
-                t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min,
-                t.tm_sec, (long)tv.tv_usec, message->data()->skipMember_);
+            line.append_unsigned(t.tm_year + 1900, 4)
+                .push_back('-')
+                .append_unsigned(t.tm_mon + 1, 2)
+                .push_back('-')
+                .append_unsigned(t.tm_mday, 2)
+                .push_back(' ')
+                .append_unsigned(t.tm_hour, 2)
+                .push_back(':')
+                .append_unsigned(t.tm_min, 2)
+                .push_back(':')
+                .append_unsigned(t.tm_sec, 2)
+                .push_back(':')
+                .append_unsigned(tv.tv_usec, 6)
+                .append_printf(" [%p] ", message->data()->skipMember_);
 #endif
         }
-        printf("%s", str);
+        char str[40];
+        char *p = gc_format_generate(message->data(), str, false);
+        line.append(str, p - str);
         if (config_gc_generate_newlines() != 1)
         {
-            printf("\n");
+            line.push_back('\n');
         }
+        fwrite(line.data(), 1, line.size(), stdout);
     }
 
     /// Which hun are we registered to.
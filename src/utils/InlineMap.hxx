@@ -0,0 +1,248 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file InlineMap.hxx
+ *
+ * Map with a small number of entries stored inline and searched linearly.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_INLINEMAP_HXX_
+#define _UTILS_INLINEMAP_HXX_
+
+#include <limits>
+#include <stddef.h>
+#include <utility>
+
+#include "utils/macros.h"
+
+/** Map that keeps its entries in an array and finds them by linear search.
+ * The first N entries are stored inside the object, so a map that stays small
+ * never allocates memory. When more entries are added, the entries are moved
+ * to a heap array that doubles in size as needed.
+ *
+ * For a handful of entries, inserting and erasing is cheaper than in any tree
+ * or hash map, and the map takes no memory besides the object itself. The
+ * lookup time grows linearly, so this is only good for small maps.
+ *
+ * Has the same interface as @ref LinearMap and @ref StlMap. The iteration
+ * order is unspecified. Adding an entry may invalidate the iterators and
+ * references; erasing an entry moves the last entry into its place.
+ *
+ * @param Key key type, needs operator==.
+ * @param Value value type, needs to be default constructible and movable.
+ * @param N number of entries stored inline.
+ */
+template <typename Key, typename Value, size_t N> class InlineMap
+{
+public:
+    static_assert(N > 0, "InlineMap needs at least one inline entry");
+
+    /** Default constructor. */
+    InlineMap()
+    {
+    }
+
+    /** Constructor.
+     * @param entries expected number of entries. If more than N, the heap
+     * array is allocated upfront.
+     */
+    InlineMap(size_t entries)
+    {
+        if (entries > N)
+        {
+            grow(entries);
+        }
+    }
+
+    /** Destructor. */
+    ~InlineMap()
+    {
+        if (data_ != inline_)
+        {
+            delete[] data_;
+        }
+    }
+
+    /** Entry in the map. */
+    struct Pair
+    {
+        Key first; /**< mimic first element in an std::pair */
+        Value second; /**< mimic second element in an std::pair */
+    };
+
+    /** Iterator; points to the entry. */
+    typedef Pair *Iterator;
+
+    /** Removes all elements. */
+    void clear()
+    {
+        for (size_t i = 0; i < used_; ++i)
+        {
+            data_[i].second = Value();
+        }
+        used_ = 0;
+    }
+
+    /** Remove an element.
+     * @param key key for the element to remove
+     * @return number of elements removed
+     */
+    size_t erase(const Key &key)
+    {
+        Iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    /** Remove an element.
+     * @param it iterator pointing to the element to remove
+     */
+    void erase(Iterator it)
+    {
+        HASSERT(it >= data_ && it < data_ + used_);
+        Pair *last = data_ + --used_;
+        if (it != last)
+        {
+            it->first = std::move(last->first);
+            it->second = std::move(last->second);
+        }
+        last->second = Value();
+    }
+
+    /** Find the element with the key and create it if it does not exist.
+     * @param key key to lookup
+     * @return value of the key by reference
+     */
+    Value &operator[](const Key &key)
+    {
+        Iterator it = find(key);
+        if (it != end())
+        {
+            return it->second;
+        }
+        if (used_ == capacity_)
+        {
+            grow(capacity_ * 2);
+        }
+        Pair *p = data_ + used_++;
+        p->first = key;
+        p->second = Value();
+        return p->second;
+    }
+
+    /** @return number of elements in the map */
+    size_t size()
+    {
+        return used_;
+    }
+
+    /** @return maximum theoretical number of elements in the map */
+    size_t max_size()
+    {
+        return std::numeric_limits<size_t>::max() / sizeof(Pair);
+    }
+
+    /** Find an element.
+     * @param key key to search for
+     * @return iterator pointing to the element, or end() if not found
+     */
+    Iterator find(const Key &key)
+    {
+        for (size_t i = 0; i < used_; ++i)
+        {
+            if (data_[i].first == key)
+            {
+                return data_ + i;
+            }
+        }
+        return end();
+    }
+
+    /** @return iterator pointing one past the last element */
+    Iterator end()
+    {
+        return data_ + used_;
+    }
+
+    /** @return iterator pointing to the first element */
+    Iterator begin()
+    {
+        return data_;
+    }
+
+private:
+    /** Moves the entries to a larger heap array.
+     * @param capacity new number of entries
+     */
+    void grow(size_t capacity)
+    {
+        Pair *data = new Pair[capacity];
+        for (size_t i = 0; i < used_; ++i)
+        {
+            data[i].first = std::move(data_[i].first);
+            data[i].second = std::move(data_[i].second);
+        }
+        if (data_ != inline_)
+        {
+            delete[] data_;
+        }
+        else
+        {
+            clear_inline();
+        }
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    /** Releases the resources held by the inline values. */
+    void clear_inline()
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            inline_[i].second = Value();
+        }
+    }
+
+    /** Inline entries. */
+    Pair inline_[N];
+    /** Entries in use; points to inline_ or to a heap array. */
+    Pair *data_ {inline_};
+    /** Number of entries in data_. */
+    size_t capacity_ {N};
+    /** Number of entries used. */
+    size_t used_ {0};
+
+    DISALLOW_COPY_AND_ASSIGN(InlineMap);
+};
+
+#endif // _UTILS_INLINEMAP_HXX_
@@ -58,6 +58,9 @@
  * this is a header only implementation, a clever developer could define or
  * undefine __USE_LIBSTDCPP__ and/or __LENEAR_MAP__ ahead of a
  * #include "utils/Map.hxx" to override any compiler flag settings.
+ *
+ * To select the implementation for each use separately, from its expected
+ * size, use @ref SizedMap instead.
  */
 template <typename Key, typename Value> class Map : public BASE_CLASS <Key, Value>
 {
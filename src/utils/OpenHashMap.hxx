@@ -0,0 +1,372 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file OpenHashMap.hxx
+ *
+ * Hash map with open addressing for integer keys.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_OPENHASHMAP_HXX_
+#define _UTILS_OPENHASHMAP_HXX_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+#include "utils/macros.h"
+
+/** Hash map for integer keys that stores the entries in a single array
+ * (open addressing with linear probing). There is no per-entry allocation,
+ * and a lookup usually touches one or two adjacent slots. The table is kept
+ * at most half full and doubles in size when needed. Erase shifts the
+ * following entries back, so no tombstones accumulate.
+ *
+ * Has the same interface as @ref LinearMap and @ref StlMap. The iteration
+ * order is unspecified. Adding or removing an entry invalidates the
+ * iterators and references.
+ *
+ * @param Key key type, an integer or enum type.
+ * @param Value value type, needs to be default constructible and movable.
+ */
+template <typename Key, typename Value> class OpenHashMap
+{
+public:
+    static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value,
+        "OpenHashMap needs an integer key");
+
+    /** Default constructor. */
+    OpenHashMap()
+    {
+        allocate(MIN_SLOTS);
+    }
+
+    /** Constructor.
+     * @param entries expected number of entries; the table is sized so that
+     * this many entries fit without rehashing.
+     */
+    OpenHashMap(size_t entries)
+    {
+        size_t slots = MIN_SLOTS;
+        while (slots < entries * 2)
+        {
+            slots *= 2;
+        }
+        allocate(slots);
+    }
+
+    /** Destructor. */
+    ~OpenHashMap()
+    {
+        delete[] slots_;
+        delete[] full_;
+    }
+
+    /** Entry in the map. */
+    struct Pair
+    {
+        Key first; /**< mimic first element in an std::pair */
+        Value second; /**< mimic second element in an std::pair */
+    };
+
+    /** This mimics an std::iterator. */
+    class Iterator
+    {
+    public:
+        /** Default constructor. The iterator must not be used until a valid
+         * iterator is assigned to it. */
+        Iterator()
+            : m_(nullptr)
+            , index_(0)
+        {
+        }
+
+        /** Constructor.
+         * @param m the map
+         * @param index slot index, or the number of slots for end()
+         */
+        Iterator(OpenHashMap *m, size_t index)
+            : m_(m)
+            , index_(index)
+        {
+        }
+
+        /** @return the entry */
+        Pair &operator*() const
+        {
+            return m_->slots_[index_];
+        }
+
+        /** @return the entry */
+        Pair *operator->() const
+        {
+            return &m_->slots_[index_];
+        }
+
+        /** Moves to the next entry. @return this. */
+        Iterator &operator++()
+        {
+            index_ = m_->next_full(index_ + 1);
+            return *this;
+        }
+
+        /** @param it other iterator. @return true if they are the same. */
+        bool operator==(const Iterator &it) const
+        {
+            return m_ == it.m_ && index_ == it.index_;
+        }
+
+        /** @param it other iterator. @return true if they are different. */
+        bool operator!=(const Iterator &it) const
+        {
+            return !(*this == it);
+        }
+
+    private:
+        /** The map. */
+        OpenHashMap *m_;
+        /** Slot index. */
+        size_t index_;
+
+        friend class OpenHashMap;
+    };
+
+    /** Removes all elements. */
+    void clear()
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+        {
+            if (full_[i])
+            {
+                full_[i] = 0;
+                slots_[i].second = Value();
+            }
+        }
+        used_ = 0;
+    }
+
+    /** Remove an element.
+     * @param key key for the element to remove
+     * @return number of elements removed
+     */
+    size_t erase(const Key &key)
+    {
+        Iterator it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    /** Remove an element.
+     * @param it iterator pointing to the element to remove
+     */
+    void erase(Iterator it)
+    {
+        size_t i = it.index_;
+        HASSERT(i <= mask_ && full_[i]);
+        // Moves back the entries of the probe sequence that would not be
+        // found anymore after slot i becomes empty.
+        size_t j = i;
+        while (true)
+        {
+            j = (j + 1) & mask_;
+            if (!full_[j])
+            {
+                break;
+            }
+            size_t home = slot_of(slots_[j].first);
+            // Can the entry at j move to i? Only if its home slot is not in
+            // the cyclic range (i, j].
+            if (((j - home) & mask_) >= ((j - i) & mask_))
+            {
+                slots_[i].first = std::move(slots_[j].first);
+                slots_[i].second = std::move(slots_[j].second);
+                i = j;
+            }
+        }
+        full_[i] = 0;
+        slots_[i].second = Value();
+        --used_;
+    }
+
+    /** Find the element with the key and create it if it does not exist.
+     * @param key key to lookup
+     * @return value of the key by reference
+     */
+    Value &operator[](const Key &key)
+    {
+        size_t i = slot_of(key);
+        while (full_[i])
+        {
+            if (slots_[i].first == key)
+            {
+                return slots_[i].second;
+            }
+            i = (i + 1) & mask_;
+        }
+        if ((used_ + 1) * 2 > mask_ + 1)
+        {
+            rehash((mask_ + 1) * 2);
+            return (*this)[key];
+        }
+        full_[i] = 1;
+        slots_[i].first = key;
+        slots_[i].second = Value();
+        ++used_;
+        return slots_[i].second;
+    }
+
+    /** @return number of elements in the map */
+    size_t size()
+    {
+        return used_;
+    }
+
+    /** @return maximum theoretical number of elements in the map */
+    size_t max_size()
+    {
+        return (SIZE_MAX / sizeof(Pair)) / 2;
+    }
+
+    /** Find an element.
+     * @param key key to search for
+     * @return iterator pointing to the element, or end() if not found
+     */
+    Iterator find(const Key &key)
+    {
+        size_t i = slot_of(key);
+        while (full_[i])
+        {
+            if (slots_[i].first == key)
+            {
+                return Iterator(this, i);
+            }
+            i = (i + 1) & mask_;
+        }
+        return end();
+    }
+
+    /** @return iterator pointing one past the last element */
+    Iterator end()
+    {
+        return Iterator(this, mask_ + 1);
+    }
+
+    /** @return iterator pointing to the first element */
+    Iterator begin()
+    {
+        return Iterator(this, next_full(0));
+    }
+
+private:
+    /** Smallest table size. */
+    static constexpr size_t MIN_SLOTS = 8;
+
+    /** @param key a key @return the home slot of the key. */
+    size_t slot_of(const Key &key)
+    {
+        // Fibonacci hashing: the top bits of the product are well mixed even
+        // for sequential keys.
+        return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    /** @param i a slot index @return the first full slot at or after i, or
+     * the number of slots if there is none. */
+    size_t next_full(size_t i)
+    {
+        while (i <= mask_ && !full_[i])
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    /** Allocates an empty table.
+     * @param slots number of slots, a power of two
+     */
+    void allocate(size_t slots)
+    {
+        slots_ = new Pair[slots];
+        full_ = new uint8_t[slots]();
+        mask_ = slots - 1;
+        shift_ = 64;
+        while (slots > 1)
+        {
+            --shift_;
+            slots >>= 1;
+        }
+        used_ = 0;
+    }
+
+    /** Moves all entries to a new table.
+     * @param slots number of slots in the new table
+     */
+    void rehash(size_t slots)
+    {
+        Pair *old_slots = slots_;
+        uint8_t *old_full = full_;
+        size_t old_count = mask_ + 1;
+        allocate(slots);
+        for (size_t i = 0; i < old_count; ++i)
+        {
+            if (old_full[i])
+            {
+                size_t j = slot_of(old_slots[i].first);
+                while (full_[j])
+                {
+                    j = (j + 1) & mask_;
+                }
+                full_[j] = 1;
+                slots_[j].first = std::move(old_slots[i].first);
+                slots_[j].second = std::move(old_slots[i].second);
+                ++used_;
+            }
+        }
+        delete[] old_slots;
+        delete[] old_full;
+    }
+
+    /** The entries. */
+    Pair *slots_;
+    /** Nonzero for the slots that hold an entry. */
+    uint8_t *full_;
+    /** Number of slots - 1. */
+    size_t mask_;
+    /** 64 - log2(number of slots). */
+    unsigned shift_;
+    /** Number of entries. */
+    size_t used_;
+
+    DISALLOW_COPY_AND_ASSIGN(OpenHashMap);
+};
+
+#endif // _UTILS_OPENHASHMAP_HXX_
@@ -68,9 +68,11 @@ public:
     {
         RB_INIT(&head);
         Node *first = new Node[nodes];
-        first->entry.rbe_left = (Node*)this;
-        
-        for (size_t i = 1; i < nodes; i++)
+        // The free list is terminated by this, which marks a tree with a
+        // node pool even when all nodes are in use.
+        freeList = (Node*)this;
+
+        for (size_t i = 0; i < nodes; i++)
         {
             first[i].entry.rbe_left = freeList;
             freeList = first + i;
@@ -156,7 +158,6 @@ public:
         if (node)
         {
             remove(node);
-            free(node);
         }
         return node;
     }
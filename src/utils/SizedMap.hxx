@@ -0,0 +1,92 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file SizedMap.hxx
+ *
+ * Selects the map implementation for each use from its expected size.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_SIZEDMAP_HXX_
+#define _UTILS_SIZEDMAP_HXX_
+
+#include <type_traits>
+
+#include "utils/FlatMap.hxx"
+#include "utils/InlineMap.hxx"
+#include "utils/OpenHashMap.hxx"
+
+/// Largest expected size for which SizedMap uses an @ref InlineMap.
+static constexpr size_t SIZED_MAP_INLINE_MAX = 8;
+
+/// Picks the map implementation for SizedMap. See there.
+template <typename Key, typename Value, size_t EXPECTED_SIZE, bool ORDERED>
+struct SizedMapSelector
+{
+    /// The selected map type.
+    typedef typename std::conditional<(!ORDERED &&
+                                          EXPECTED_SIZE <= SIZED_MAP_INLINE_MAX),
+        InlineMap<Key, Value, (EXPECTED_SIZE > 0 ? EXPECTED_SIZE : 1)>,
+        typename std::conditional<(ORDERED ||
+                                      !(std::is_integral<Key>::value ||
+                                          std::is_enum<Key>::value)),
+            FlatMap<Key, Value>, OpenHashMap<Key, Value>>::type>::type type;
+};
+
+/** Map whose implementation is selected at compile time for each use, from
+ * the number of entries it is expected to hold. Unlike @ref Map, which uses
+ * the same implementation everywhere in the binary, each instantiation gets
+ * the structure that is fastest for its size:
+ *
+ * - up to 8 entries: @ref InlineMap; linear search in inline storage, no
+ *   allocation.
+ * - more entries with integer keys: @ref OpenHashMap.
+ * - when ORDERED is set, or the key is not an integer: @ref FlatMap; binary
+ *   search in a sorted array.
+ *
+ * The expected size is a hint, not a limit: every implementation grows when
+ * more entries are added, only slower. All of them have the interface of
+ * @ref LinearMap / @ref StlMap (operator[], find, erase, begin, end, size).
+ * SizedMapBenchmark in SizedMap.cxxtest compares them with the other map
+ * implementations in utils.
+ *
+ * Example:
+ *   // Usually 0-2 entries.
+ *   SizedMap<uint64_t, Payload, 4> pendingBuffers_;
+ *
+ * @param Key key type
+ * @param Value value type, needs to be default constructible and movable
+ * @param EXPECTED_SIZE typical number of entries
+ * @param ORDERED true if the iteration has to be in key order
+ */
+template <typename Key, typename Value, size_t EXPECTED_SIZE,
+    bool ORDERED = false>
+using SizedMap =
+    typename SizedMapSelector<Key, Value, EXPECTED_SIZE, ORDERED>::type;
+
+#endif // _UTILS_SIZEDMAP_HXX_
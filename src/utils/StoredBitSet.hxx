@@ -38,8 +38,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "executor/Notifiable.hxx"
 #include "utils/macros.h"
 #include "utils/Atomic.hxx"
+#include "utils/Clock.hxx"
 
 /** Abstract class for representing a set of numbered bits that are stored
  * persistently in some backing store.
@@ -86,6 +88,16 @@ public:
 
     /// Grabs a lock and writes the current values to persistent storage.
     virtual void lock_and_flush() = 0;
+
+    /// Grabs a lock and writes the current values to persistent storage if
+    /// the flush policy of the implementation does not allow deferring the
+    /// write any longer. Call this after the changes, and also periodically
+    /// when the policy has a time bound. The default implementation flushes
+    /// every time.
+    virtual void lock_and_maybe_flush()
+    {
+        lock_and_flush();
+    }
 };
 
 class ShadowedStoredBitSet : public StoredBitSet, protected Atomic
@@ -104,8 +116,9 @@ public:
                 return *this; // nothing to do
             }
         }
+        __atomic_fetch_add(&stats_.bitChanges, 1, __ATOMIC_SEQ_CST);
         cell_offs_t d = offset / granularity_;
-        __atomic_fetch_or(dirty_ + (d >> 5), UINT32_C(1) << (d & 31), __ATOMIC_SEQ_CST);
+        set_dirty(d);
         update_dirty_bounds(d);
         return *this;
     }
@@ -143,6 +156,10 @@ public:
                          false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ||
                 !__atomic_compare_exchange_n(shadow_ + sidx + 1, &old2, new2,
                     false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+            __atomic_fetch_add(&stats_.bitChanges,
+                __builtin_popcount(old1 ^ new1) +
+                    __builtin_popcount(old2 ^ new2),
+                __ATOMIC_SEQ_CST);
         }
         else
         {
@@ -153,6 +170,8 @@ public:
                 new1 = (old1 & ~smask) | sval;
             } while (!__atomic_compare_exchange_n(shadow_ + sidx, &old1, new1,
                          false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+            __atomic_fetch_add(&stats_.bitChanges,
+                __builtin_popcount(old1 ^ new1), __ATOMIC_SEQ_CST);
         }
         // Sets dirty bits.
         unsigned d = offset / granularity_;
@@ -161,7 +180,7 @@ public:
         update_dirty_bounds(de);
         if (de > highestDirty_) highestDirty_ = de;
         while (d <= de) {
-            __atomic_fetch_or(dirty_ + (d >> 5),(UINT32_C(1)<<(d & 31)), __ATOMIC_SEQ_CST);
+            set_dirty(d);
             d++;
         }
         return *this;
@@ -189,8 +208,109 @@ public:
     void lock_and_flush() override {
         AtomicHolder h(this);
         flush();
+        deferring_ = false;
     }
-    
+
+    void lock_and_maybe_flush() override {
+        bool started = false;
+        Notifiable *arm = nullptr;
+        {
+            AtomicHolder h(this);
+            if (!dirtyCount_) {
+                deferring_ = false;
+                return;
+            }
+            long long now =
+                clock_ ? clock_->get_time_nsec() : os_get_time_monotonic();
+            if (!deferring_) {
+                // The time bound starts at the first call that sees the
+                // change.
+                deferring_ = true;
+                dirtySince_ = now;
+                started = true;
+            }
+            if (dirtyCount_ >= maxDirtyCells_ ||
+                now - dirtySince_ >= maxDelayNsec_) {
+                flush();
+                deferring_ = false;
+            } else if (started) {
+                arm = deferredFlush_;
+            }
+        }
+        if (arm) {
+            arm->notify();
+        }
+    }
+
+    /// @return true if lock_and_maybe_flush() has deferred some changes that
+    /// are not flushed yet.
+    bool flush_pending() {
+        AtomicHolder h(this);
+        return deferring_;
+    }
+
+    /// @return the time bound of the flush policy in nanoseconds.
+    long long flush_delay_nsec() {
+        return maxDelayNsec_;
+    }
+
+    /// Registers who enforces the time bound of the flush policy. The time
+    /// bound is otherwise only checked when lock_and_maybe_flush() is called
+    /// again.
+    /// @param n will be notified (outside of the lock) every time
+    /// lock_and_maybe_flush() starts deferring a change; it has to call
+    /// lock_and_maybe_flush() again after flush_delay_nsec(). nullptr to
+    /// unregister. See StoredBitSetFlusher.
+    void set_deferred_flush(Notifiable *n) {
+        AtomicHolder h(this);
+        deferredFlush_ = n;
+    }
+
+    /// Sets the policy of lock_and_maybe_flush(). The default is to flush
+    /// every time. Deferring lets a burst of changes to the same cells be
+    /// written to the storage only once.
+    /// @param max_dirty_cells flush when at least this many cells are dirty.
+    /// @param max_delay_nsec flush when a change has been pending for at
+    /// least this long.
+    /// @param clock if not null, the time source to use instead of the OS
+    /// monotonic clock.
+    ///
+    /// With a deferring policy some component has to call
+    /// lock_and_maybe_flush() after the time bound expires even if there are
+    /// no more changes, otherwise the last changes stay in RAM. Use a
+    /// StoredBitSetFlusher for this.
+    void set_flush_policy(unsigned max_dirty_cells, long long max_delay_nsec,
+        Clock *clock = nullptr) {
+        AtomicHolder h(this);
+        maxDirtyCells_ = max_dirty_cells ? max_dirty_cells : 1;
+        maxDelayNsec_ = max_delay_nsec;
+        clock_ = clock;
+    }
+
+    /// Counters for measuring the write amplification.
+    struct Stats
+    {
+        /// How many bits were changed by the user.
+        unsigned bitChanges;
+        /// How many physical cells were written to the storage.
+        unsigned cellWrites;
+        /// How many write operations were issued to the storage (one
+        /// operation may write several consecutive cells).
+        unsigned writeOps;
+        /// How many flushes wrote anything.
+        unsigned flushes;
+    };
+
+    /// @return the write amplification counters.
+    const Stats &stats() {
+        return stats_;
+    }
+
+    /// Resets the write amplification counters to zero.
+    void clear_stats() {
+        memset(&stats_, 0, sizeof(stats_));
+    }
+
 protected:
     /// @param size is the total number of bits we store.
     /// @param granularity tells how many bits fit into a single cell. The base
@@ -253,7 +373,11 @@ protected:
     /// @param cell is the number of the cell, 0..num_cells()-1.
     void clear_dirty(cell_offs_t cell) {
         HASSERT(cell < num_cells());
-        dirty_[cell >> 5] &= ~(UINT32_C(1)<<(cell & 31));
+        uint32_t bit = UINT32_C(1) << (cell & 31);
+        if (__atomic_fetch_and(dirty_ + (cell >> 5), ~bit, __ATOMIC_SEQ_CST) &
+            bit) {
+            __atomic_fetch_sub(&dirtyCount_, 1, __ATOMIC_SEQ_CST);
+        }
         if (cell == lowestDirty_) {
             ++lowestDirty_;
         }
@@ -270,8 +394,31 @@ protected:
     cell_offs_t num_cells() {
         return (size_ + granularity_ - 1) / granularity_;
     }
-    
+
+    /// Accounts for a write to the storage.
+    /// @param cells is the number of consecutive cells written in one
+    /// operation.
+    void count_write(unsigned cells) {
+        stats_.cellWrites += cells;
+        ++stats_.writeOps;
+    }
+
+    /// Accounts for a flush that wrote something.
+    void count_flush() {
+        ++stats_.flushes;
+    }
+
 private:
+    /// Sets the dirty bit for a given cell.
+    /// @param cell is the number of the cell, 0..num_cells()-1.
+    void set_dirty(cell_offs_t cell) {
+        uint32_t bit = UINT32_C(1) << (cell & 31);
+        if ((__atomic_fetch_or(dirty_ + (cell >> 5), bit, __ATOMIC_SEQ_CST) &
+                bit) == 0) {
+            __atomic_fetch_add(&dirtyCount_, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+
     /// @return how many uint32 are there in the dirty_ array.
     unsigned dirty_size_uint32() {
         return (num_cells() + 31) / 32;
@@ -304,6 +451,24 @@ private:
     /// Helper values for iterating over the dirty bits.
     cell_offs_t lowestDirty_{NO_CELL};
     cell_offs_t highestDirty_{0};
+    /// Number of cells with the dirty bit set.
+    unsigned dirtyCount_{0};
+
+    /// True if lock_and_maybe_flush() has seen dirty cells and did not flush
+    /// them yet.
+    bool deferring_{false};
+    /// Flush policy: flush when this many cells are dirty.
+    unsigned maxDirtyCells_{1};
+    /// Flush policy: flush when a change is pending for this long.
+    long long maxDelayNsec_{0};
+    /// When lock_and_maybe_flush() first saw the pending changes.
+    long long dirtySince_{0};
+    /// Time source for the flush policy, or nullptr for the OS clock.
+    Clock *clock_{nullptr};
+    /// Notified when a change gets deferred, or nullptr.
+    Notifiable *deferredFlush_{nullptr};
+    /// Write amplification counters.
+    Stats stats_{0, 0, 0, 0};
     
     /// Data of the actual bits. length is size_ / 32 rounded up.
     uint32_t *shadow_;
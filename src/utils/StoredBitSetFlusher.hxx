@@ -0,0 +1,130 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file StoredBitSetFlusher.hxx
+ *
+ * Timer that enforces the time bound of a deferred StoredBitSet flush policy.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_STOREDBITSETFLUSHER_HXX_
+#define _UTILS_STOREDBITSETFLUSHER_HXX_
+
+#include <atomic>
+
+#include "executor/Executor.hxx"
+#include "executor/Timer.hxx"
+#include "utils/StoredBitSet.hxx"
+
+/// Flushes the deferred changes of a ShadowedStoredBitSet when the time bound
+/// of its flush policy expires. ShadowedStoredBitSet checks the time bound
+/// only when lock_and_maybe_flush() is called, so without this object the
+/// last changes of a burst stay in RAM until the next change comes.
+///
+/// The bit set notifies this object when it starts deferring a change; that
+/// arms a timer on the executor, which calls lock_and_maybe_flush() after
+/// flush_delay_nsec(). The timer does not run while nothing is pending.
+class StoredBitSetFlusher : public Executable
+{
+public:
+    /// Constructor. Registers itself with the bit set.
+    /// @param executor where to run the timer.
+    /// @param set the bit set to flush. Must outlive this object.
+    StoredBitSetFlusher(ExecutorBase *executor, ShadowedStoredBitSet *set)
+        : executor_(executor)
+        , set_(set)
+        , timer_(this)
+        , isPending_(0)
+    {
+        set_->set_deferred_flush(this);
+    }
+
+    ~StoredBitSetFlusher()
+    {
+        set_->set_deferred_flush(nullptr);
+    }
+
+    /// Called by the bit set when a change was deferred. May be called from
+    /// any thread.
+    void notify() override
+    {
+        if (!isPending_.exchange(1))
+        {
+            executor_->add(this);
+        }
+    }
+
+    /// Arms the timer. Called on the executor.
+    void run() override
+    {
+        isPending_ = 0;
+        timer_.arm(set_->flush_delay_nsec());
+    }
+
+private:
+    /// Calls lock_and_maybe_flush() on the bit set when expiring.
+    class FlushTimer : public ::Timer
+    {
+    public:
+        /// Constructor. @param parent who owns the bit set.
+        FlushTimer(StoredBitSetFlusher *parent)
+            : Timer(parent->executor_->active_timers())
+            , parent_(parent)
+        {
+        }
+
+        /// (Re)starts the timer. @param period_nsec when to expire.
+        void arm(long long period_nsec)
+        {
+            update_period(period_nsec);
+            restart();
+        }
+
+        long long timeout() override
+        {
+            parent_->set_->lock_and_maybe_flush();
+            // A change may have been deferred again since the timer was
+            // armed.
+            return parent_->set_->flush_pending() ? RESTART : NONE;
+        }
+
+    private:
+        StoredBitSetFlusher *parent_; ///< owns the bit set.
+    };
+
+    /// Executor for the timer.
+    ExecutorBase *executor_;
+    /// The bit set to flush.
+    ShadowedStoredBitSet *set_;
+    /// Enforces the time bound.
+    FlushTimer timer_;
+    /// 1 if we are in the executor's queue.
+    std::atomic_uint_least8_t isPending_;
+};
+
+#endif // _UTILS_STOREDBITSETFLUSHER_HXX_
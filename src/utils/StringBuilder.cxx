@@ -0,0 +1,172 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file StringBuilder.cxx
+ *
+ * Fixed-capacity string formatting into caller-provided storage.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#include "utils/StringBuilder.hxx"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utils/format_utils.hxx"
+
+StringBuilderBase &StringBuilderBase::append(size_t count, char c)
+{
+    if (count > capacity_ - size_)
+    {
+        count = capacity_ - size_;
+        truncated_ = true;
+    }
+    memset(buffer_ + size_, c, count);
+    size_ += count;
+    buffer_[size_] = 0;
+    return *this;
+}
+
+StringBuilderBase &StringBuilderBase::append(const char *s, size_t len)
+{
+    if (len > capacity_ - size_)
+    {
+        len = capacity_ - size_;
+        truncated_ = true;
+    }
+    memcpy(buffer_ + size_, s, len);
+    size_ += len;
+    buffer_[size_] = 0;
+    return *this;
+}
+
+StringBuilderBase &StringBuilderBase::append(const char *s)
+{
+    return append(s, strlen(s));
+}
+
+StringBuilderBase &StringBuilderBase::append_number(
+    const char *digits, size_t len, bool negative, unsigned width, char pad)
+{
+    size_t total = len + (negative ? 1 : 0);
+    size_t padding = width > total ? width - total : 0;
+    if (pad == '0')
+    {
+        if (negative)
+        {
+            push_back('-');
+        }
+        append(padding, pad);
+    }
+    else
+    {
+        append(padding, pad);
+        if (negative)
+        {
+            push_back('-');
+        }
+    }
+    return append(digits, len);
+}
+
+StringBuilderBase &StringBuilderBase::append_unsigned(
+    uint32_t value, unsigned width, char pad)
+{
+    char tmp[12];
+    if (value < 10 && width <= 1)
+    {
+        return push_back('0' + value);
+    }
+    char *end = unsigned_integer_to_buffer(value, tmp);
+    return append_number(tmp, end - tmp, false, width, pad);
+}
+
+StringBuilderBase &StringBuilderBase::append_int(
+    int32_t value, unsigned width, char pad)
+{
+    char tmp[12];
+    uint32_t abs_value = value < 0 ? -(uint32_t)value : value;
+    char *end = unsigned_integer_to_buffer(abs_value, tmp);
+    return append_number(tmp, end - tmp, value < 0, width, pad);
+}
+
+StringBuilderBase &StringBuilderBase::append_uint64(
+    uint64_t value, unsigned width, char pad)
+{
+    char tmp[21];
+    char *end = uint64_integer_to_buffer(value, tmp);
+    return append_number(tmp, end - tmp, false, width, pad);
+}
+
+StringBuilderBase &StringBuilderBase::append_int64(
+    int64_t value, unsigned width, char pad)
+{
+    char tmp[21];
+    uint64_t abs_value = value < 0 ? -(uint64_t)value : value;
+    char *end = uint64_integer_to_buffer(abs_value, tmp);
+    return append_number(tmp, end - tmp, value < 0, width, pad);
+}
+
+StringBuilderBase &StringBuilderBase::append_hex(uint32_t value, unsigned width)
+{
+    char tmp[9];
+    char *end = unsigned_integer_to_buffer_hex(value, tmp);
+    return append_number(tmp, end - tmp, false, width, '0');
+}
+
+StringBuilderBase &StringBuilderBase::append_hex64(
+    uint64_t value, unsigned width)
+{
+    char tmp[17];
+    char *end = uint64_integer_to_buffer_hex(value, tmp);
+    return append_number(tmp, end - tmp, false, width, '0');
+}
+
+StringBuilderBase &StringBuilderBase::append_printf(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    append_vprintf(format, ap);
+    va_end(ap);
+    return *this;
+}
+
+StringBuilderBase &StringBuilderBase::append_vprintf(
+    const char *format, va_list ap)
+{
+    size_t room = capacity_ - size_;
+    int n = vsnprintf(buffer_ + size_, room + 1, format, ap);
+    HASSERT(n >= 0);
+    if ((size_t)n > room)
+    {
+        n = room;
+        truncated_ = true;
+    }
+    size_ += n;
+    return *this;
+}
@@ -0,0 +1,270 @@
+/** \copyright
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file StringBuilder.hxx
+ *
+ * Fixed-capacity string formatting into caller-provided storage.
+ *
+ * @author agent
+ * @date 19 Oct 2026
+ */
+
+#ifndef _UTILS_STRINGBUILDER_HXX_
+#define _UTILS_STRINGBUILDER_HXX_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "utils/macros.h"
+
+/// Builds a string in a fixed-size buffer that the caller provides. Nothing
+/// is allocated, so the builder can be used in hot paths instead of
+/// StringPrintf and std::string concatenation. The buffer is reused when the
+/// builder is cleared.
+///
+/// The contents are always null-terminated. When an append does not fit, as
+/// much is kept as fits and truncated() becomes true, similar to snprintf.
+///
+/// The append methods have the same names as those of std::string, so that
+/// templated code can write into either.
+///
+/// Example:
+///   StringBuilder<64> b;
+///   b.append("speed ").append_unsigned(speed).push_back('\n');
+///   fwrite(b.data(), 1, b.size(), fp);
+class StringBuilderBase
+{
+public:
+    /// Constructor.
+    /// @param buffer storage for the string.
+    /// @param buffer_size number of bytes in buffer, including the space for
+    /// the terminating null.
+    StringBuilderBase(char *buffer, size_t buffer_size)
+        : buffer_(buffer)
+        , capacity_(buffer_size - 1)
+    {
+        HASSERT(buffer_size > 0);
+        buffer_[0] = 0;
+    }
+
+    /// @return the null-terminated contents.
+    const char *c_str() const
+    {
+        return buffer_;
+    }
+
+    /// @return the contents.
+    const char *data() const
+    {
+        return buffer_;
+    }
+
+    /// @return the contents, for modification in place.
+    char *data()
+    {
+        return buffer_;
+    }
+
+    /// @return number of characters in the string.
+    size_t size() const
+    {
+        return size_;
+    }
+
+    /// @return true if the string is empty.
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /// @return the maximum number of characters the string can hold.
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    /// @return true if something was cut off since the last clear().
+    bool truncated() const
+    {
+        return truncated_;
+    }
+
+    /// @return the contents as std::string (allocates).
+    std::string str() const
+    {
+        return std::string(buffer_, size_);
+    }
+
+    /// Character access.
+    /// @param i index, less than size().
+    char &operator[](size_t i)
+    {
+        return buffer_[i];
+    }
+
+    /// Removes all characters.
+    void clear()
+    {
+        size_ = 0;
+        truncated_ = false;
+        buffer_[0] = 0;
+    }
+
+    /// Shortens the string.
+    /// @param size the new length; ignored if longer than the current one.
+    void resize(size_t size)
+    {
+        if (size < size_)
+        {
+            size_ = size;
+            buffer_[size_] = 0;
+        }
+    }
+
+    /// Appends a character.
+    StringBuilderBase &push_back(char c)
+    {
+        if (size_ < capacity_)
+        {
+            buffer_[size_++] = c;
+            buffer_[size_] = 0;
+        }
+        else
+        {
+            truncated_ = true;
+        }
+        return *this;
+    }
+
+    /// Appends a character multiple times.
+    /// @param count how many times to append.
+    /// @param c the character.
+    StringBuilderBase &append(size_t count, char c);
+
+    /// Appends bytes.
+    /// @param s the bytes to append.
+    /// @param len number of bytes.
+    StringBuilderBase &append(const char *s, size_t len);
+
+    /// Appends a null-terminated string.
+    StringBuilderBase &append(const char *s);
+
+    /// Appends a string.
+    StringBuilderBase &append(const std::string &s)
+    {
+        return append(s.data(), s.size());
+    }
+
+    /// Appends an unsigned number in decimal.
+    /// @param value the number.
+    /// @param width minimum number of characters; the number is padded on
+    /// the left.
+    /// @param pad the character to pad with.
+    StringBuilderBase &append_unsigned(
+        uint32_t value, unsigned width = 0, char pad = '0');
+
+    /// Appends a signed number in decimal.
+    /// @param value the number.
+    /// @param width minimum number of characters, including the sign.
+    /// @param pad the character to pad with. Zeros go after the sign, spaces
+    /// before it.
+    StringBuilderBase &append_int(
+        int32_t value, unsigned width = 0, char pad = '0');
+
+    /// Appends an unsigned 64-bit number in decimal.
+    /// @param value the number.
+    /// @param width minimum number of characters.
+    /// @param pad the character to pad with.
+    StringBuilderBase &append_uint64(
+        uint64_t value, unsigned width = 0, char pad = '0');
+
+    /// Appends a signed 64-bit number in decimal.
+    /// @param value the number.
+    /// @param width minimum number of characters, including the sign.
+    /// @param pad the character to pad with.
+    StringBuilderBase &append_int64(
+        int64_t value, unsigned width = 0, char pad = '0');
+
+    /// Appends a number in lowercase hexadecimal, without a prefix.
+    /// @param value the number.
+    /// @param width minimum number of digits; padded with zeros.
+    StringBuilderBase &append_hex(uint32_t value, unsigned width = 0);
+
+    /// Appends a 64-bit number in lowercase hexadecimal, without a prefix.
+    /// @param value the number.
+    /// @param width minimum number of digits; padded with zeros.
+    StringBuilderBase &append_hex64(uint64_t value, unsigned width = 0);
+
+    /// Appends printf-formatted text.
+    /// @param format printf format string.
+    StringBuilderBase &append_printf(const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    /// Appends printf-formatted text.
+    /// @param format printf format string.
+    /// @param ap the arguments.
+    StringBuilderBase &append_vprintf(const char *format, va_list ap);
+
+private:
+    /// Appends a rendered number with padding.
+    /// @param digits the rendering of the absolute value.
+    /// @param len number of characters in digits.
+    /// @param negative true to add a minus sign.
+    /// @param width minimum number of characters.
+    /// @param pad the character to pad with.
+    StringBuilderBase &append_number(const char *digits, size_t len,
+        bool negative, unsigned width, char pad);
+
+    /// Storage.
+    char *buffer_;
+    /// Maximum number of characters (the buffer has one more byte).
+    size_t capacity_;
+    /// Number of characters in the string.
+    size_t size_ {0};
+    /// true if an append did not fit.
+    bool truncated_ {false};
+
+    DISALLOW_COPY_AND_ASSIGN(StringBuilderBase);
+};
+
+/// StringBuilder with embedded storage.
+/// @param N maximum number of characters in the string.
+template <size_t N> class StringBuilder : public StringBuilderBase
+{
+public:
+    StringBuilder()
+        : StringBuilderBase(storage_, sizeof(storage_))
+    {
+    }
+
+private:
+    /// The string contents.
+    char storage_[N + 1];
+};
+
+#endif // _UTILS_STRINGBUILDER_HXX_
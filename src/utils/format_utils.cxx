@@ -35,119 +35,116 @@
 #include "utils/macros.h"
 #include "utils/format_utils.hxx"
 
-char* unsigned_integer_to_buffer_hex(unsigned int value, char* buffer)
+#include <string.h>
+
+namespace
 {
-    int num_digits = 0;
-    unsigned int tmp = value;
-    do
+
+/// Decimal renderings of the numbers 0..99, two digits each.
+const char DIGIT_PAIRS[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/// Lowercase hexadecimal digits.
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+/// Renders a number in decimal, backwards. Two digits are produced per
+/// division, which halves the number of (slow) divisions.
+/// @param value the number to render.
+/// @param end one past the last character of the rendering.
+/// @return pointer to the first character of the rendering.
+template <class T> char *render_dec_backwards(T value, char *end)
+{
+    while (value >= 100)
     {
-        num_digits++;
-        tmp /= 16;
-    } while (tmp > 0);
-    char* ret = buffer + num_digits--;
-    *ret = 0;
-    tmp = value;
-    do
+        unsigned r = value % 100;
+        value /= 100;
+        end -= 2;
+        end[0] = DIGIT_PAIRS[r * 2];
+        end[1] = DIGIT_PAIRS[r * 2 + 1];
+    }
+    if (value >= 10)
     {
-        HASSERT(num_digits >= 0);
-        unsigned int tmp2 = tmp % 16;
-        if (tmp2 <= 9)
-        {
-            buffer[num_digits--] = '0' + tmp2;
-        }
-        else
-        {
-            buffer[num_digits--] = 'a' + (tmp2 - 10);
-        }
-        tmp /= 16;
-    } while (tmp);
-    HASSERT(num_digits == -1);
-    return ret;
+        end -= 2;
+        end[0] = DIGIT_PAIRS[value * 2];
+        end[1] = DIGIT_PAIRS[value * 2 + 1];
+    }
+    else
+    {
+        *--end = '0' + value;
+    }
+    return end;
 }
 
-char* uint64_integer_to_buffer_hex(uint64_t value, char* buffer)
+/// Renders a number in hexadecimal, without leading zeros.
+/// @param value the number to render.
+/// @param buffer where to put the rendering.
+/// @return pointer to the terminating null character.
+template <class T> char *render_hex(T value, char *buffer)
 {
-    int num_digits = 0;
-    uint64_t tmp = value;
-    do
+    unsigned num_digits = 1;
+    while (num_digits < sizeof(T) * 2 && (value >> (num_digits * 4)))
     {
-        num_digits++;
-        tmp /= 16;
-    } while (tmp > 0);
-    char* ret = buffer + num_digits--;
+        ++num_digits;
+    }
+    char *ret = buffer + num_digits;
     *ret = 0;
-    tmp = value;
     do
     {
-        HASSERT(num_digits >= 0);
-        uint64_t tmp2 = tmp % 16;
-        if (tmp2 <= 9)
-        {
-            buffer[num_digits--] = '0' + tmp2;
-        }
-        else
-        {
-            buffer[num_digits--] = 'a' + (tmp2 - 10);
-        }
-        tmp /= 16;
-    } while (tmp);
-    HASSERT(num_digits == -1);
+        buffer[--num_digits] = HEX_DIGITS[value & 0xf];
+        value >>= 4;
+    } while (num_digits);
     return ret;
 }
 
+/// Renders a number in decimal, without leading zeros.
+/// @param value the number to render.
+/// @param buffer where to put the rendering.
+/// @return pointer to the terminating null character.
+template <class T> char *render_dec(T value, char *buffer)
+{
+    char tmp[20];
+    char *start = render_dec_backwards(value, tmp + sizeof(tmp));
+    unsigned len = tmp + sizeof(tmp) - start;
+    memcpy(buffer, start, len);
+    buffer[len] = 0;
+    return buffer + len;
+}
+
+} // namespace
+
+char* unsigned_integer_to_buffer_hex(unsigned int value, char* buffer)
+{
+    return render_hex(value, buffer);
+}
+
+char* uint64_integer_to_buffer_hex(uint64_t value, char* buffer)
+{
+    return render_hex(value, buffer);
+}
+
 char* int64_integer_to_buffer_hex(int64_t value, char* buffer)
 {
     if (value < 0)
     {
         *buffer = '-';
         ++buffer;
-        value = -value;
+        return render_hex(-(uint64_t)value, buffer);
     }
-    return uint64_integer_to_buffer_hex(value, buffer);
+    return render_hex((uint64_t)value, buffer);
 }
 
 char* unsigned_integer_to_buffer(int value, char* buffer)
 {
-    int num_digits = 0;
-    int tmp = value;
-    do
-    {
-        num_digits++;
-        tmp /= 10;
-    } while (tmp > 0);
-    char* ret = buffer + num_digits--;
-    *ret = 0;
-    tmp = value;
-    do
-    {
-        HASSERT(num_digits >= 0);
-        buffer[num_digits--] = '0' + (tmp % 10);
-        tmp /= 10;
-    } while (tmp);
-    HASSERT(num_digits == -1);
-    return ret;
+    return render_dec((uint32_t)value, buffer);
 }
 
 char* uint64_integer_to_buffer(uint64_t value, char* buffer)
 {
-    int num_digits = 0;
-    uint64_t tmp = value;
-    do
-    {
-        num_digits++;
-        tmp /= 10;
-    } while (tmp > 0);
-    char* ret = buffer + num_digits--;
-    *ret = 0;
-    tmp = value;
-    do
-    {
-        HASSERT(num_digits >= 0);
-        buffer[num_digits--] = '0' + (tmp % 10);
-        tmp /= 10;
-    } while (tmp);
-    HASSERT(num_digits == -1);
-    return ret;
+    return render_dec(value, buffer);
 }
 
 char* integer_to_buffer(int value, char* buffer)
@@ -156,9 +153,9 @@ char* integer_to_buffer(int value, char* buffer)
     {
         *buffer = '-';
         ++buffer;
-        value = -value;
+        return render_dec(-(uint32_t)value, buffer);
     }
-    return unsigned_integer_to_buffer(value, buffer);
+    return render_dec((uint32_t)value, buffer);
 }
 
 char* int64_integer_to_buffer(int64_t value, char* buffer)
@@ -167,9 +164,9 @@ char* int64_integer_to_buffer(int64_t value, char* buffer)
     {
         *buffer = '-';
         ++buffer;
-        value = -value;
+        return render_dec(-(uint64_t)value, buffer);
     }
-    return uint64_integer_to_buffer(value, buffer);
+    return render_dec((uint64_t)value, buffer);
 }
 
 string integer_to_string(int value, unsigned padding)
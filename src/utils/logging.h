@@ -81,6 +81,41 @@ extern os_mutex_t g_log_mutex;
 #define GLOBAL_LOG_OUTPUT log_output
 #endif
 
+#if defined(ASYNC_LOGGING) && defined(__cplusplus) &&                         \
+    (defined(__linux__) || defined(__MACH__))
+#include "utils/AsyncLogging.hxx"
+/// Records the log message into the ring of the current thread. A background
+/// thread will render and write it. The dead snprintf call keeps the
+/// compile-time checks of the format string and the arguments.
+#define LOG_RENDER_AND_OUTPUT(message...)                                      \
+    do                                                                         \
+    {                                                                          \
+        if (0)                                                                 \
+            snprintf(nullptr, 0, message);                                     \
+        ::async_log::log(message);                                             \
+    } while (0)
+/// Writes out the queued messages before the process dies.
+#define LOG_FLUSH_BEFORE_DEATH() ::async_log::flush_now()
+#else
+/// Renders the log message into logbuffer and writes it to the log output.
+#define LOG_RENDER_AND_OUTPUT(message...)                                      \
+    do                                                                         \
+    {                                                                          \
+        LOCK_LOG;                                                              \
+        int sret = snprintf(logbuffer, sizeof(logbuffer), message);            \
+        if (sret > (int)sizeof(logbuffer))                                     \
+            sret = sizeof(logbuffer);                                          \
+        GLOBAL_LOG_OUTPUT(logbuffer, sret);                                    \
+        UNLOCK_LOG;                                                            \
+    } while (0)
+/// Writes out the queued messages before the process dies. Nothing to do
+/// when the messages are written synchronously.
+#define LOG_FLUSH_BEFORE_DEATH()                                               \
+    do                                                                         \
+    {                                                                          \
+    } while (0)
+#endif
+
 #ifdef __FreeRTOS__
 #define LOG_MAYBE_DIE(level) (level == FATAL)
 #else
@@ -96,6 +131,14 @@ extern os_mutex_t g_log_mutex;
 /// the code everywhere.
 /// @param message is a printf format argument and possibly more arguments that
 /// are referenced from the printf format.
+///
+/// When ASYNC_LOGGING is defined on a Linux or Mac host, the message is only
+/// recorded by the calling thread (format pointer and the raw arguments, with
+/// strings copied) into a lock-free per-thread ring, and it is rendered and
+/// written by a background thread. See utils/AsyncLogging.hxx. In this mode
+/// every char pointer argument is copied as a NUL-terminated string, whatever
+/// its conversion is: do not pass a char pointer for %p (cast it to void *),
+/// and do not pass a buffer without a terminating NUL for %.*s.
 #define LOG(level, message...)                                                 \
     do                                                                         \
     {                                                                          \
@@ -105,18 +148,14 @@ extern os_mutex_t g_log_mutex;
         }                                                                      \
         else if (level == FATAL)                                               \
         {                                                                      \
+            LOG_FLUSH_BEFORE_DEATH();                                          \
             fprintf(stderr, message);                                          \
             fprintf(stderr, "\n");                                             \
             abort();                                                           \
         }                                                                      \
         else if (LOGLEVEL >= level)                                            \
         {                                                                      \
-            LOCK_LOG;                                                          \
-            int sret = snprintf(logbuffer, sizeof(logbuffer), message);        \
-            if (sret > (int)sizeof(logbuffer))                                 \
-                sret = sizeof(logbuffer);                                      \
-            GLOBAL_LOG_OUTPUT(logbuffer, sret);                                \
-            UNLOCK_LOG;                                                        \
+            LOG_RENDER_AND_OUTPUT(message);                                    \
         }                                                                      \
     } while (0)
 
@@ -31,6 +31,8 @@
 #include <string>
 
 #include "openlcb/TractionThrottle.hxx"
+#include "utils/StringBuilder.hxx"
+#include "utils/format_utils.hxx"
 
 namespace withrottle
 {
@@ -100,39 +102,6 @@ enum CommandSubType
     SUBTYPE_MASK = 0xFF, /**< exact mask for dispatcher */
 };
 
-/** Command from the throttle.
- */
-class ThrottleCommand
-{
-public:
-    /** type of the dispatcher criteria */
-    typedef CommandType id_type;
-
-    CommandType commandType; /**< type of command */
-    CommandMultiType commandMultiType; /**< type of multi throttle command */
-    CommandSubType commandSubType; /**< type of throttle command */
-    string train; /**< The train description */
-    string payload; /**< the command payload */
-
-    /** @returns the unique identifier of the reply message */
-    id_type id()
-    {
-        return commandType;
-    };
-};
-
-/** Server state machine commands.
- */
-enum ServerState
-{
-    STATE_COMMAND = 0, /**< look for command */
-    STATE_MULTI_TYPE, /**< look for the multi-throttle type */
-    STATE_TRAIN, /**< look for the train */
-    STATE_SUBCOMMAND, /**< look for sub-command */
-    STATE_PAYLOAD, /**< look for data */
-    STATE_NEXT, /**< look for next command */
-};
-
 /** The interface definitions for WiThrottle.
  */
 struct Defs
@@ -173,63 +142,71 @@ struct Defs
         return init;
     }
 
-    /** Get the function status string.
+    /** Appends a multi-throttle action line to a string.
+     * @param out string (std::string or StringBuilder) to append to
+     * @param throttle multi-throttle identifier (e.g. 'T')
      * @param loco WiThrottle train handle string
-     * @param number function number
-     * @param state function state
-     * @return function status string
+     * @param action the action with its arguments (e.g. "V12")
+     * @param len number of bytes in action
      */
-    static string get_function_status_string(const char *loco, int number,
-                                             bool state)
+    template <class S>
+    static void append_action(S *out, char throttle, const string &loco,
+                              const char *action, size_t len)
     {
-        string status("MTA");
-        status.append(loco);
-        status.append("<;>F");
-        status.append(1, state ? '1' : '0');
-        if (number < 10)
-        {
-            status.append(1, '0' + number);
-        }
-        else
-        {
-            status.append(1, '0' + (number / 10));
-            status.append(1, '0' + (number % 10));
-        }
-        status.append("\n\n");
+        out->push_back(MULTI);
+        out->push_back(throttle);
+        out->push_back(ACTION);
+        out->append(loco);
+        out->append("<;>");
+        out->append(action, len);
+        out->append("\n\n");
+    }
 
-        return status;
+    /** Appends a multi-throttle action line with a numeric argument to a
+     * string.
+     * @param out string (std::string or StringBuilder) to append to
+     * @param throttle multi-throttle identifier (e.g. 'T')
+     * @param loco WiThrottle train handle string
+     * @param action the action prefix (e.g. "V" or "F1")
+     * @param value numeric argument rendered after the prefix
+     */
+    template <class S>
+    static void append_action_value(S *out, char throttle,
+                                    const string &loco, const char *action,
+                                    unsigned value)
+    {
+        StringBuilder<16> buf;
+        buf.append(action).append_unsigned(value);
+        append_action(out, throttle, loco, buf.data(), buf.size());
     }
 
-    /** Get the locomotive status command string.
-     * @param throttle OpenLCB assigned openLCB throttle
-     * @return locomotive status string
+    /** Appends the locomotive status lines (sent after a locomotive was
+     * added to a throttle) to a string.
+     * @param out string to append to
+     * @param throttle multi-throttle identifier (e.g. 'T')
+     * @param loco WiThrottle train handle string
+     * @param train OpenLCB throttle with the train state loaded
+     * @param speed_step current speed step (0..126)
+     * @param forward current direction
      */
-    static string get_loco_status_string(openlcb::TractionThrottle *throttle,
-                                         const char *loco)
+    static void append_loco_status(string *out, char throttle,
+                                   const string &loco,
+                                   openlcb::TractionThrottle *train,
+                                   unsigned speed_step, bool forward)
     {
-        string status("MT+");
-        status.append(loco);
-        status.append("<;>\n\n");
-        for (int i = 0; i <=28; ++i)
+        out->push_back(MULTI);
+        out->push_back(throttle);
+        out->push_back(ADD);
+        out->append(loco);
+        out->append("<;>\n\n");
+        for (unsigned i = 0; i <= 28; ++i)
         {
-            status.append(get_function_status_string(loco, i,
-                                                     throttle->get_fn(i)));
+            append_action_value(out, throttle, loco,
+                                train->get_fn(i) ? "F1" : "F0", i);
         }
-        status.append("MTA");
-        status.append(loco);
-        status.append("<;>V0\n\nMTA");
-        status.append(loco);
-        status.append("<;>R1\n\nMTA");
-        status.append(loco);
-        status.append("<;>S1\n\n");
-#if 0
-        string status("TL6915\n\nTF00\n\nTF01\n\nTF02\n\nTF03\n\nTF04\n\nTF05\n\n");
-        status.append("TF06\n\nTF07\n\nTF08\n\nTF09\n\nTF010\n\nTF011\n\nTF012\n\n");
-        status.append("TF013\n\nTF014\n\nTF015\n\nTF016\n\nTF017\n\nTF018\n\n");
-        status.append("TF019\n\nTF020\n\nTF021\n\nTF022\n\nTF023\n\nTF024\n\n");
-        status.append("TF025\n\nTF026\n\nTF027\n\nTF028\n\nTV0\n\nTR1\n\nTs1\n\n");
-#endif
-        return status;
+        append_action_value(out, throttle, loco, "V", speed_step);
+        append_action_value(out, throttle, loco, "R", forward ? 1 : 0);
+        append_action_value(out, throttle, loco, "s", 1);
     }
 };
 
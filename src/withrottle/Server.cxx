@@ -25,262 +25,676 @@
  * @date 17 December 2016
  */
 
+
 #include "withrottle/Server.hxx"
 
+#include <fcntl.h>
+#include <limits.h>
+
+#include "openlcb/TractionDefs.hxx"
+
 namespace withrottle
 {
 
-/** Constructor.
- * @param service service this flow belongs to
- * @param fd socket descriptor of throttle connection.
- * @param node OpenLCB node that proxies our throttles
+/** Locomotive handle matching all locomotives of a throttle. */
+static const char ALL_TRAINS[] = "*";
+
+/** Parse an unsigned decimal number.
+ * @param p first character, will be advanced past the digits
+ * @param end one past the last character
+ * @return the number parsed, 0 if there were no digits, UINT_MAX if the
+ *         number does not fit
  */
-ThrottleFlow::ThrottleFlow(Server *server, int fd, openlcb::Node *node)
-    : StateFlowBase(server)
-    , olcbThrottle(node)
-    , server(server)
-    , fd(fd)
-    , data()
-    , dataIndex(0)
-    , state(STATE_COMMAND)
-    , selectHelper(this)
-    , dispatcher(server)
-    , command(dispatcher.alloc())
-    , serverCommandLoco(this)
+static unsigned parse_unsigned(const char **p, const char *end)
 {
+    unsigned value = 0;
+    while (*p < end && **p >= '0' && **p <= '9')
+    {
+        unsigned digit = **p - '0';
+        value = value > (UINT_MAX - digit) / 10 ? UINT_MAX : value * 10 + digit;
+        ++*p;
+    }
+    return value;
 }
 
 /*
- * ThrottleFlow::entry()
+ * Server::Server()
  */
-StateFlowBase::Action ThrottleFlow::entry()
+Server::Server(const char *name, int port, openlcb::Node *node)
+    : Service(&serverExecutor)
+    , serverExecutor(name, 0, 2048)
+    , node(node)
+    , numConnections(0)
+    , numWrites(0)
 {
-    string init = Defs::get_init_string();
+    if (port != 0)
+    {
+        listener.reset(new SocketListener(
+            (port > 0 && port <= UINT16_MAX) ? port : Defs::DEFAULT_PORT,
+            std::bind(&Server::on_new_connection, this,
+                std::placeholders::_1)));
+    }
+}
 
-    return write_repeated(&selectHelper, fd, init.data(), init.length(),
-                          STATE(data_sent));
+/*
+ * Server::~Server()
+ */
+Server::~Server()
+{
+    if (listener)
+    {
+        listener->shutdown();
+    }
 }
 
 /*
- * ThrottleFlow::data_sent()
+ * Server::add_connection()
  */
-StateFlowBase::Action ThrottleFlow::data_sent()
+void Server::add_connection(int fd)
 {
-    return read_single(&selectHelper, fd, readRaw, sizeof(readRaw),
-                      STATE(data_received));
+    // The flows of all connections share our executor, so a read or write
+    // must never block it.
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    serverExecutor.add(new CallbackExecutable([this, fd]() {
+        ++numConnections;
+        ThrottleFlow *flow = new ThrottleFlow(this, fd);
+        flow->start();
+    }));
 }
 
 /*
- * ThrottleFlow::data_received()
+ * Server::find_or_create_train()
  */
-StateFlowBase::Action ThrottleFlow::data_received()
+TrainEntry *Server::find_or_create_train(bool is_long, unsigned address)
 {
-    if (selectHelper.hasError_)
+    unsigned key = (is_long ? 0x10000 : 0) | address;
+    std::unique_ptr<TrainEntry> &entry = trains[key];
+    if (!entry)
     {
-        /* remote throttle has closed the connection */
-        printf("WiThrottle connection closed\n");
-        return delete_this();
+        entry.reset(new TrainEntry(this, is_long, address));
     }
+    return entry.get();
+}
 
-    //printf("WiThrottle strraw: %.*s\n",
-    //       sizeof(readRaw) - selectHelper.remaining_, readRaw);
+/*
+ * TrainEntry::TrainEntry()
+ */
+TrainEntry::TrainEntry(Server *server, bool is_long, unsigned address)
+    : StateFlowBase(server)
+    , olcbThrottle(server->node)
+    , locoHandle(1, is_long ? ADDR_LONG : ADDR_SHORT)
+    , address(address)
+    , isLong(is_long)
+    , ready(0)
+    , forward(1)
+    , speedStep(0)
+{
+    char buf[12];
+    unsigned_integer_to_buffer(address, buf);
+    locoHandle.append(buf);
+    start_flow(STATE(assign));
+}
 
-    data.append(readRaw, sizeof(readRaw) - selectHelper.remaining_);
-    if (data.find('\n' != string::npos))
+/*
+ * TrainEntry::add_client()
+ */
+void TrainEntry::add_client(ThrottleFlow *flow, char throttle)
+{
+    clients.push_back({flow, throttle, false});
+    if (ready)
     {
-        bool result;
-        do
+        Defs::append_loco_status(flow->output(), throttle, locoHandle,
+                                 &olcbThrottle, speedStep, forward);
+        clients.back().hasStatus = true;
+        flow->send(nullptr, 0);
+    }
+}
+
+/*
+ * TrainEntry::remove_client()
+ */
+void TrainEntry::remove_client(ThrottleFlow *flow, char throttle)
+{
+    for (auto it = clients.begin(); it != clients.end(); ++it)
+    {
+        if (it->flow == flow && it->throttle == throttle)
         {
-            result = parse();
-            if (result)
-            {
-                dispatcher.send(command);
-                command = dispatcher.alloc();
-            }
-        } while (result);
+            clients.erase(it);
+            return;
+        }
+    }
+}
+
+/*
+ * TrainEntry::assign()
+ */
+StateFlowBase::Action TrainEntry::assign()
+{
+    openlcb::NodeID node_id = openlcb::TractionDefs::train_node_id_from_legacy(
+        isLong ? dcc::TrainAddressType::DCC_LONG_ADDRESS
+               : dcc::TrainAddressType::DCC_SHORT_ADDRESS,
+        address);
+
+    return invoke_subflow_and_wait(&olcbThrottle, STATE(assign_done),
+        openlcb::TractionThrottleCommands::ASSIGN_TRAIN, node_id, false);
+}
+
+/*
+ * TrainEntry::assign_done()
+ */
+StateFlowBase::Action TrainEntry::assign_done()
+{
+    auto *m = full_allocation_result(&olcbThrottle);
+    int result = m->data()->resultCode;
+    m->unref();
+    if (result)
+    {
+        LOG(WARNING, "WiThrottle: failed to assign %s: %04x",
+            locoHandle.c_str(), result);
+        // The throttles still get a (default) status; their commands will be
+        // dropped by the OpenLCB throttle.
+        return call_immediately(STATE(status_ready));
     }
 
-    return read_single(&selectHelper, fd, readRaw, sizeof(readRaw),
-                       STATE(data_received));
+    return invoke_subflow_and_wait(&olcbThrottle, STATE(load_done),
+        openlcb::TractionThrottleCommands::LOAD_STATE);
 }
 
 /*
- * ThrottleFlow::parse()
+ * TrainEntry::load_done()
  */
-bool ThrottleFlow::parse()
+StateFlowBase::Action TrainEntry::load_done()
 {
-    const char *c_str = data.c_str();
-    printf("WiThrottle stream: %s\n", c_str + dataIndex);
+    auto *m = full_allocation_result(&olcbThrottle);
+    m->unref();
 
-    do
+    openlcb::SpeedType speed = olcbThrottle.get_speed();
+    forward = speed.direction() == openlcb::SpeedType::FORWARD;
+    float mph = speed.mph();
+    speedStep = mph > 126 ? 126 : (unsigned)(mph + 0.5);
+    return call_immediately(STATE(status_ready));
+}
+
+/*
+ * TrainEntry::status_ready()
+ */
+StateFlowBase::Action TrainEntry::status_ready()
+{
+    ready = 1;
+
+    for (Client &c : clients)
     {
-        switch (state)
+        Defs::append_loco_status(c.flow->output(), c.throttle, locoHandle,
+                                 &olcbThrottle, speedStep, forward);
+        c.hasStatus = true;
+        c.flow->send(nullptr, 0);
+    }
+    return exit();
+}
+
+/*
+ * TrainEntry::set_speed()
+ */
+void TrainEntry::set_speed(unsigned step)
+{
+    speedStep = step > 126 ? 126 : step;
+    openlcb::SpeedType speed;
+    speed.set_mph(speedStep);
+    speed.set_direction(
+        forward ? openlcb::SpeedType::FORWARD : openlcb::SpeedType::REVERSE);
+    olcbThrottle.set_speed(speed);
+}
+
+/*
+ * TrainEntry::action()
+ */
+void TrainEntry::action(ThrottleFlow *flow, char throttle, const char *action,
+                        const char *end)
+{
+    if (!ready || action >= end)
+    {
+        // Commands before the train state is loaded would be overwritten by
+        // the state we load.
+        return;
+    }
+    const char *p = action + 1;
+    switch (*action)
+    {
+        case VELOCITY:
         {
-            case STATE_COMMAND:
-                if (data.length() < 2)
-                {
-                    /* need more data first */
-                    return false;
-                }
-                parse_command();
-                break;
-            case STATE_MULTI_TYPE:
-                parse_multi_type();
-                break;
-            case STATE_TRAIN:
-                parse_train();
+            if (p < end && *p == '-')
+            {
+                // Negative speed is an emergency stop.
+                olcbThrottle.set_emergencystop();
+                speedStep = 0;
+            }
+            else
+            {
+                set_speed(parse_unsigned(&p, end));
+            }
+            StringBuilder<8> buf;
+            buf.push_back(VELOCITY).append_unsigned(speedStep);
+            fan_out(buf.data(), buf.size(), flow);
+            break;
+        }
+        case ESTOP:
+            olcbThrottle.set_emergencystop();
+            speedStep = 0;
+            fan_out("V0", 2, flow);
+            break;
+        case IDLE:
+            set_speed(0);
+            fan_out("V0", 2, flow);
+            break;
+        case DIRECTION:
+            forward = (p < end && *p == '1') ? 1 : 0;
+            set_speed(speedStep);
+            fan_out(forward ? "R1" : "R0", 2, flow);
+            break;
+        case FUNCTION:
+        case FORCE:
+        {
+            if (p >= end)
+            {
                 break;
-            case STATE_SUBCOMMAND:
-                if (parse_subcommand())
-                {
-                    return true;
-                }
+            }
+            bool press = *p++ == '1';
+            unsigned fn = parse_unsigned(&p, end);
+            if (fn > 28)
+            {
                 break;
-            case STATE_PAYLOAD:
-            default:
-            case STATE_NEXT:
-                if (data[0] == '\n')
-                {
-                    dataIndex = 0;
-                    state = STATE_COMMAND;
-                }
-                data.erase(0, 1);
+            }
+            bool value;
+            if (*action == FORCE)
+            {
+                value = press;
+            }
+            else if (press)
+            {
+                // Latching function: toggle on button press.
+                value = !olcbThrottle.get_fn(fn);
+            }
+            else
+            {
+                // Button release.
                 break;
+            }
+            olcbThrottle.set_fn(fn, value ? 1 : 0);
+            StringBuilder<8> buf;
+            buf.push_back(FUNCTION).push_back(value ? '1' : '0');
+            buf.append_unsigned(fn);
+            // The throttle that pressed the button also needs the new state.
+            fan_out(buf.data(), buf.size(), nullptr);
+            break;
+        }
+        case QUERY:
+        {
+            string *out = flow->output();
+            if (p < end && *p == VELOCITY)
+            {
+                Defs::append_action_value(out, throttle, locoHandle, "V",
+                                          speedStep);
+            }
+            else if (p < end && *p == DIRECTION)
+            {
+                Defs::append_action_value(out, throttle, locoHandle, "R",
+                                          forward ? 1 : 0);
+            }
+            flow->send(nullptr, 0);
+            break;
         }
-    } while (data.length());
+        default:
+            break;
+    }
+}
 
-    return false;
+/*
+ * TrainEntry::fan_out()
+ */
+void TrainEntry::fan_out(const char *action, size_t len, ThrottleFlow *except)
+{
+    line.clear();
+    Defs::append_action(&line, '?', locoHandle, action, len);
+    for (Client &c : clients)
+    {
+        if (c.flow == except || !c.hasStatus)
+        {
+            continue;
+        }
+        line[1] = c.throttle;
+        c.flow->send(line.data(), line.size());
+    }
 }
 
 /*
- * ThrottleFlow::parse_command()
+ * ThrottleFlow::ThrottleFlow()
  */
-void ThrottleFlow::parse_command()
+ThrottleFlow::ThrottleFlow(Server *server, int fd)
+    : StateFlowBase(server)
+    , server(server)
+    , fd(fd)
+    , readLength(0)
+    , closing(false)
+    , selectHelper(this)
+    , writer(this)
 {
-    command->data()->commandType = (CommandType)data[0];
+}
 
-    switch (data[0])
+/*
+ * ThrottleFlow::~ThrottleFlow()
+ */
+ThrottleFlow::~ThrottleFlow()
+{
+    for (Train &t : trains)
+    {
+        t.entry->remove_client(this, t.throttle);
+    }
+    ::close(fd);
+    --server->numConnections;
+}
+
+/*
+ * ThrottleFlow::send()
+ */
+void ThrottleFlow::send(const char *data, size_t len)
+{
+    if (closing)
+    {
+        return;
+    }
+    outputPending.append(data, len);
+    // The writer runs only after the current executable returns, so
+    // everything else queued until then goes out in the same write.
+    writer.kick();
+}
+
+/*
+ * ThrottleFlow::entry()
+ */
+StateFlowBase::Action ThrottleFlow::entry()
+{
+    send(Defs::get_init_string());
+    return call_immediately(STATE(read_more));
+}
+
+/*
+ * ThrottleFlow::read_more()
+ */
+StateFlowBase::Action ThrottleFlow::read_more()
+{
+    return read_single(&selectHelper, fd, readRaw + readLength,
+                       sizeof(readRaw) - readLength, STATE(data_received));
+}
+
+/*
+ * ThrottleFlow::data_received()
+ */
+StateFlowBase::Action ThrottleFlow::data_received()
+{
+    if (selectHelper.hasError_)
+    {
+        /* remote throttle has closed the connection */
+        LOG(INFO, "WiThrottle connection closed");
+        closing = true;
+        return call_immediately(STATE(shutdown));
+    }
+
+    char *begin = readRaw;
+    char *end = readRaw + sizeof(readRaw) - selectHelper.remaining_;
+    char *nl;
+    while ((nl = (char *)memchr(begin, '\n', end - begin)) != nullptr)
+    {
+        char *line_end = nl;
+        if (line_end > begin && line_end[-1] == '\r')
+        {
+            --line_end;
+        }
+        if (line_end > begin)
+        {
+            process_line(begin, line_end);
+        }
+        begin = nl + 1;
+    }
+    readLength = end - begin;
+    if (readLength == sizeof(readRaw))
+    {
+        // Line too long, drop it.
+        readLength = 0;
+    }
+    else
+    {
+        memmove(readRaw, begin, readLength);
+    }
+
+    if (closing)
+    {
+        return call_immediately(STATE(shutdown));
+    }
+    return call_immediately(STATE(read_more));
+}
+
+/*
+ * ThrottleFlow::shutdown()
+ */
+StateFlowBase::Action ThrottleFlow::shutdown()
+{
+    if (!writer.idle())
+    {
+        // The writer notifies us when it is done.
+        return wait();
+    }
+    return delete_this();
+}
+
+/*
+ * ThrottleFlow::process_line()
+ */
+void ThrottleFlow::process_line(const char *line, const char *end)
+{
+    switch (*line)
     {
         default:
-        case SECONDARY:
         case HEX_PACKET:
         case PANEL:
         case ROSTER:
-        case QUIT:
-            state = STATE_NEXT;
-            return;
-        case MULTI:
-            state = data[1] == 'T' ? STATE_MULTI_TYPE : STATE_NEXT;
-            data.erase(0, 1);
             break;
-        case PRIMARY:
-            state = STATE_SUBCOMMAND;
+        case QUIT:
+            closing = true;
             break;
-        case HEARTBEAT:
         case SET_NAME:
-            write(fd, "*10\n\n", 5);
+            name.assign(line + 1, end - line - 1);
+            // fall through
+        case HEARTBEAT:
+            send(Defs::HEARTBEAT_TIMEOUT, strlen(Defs::HEARTBEAT_TIMEOUT));
+            send("\n\n", 2);
+            break;
         case SET_ID:
-            state = STATE_PAYLOAD;
+            if (end - line > 2 && line[1] == 'U')
+            {
+                id.assign(line + 2, end - line - 2);
+            }
+            break;
+        case PRIMARY:
+        case SECONDARY:
+            // Single-throttle protocol: an address selects the locomotive,
+            // everything else applies to it.
+            if (end - line < 2)
+            {
+                break;
+            }
+            if (line[1] == ADDR_LONG || line[1] == ADDR_SHORT)
+            {
+                remove_trains(*line, ALL_TRAINS, ALL_TRAINS + 1);
+                add_train(*line, line + 1, end);
+            }
+            else
+            {
+                process_multi(*line, ACTION, ALL_TRAINS, ALL_TRAINS + 1,
+                              line + 1, end);
+            }
+            break;
+        case MULTI:
+        {
+            if (end - line < 3)
+            {
+                break;
+            }
+            const char *handle = line + 3;
+            const char *sep = handle;
+            while (sep + 3 <= end && memcmp(sep, "<;>", 3) != 0)
+            {
+                ++sep;
+            }
+            if (sep + 3 > end)
+            {
+                break;
+            }
+            process_multi(line[1], line[2], handle, sep, sep + 3, end);
             break;
+        }
     }
-
-    data.erase(0, 1);
 }
 
 /*
- * ThrottleFlow::parse_multi_type()
+ * ThrottleFlow::process_multi()
  */
-void ThrottleFlow::parse_multi_type()
+void ThrottleFlow::process_multi(char throttle, char type, const char *handle,
+                                 const char *handle_end, const char *cmd,
+                                 const char *end)
 {
-    switch (data[0])
+    switch (type)
     {
         default:
-            state = STATE_NEXT;
-            return;
-        case ACTION:
+            break;
         case ADD:
+            add_train(throttle, cmd, end);
+            break;
         case REMOVE:
-            state = STATE_TRAIN;
-            command->data()->commandMultiType = (CommandMultiType)data[0];
+            remove_trains(throttle, handle, handle_end);
+            break;
+        case ACTION:
+            if (cmd < end && (*cmd == RELEASE || *cmd == DISPATCH))
+            {
+                remove_trains(throttle, handle, handle_end);
+                break;
+            }
+            for (Train &t : trains)
+            {
+                if (matches(t, throttle, handle, handle_end))
+                {
+                    t.entry->action(this, throttle, cmd, end);
+                }
+            }
             break;
     }
-
-    data.erase(0, 1);
 }
 
 /*
- * ThrottleFlow::parse_train()
+ * ThrottleFlow::add_train()
  */
-void ThrottleFlow::parse_train()
+void ThrottleFlow::add_train(char throttle, const char *cmd, const char *end)
 {
-    size_t end = data.find("<;>");
-
-    switch (end)
+    if (end - cmd < 2 || (*cmd != ADDR_LONG && *cmd != ADDR_SHORT))
     {
-        case string::npos:
-        case 1:
-            if (data[0] == '*')
-            {
-                break;
-            }
-        case 0:
-            /* invalid string */
-            state = STATE_NEXT;
+        return;
+    }
+    bool is_long = *cmd == ADDR_LONG;
+    const char *p = cmd + 1;
+    unsigned address = parse_unsigned(&p, end);
+    if (p != end || address > (is_long ? 9999u : 127u) ||
+        (!is_long && address == 0))
+    {
+        return;
+    }
+    TrainEntry *entry = server->find_or_create_train(is_long, address);
+    for (Train &t : trains)
+    {
+        if (t.entry == entry && t.throttle == throttle)
+        {
             return;
+        }
     }
-
-    command->data()->train.assign(data, 0, end);
-    data.erase(0, end + 3);
-    state = STATE_SUBCOMMAND;
+    trains.push_back({throttle, entry});
+    entry->add_client(this, throttle);
 }
 
 /*
- * ThrottleFlow::parse_subcommand()
+ * ThrottleFlow::remove_trains()
  */
-bool ThrottleFlow::parse_subcommand()
+void ThrottleFlow::remove_trains(char throttle, const char *handle,
+                                 const char *handle_end)
 {
-    switch (data[0])
+    for (auto it = trains.begin(); it != trains.end();)
     {
-        default:
-        case VELOCITY:
-        case ESTOP:
-        case FUNCTION:
-        case FORCE:
-        case DIRECTION:
-        case RELEASE:
-        case DISPATCH:
-        case ADDR_SHORT:
-        case ADDR_ROSTER:
-        case CONSIST:
-        case CONSIST_LEAD:
-        case IDLE:
-        case SS_MODE:
-        case MOMENTARY:
-        case QUERY:
-            state = STATE_NEXT;
-            return false;
-        case ADDR_LONG:
-            state = STATE_PAYLOAD;
-            break;
+        if (!matches(*it, throttle, handle, handle_end))
+        {
+            ++it;
+            continue;
+        }
+        it->entry->remove_client(this, throttle);
+        string *out = output();
+        out->push_back(MULTI);
+        out->push_back(throttle);
+        out->push_back(REMOVE);
+        out->append(it->entry->handle());
+        out->append("<;>\n\n");
+        send(nullptr, 0);
+        it = trains.erase(it);
     }
+}
 
-    command->data()->commandSubType = (CommandSubType)data[0];
-    data.erase(0, 1);
+/*
+ * ThrottleFlow::matches()
+ */
+bool ThrottleFlow::matches(const Train &t, char throttle, const char *handle,
+                           const char *handle_end)
+{
+    if (t.throttle != throttle)
+    {
+        return false;
+    }
+    size_t len = handle_end - handle;
+    if (len == 1 && *handle == '*')
+    {
+        return true;
+    }
+    return t.entry->handle().size() == len &&
+        memcmp(t.entry->handle().data(), handle, len) == 0;
+}
 
-    size_t end = data.find('\n');
+/*
+ * ThrottleFlow::Writer::write_batch()
+ */
+StateFlowBase::Action ThrottleFlow::Writer::write_batch()
+{
+    parent->outputSending.clear();
+    parent->outputSending.swap(parent->outputPending);
+    ++parent->server->numWrites;
+    return write_repeated(&selectHelper, parent->fd,
+                          parent->outputSending.data(),
+                          parent->outputSending.size(), STATE(written));
+}
 
-    switch (end)
+/*
+ * ThrottleFlow::Writer::written()
+ */
+StateFlowBase::Action ThrottleFlow::Writer::written()
+{
+    if (selectHelper.hasError_)
     {
-        case string::npos:
-            /* invalid payload */
-            state = STATE_NEXT;
-            return false;
+        parent->outputPending.clear();
     }
-
-    command->data()->payload.assign(data, 0, end);
-    data.erase(0, end);
-    state = STATE_COMMAND;
-    return true;
+    if (!parent->outputPending.empty())
+    {
+        return call_immediately(STATE(write_batch));
+    }
+    if (parent->closing)
+    {
+        // The parent is waiting for us in shutdown(); it runs only after we
+        // returned.
+        parent->notify();
+    }
+    return exit();
 }
 
 } /* namespace withrottle */
@@ -28,95 +28,249 @@
 #ifndef _WITHROTTLE_SERVER_HXX_
 #define _WITHROTTLE_SERVER_HXX_
 
-#include <string>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
-#include "executor/Dispatcher.hxx"
 #include "executor/Service.hxx"
+#include "executor/StateFlow.hxx"
 #include "openlcb/TractionThrottle.hxx"
 #include "utils/socket_listener.hxx"
 #include "withrottle/Defs.hxx"
-#include "withrottle/ServerCommand.hxx"
-#include "withrottle/ServerCommandLoco.hxx"
 
 namespace withrottle
 {
-/* forward declaration */
+/* forward declarations */
 class ThrottleFlow;
+class TrainEntry;
 
-/** WiThrottle server object.
+/** WiThrottle server. All throttle connections are served by a single
+ * executor. Commands are parsed in place from each connection's read buffer,
+ * and the outgoing messages of a connection are batched into as few writes
+ * as possible. Throttles controlling the same locomotive share one OpenLCB
+ * throttle and see each other's changes.
  */
 class Server : public Service
 {
 public:
     /** Constructor.
      * @param name name of the bus
-     * @param port TCP port to listen for connections on, -1 for default.
+     * @param port TCP port to listen for connections on, -1 for default, 0
+     *        to not listen (connections are then added with
+     *        add_connection())
      * @param node reference to the OpenLCB Node that proxies our bus
      */
-    Server(const char *name, int port, openlcb::Node *node)
-        : Service(&executor)
-        , executor(name, 0, 2048)
-        , node(node)
-        , listener((port >= 0 || port <= UINT16_MAX) ? port : Defs::DEFAULT_PORT,
-                   std::bind(&Server::on_new_connection, this,
-                   std::placeholders::_1))
+    Server(const char *name, int port, openlcb::Node *node);
+
+    /** Destructor. All connections must be closed by the remote end
+     * beforehand.
+     */
+    ~Server();
+
+    /** Start serving a throttle connection. May be called from any thread.
+     * @param fd connected socket descriptor; the server takes ownership
+     */
+    void add_connection(int fd);
+
+    /** @return the number of open throttle connections. Must be called on
+     * the server's executor.
+     */
+    size_t num_connections()
     {
+        return numConnections;
     }
 
-    /** Destructor.
+    /** @return the number of locomotives the server has assigned. Must be
+     * called on the server's executor.
      */
-    ~Server()
+    size_t num_trains()
     {
-        listener.shutdown();
+        return trains.size();
     }
 
-    /** Start the server.
+    /** @return the number of write calls made to the throttle connections.
+     * Must be called on the server's executor.
      */
-    void start()
+    size_t num_writes()
     {
+        return numWrites;
     }
 
 private:
     /** A new throttle connection is made.
      * @param fd socket descriptor
      */
-    void on_new_connection(int fd);
+    void on_new_connection(int fd)
+    {
+        add_connection(fd);
+    }
+
+    /** Look up the shared state of a locomotive, creating it (and assigning
+     * the train to our node) if no throttle controlled it yet.
+     * @param is_long true for long DCC address, false for short
+     * @param address DCC address
+     * @return shared locomotive state
+     */
+    TrainEntry *find_or_create_train(bool is_long, unsigned address);
 
     /** The executor that will run the WiThrottle flows. */
-    Executor<1> executor;
+    Executor<1> serverExecutor;
 
     /** node reference */
     openlcb::Node* node;
 
+    /** Locomotives that throttles asked for, keyed by address and address
+     * type. These stay assigned to our node even when no throttle controls
+     * them anymore. */
+    std::map<unsigned, std::unique_ptr<TrainEntry>> trains;
+
+    /** number of open connections */
+    size_t numConnections;
+
+    /** number of write calls made */
+    size_t numWrites;
+
     /** listen socket for new connections */
-    SocketListener listener;
+    std::unique_ptr<SocketListener> listener;
 
     /** allow access from ThrottleFlow */
     friend class ThrottleFlow;
 
+    /** allow access from TrainEntry */
+    friend class TrainEntry;
+
     DISALLOW_COPY_AND_ASSIGN(Server);
 };
 
-/** State flow for handling a throttle instance.
- */
+/** State of a locomotive shared by all the throttles controlling it. */
+class TrainEntry : public StateFlowBase
+{
+public:
+    /** Constructor. Starts assigning the train.
+     * @param server parent server
+     * @param is_long true for long DCC address, false for short
+     * @param address DCC address
+     */
+    TrainEntry(Server *server, bool is_long, unsigned address);
+
+    /** Add a throttle controlling this locomotive. The throttle gets the
+     * current locomotive status as soon as the train state is loaded.
+     * @param flow throttle connection
+     * @param throttle multi-throttle identifier within the connection
+     */
+    void add_client(ThrottleFlow *flow, char throttle);
+
+    /** Remove a throttle controlling this locomotive.
+     * @param flow throttle connection
+     * @param throttle multi-throttle identifier within the connection
+     */
+    void remove_client(ThrottleFlow *flow, char throttle);
+
+    /** Execute a multi-throttle action on the locomotive, and forward the
+     * resulting state change to the other throttles controlling it.
+     * @param flow throttle connection the action came from
+     * @param throttle multi-throttle identifier within the connection
+     * @param action first character of the action
+     * @param end one past the last character of the action
+     */
+    void action(ThrottleFlow *flow, char throttle, const char *action,
+                const char *end);
+
+    /** @return WiThrottle handle string of the locomotive (e.g. "L1234") */
+    const string &handle()
+    {
+        return locoHandle;
+    }
+
+private:
+    /** A throttle controlling this locomotive. */
+    struct Client
+    {
+        ThrottleFlow *flow; /**< throttle connection */
+        char throttle; /**< multi-throttle identifier */
+        bool hasStatus; /**< true if the locomotive status was sent */
+    };
+
+    /** Assign the train to our node.
+     * @return next state assign_done()
+     */
+    StateFlowBase::Action assign();
+
+    /** Train assignment complete, load the train state.
+     * @return next state load_done(), or status_ready() if the train could
+     * not be assigned
+     */
+    StateFlowBase::Action assign_done();
+
+    /** Train state loaded, take over the speed and direction.
+     * @return next state status_ready()
+     */
+    StateFlowBase::Action load_done();
+
+    /** Send the status to the waiting throttles.
+     * @return exit()
+     */
+    StateFlowBase::Action status_ready();
+
+    /** Set the speed and send it to the train.
+     * @param step speed step (0..126)
+     */
+    void set_speed(unsigned step);
+
+    /** Forward an action line to the throttles controlling the locomotive.
+     * The line is rendered once and the multi-throttle identifier is patched
+     * for each throttle.
+     * @param action the action with its arguments
+     * @param len number of bytes in action
+     * @param except throttle connection to skip, or nullptr
+     */
+    void fan_out(const char *action, size_t len, ThrottleFlow *except);
+
+    /** OpenLCB throttle instance */
+    openlcb::TractionThrottle olcbThrottle;
+
+    /** throttles controlling this locomotive */
+    std::vector<Client> clients;
+
+    /** WiThrottle handle of the locomotive */
+    string locoHandle;
+
+    /** scratch buffer for rendering the fanned-out lines; big enough for
+     * the longest action line */
+    StringBuilder<32> line;
+
+    /** DCC address */
+    uint16_t address;
+
+    /** true for long DCC address */
+    uint8_t isLong : 1;
+
+    /** true if the train state is loaded */
+    uint8_t ready : 1;
+
+    /** true if the direction is forward */
+    uint8_t forward : 1;
+
+    /** current speed step */
+    uint8_t speedStep;
+
+    DISALLOW_COPY_AND_ASSIGN(TrainEntry);
+};
+
+/** One throttle connection. */
 class ThrottleFlow : public StateFlowBase
 {
 public:
     /** Constructor.
-     * @param service service this flow belongs to
+     * @param server server this flow belongs to
      * @param fd socket descriptor of throttle connection.
-     * @param node OpenLCB node that proxies our throttles
      */
-    ThrottleFlow(Server *server, int fd, openlcb::Node *node);
+    ThrottleFlow(Server *server, int fd);
 
     /** Destructor.
      */
-    ~ThrottleFlow()
-    {
-        close(fd);
-        command->unref();
-    }
+    ~ThrottleFlow();
 
     /** Start the service.
      */
@@ -125,101 +279,180 @@ public:
         start_flow(STATE(entry));
     }
 
-private:
-    /** Parse the incoming data.
-     * @return true if a fully parsed command has been found, else false
+    /** Queue data to be sent to the throttle. Everything queued before the
+     * writer gets to run goes out in a single write. Must be called on the
+     * server's executor.
+     * @param data data to send
+     * @param len number of bytes to send
      */
-    bool parse();
-
-    /** Parse the incoming data. */
-    void parse_command();
+    void send(const char *data, size_t len);
 
-    /** Parse the incoming data. */
-    void parse_multi_type();
+    /** Queue data to be sent to the throttle.
+     * @param data data to send
+     */
+    void send(const string &data)
+    {
+        send(data.data(), data.size());
+    }
 
-    /** Parse the incoming data. */
-    void parse_train();
+    /** @return the output batch. Appending to it needs a call to send()
+     * afterwards to flush it. */
+    string *output()
+    {
+        return &outputPending;
+    }
 
-    /** Parse the incoming data.
-     * @return true if a fully parsed command has been found, else false
-     */
-    bool parse_subcommand();
+private:
+    /** A locomotive controlled by this connection. */
+    struct Train
+    {
+        char throttle; /**< multi-throttle identifier */
+        TrainEntry *entry; /**< shared locomotive state */
+    };
 
-    /** Parse the incoming data. */
-    void parse_multi();
+    /** Flow writing the output batches to the socket. */
+    class Writer : public StateFlowBase
+    {
+    public:
+        /** Constructor.
+         * @param parent throttle connection we are writing for
+         */
+        Writer(ThrottleFlow *parent)
+            : StateFlowBase(parent->service())
+            , parent(parent)
+        {
+        }
+
+        /** Start writing if there is queued output and we are idle. */
+        void kick()
+        {
+            if (is_terminated() && !parent->outputPending.empty())
+            {
+                start_flow(STATE(write_batch));
+            }
+        }
+
+        /** @return true if the writer is not writing anything */
+        bool idle()
+        {
+            return is_terminated();
+        }
+
+    private:
+        /** Take the queued output and write it.
+         * @return next state written()
+         */
+        StateFlowBase::Action write_batch();
+
+        /** Write complete.
+         * @return write_batch() if there is more output, else exit()
+         */
+        StateFlowBase::Action written();
+
+        /** parent connection */
+        ThrottleFlow *parent;
+
+        /** Helper for waiting on the file descriptor */
+        StateFlowSelectHelper selectHelper{this};
+    };
 
     /** Beginning of state flow.
-     * @return next state is data_sent()
+     * @return next state is read_more()
      */
     StateFlowBase::Action entry();
 
-    /** Data sent successfully.
+    /** Read more data from the socket.
      * @return next state is data_received()
      */
-    StateFlowBase::Action data_sent();
+    StateFlowBase::Action read_more();
 
     /** Process read data.
-     * @return next state is data_received()
+     * @return next state is read_more() or shutdown()
      */
     StateFlowBase::Action data_received();
 
-    /**< OpenLCB throttle instance */
-    openlcb::TractionThrottle olcbThrottle;
+    /** Connection closing, wait for the writer to finish.
+     * @return delete_this() when the writer is done
+     */
+    StateFlowBase::Action shutdown();
+
+    /** Process one command line.
+     * @param line first character of the line
+     * @param end one past the last character of the line
+     */
+    void process_line(const char *line, const char *end);
+
+    /** Process a multi-throttle command.
+     * @param throttle multi-throttle identifier
+     * @param type type of multi-throttle command
+     * @param handle first character of the locomotive handle
+     * @param handle_end one past the last character of the handle
+     * @param cmd first character of the command after the "<;>"
+     * @param end one past the last character of the line
+     */
+    void process_multi(char throttle, char type, const char *handle,
+                       const char *handle_end, const char *cmd,
+                       const char *end);
+
+    /** Add a locomotive to a throttle.
+     * @param throttle multi-throttle identifier
+     * @param cmd address of the locomotive (e.g. "L1234")
+     * @param end one past the last character of cmd
+     */
+    void add_train(char throttle, const char *cmd, const char *end);
+
+    /** Remove locomotives from a throttle.
+     * @param throttle multi-throttle identifier
+     * @param handle locomotive handle or "*" for all locomotives
+     * @param handle_end one past the last character of the handle
+     */
+    void remove_trains(char throttle, const char *handle,
+                       const char *handle_end);
+
+    /** Check whether a locomotive matches a handle in a command.
+     * @param t locomotive controlled by this connection
+     * @param throttle multi-throttle identifier in the command
+     * @param handle locomotive handle or "*" for all locomotives
+     * @param handle_end one past the last character of the handle
+     * @return true if the command applies to the locomotive
+     */
+    static bool matches(const Train &t, char throttle, const char *handle,
+                        const char *handle_end);
 
     /** reference to parent server */
     Server *server;
 
     string name; /**< name of throttle */
     string id; /**< id of throttle */
-    LocoAddress address; /**< primary locomitve addres */
-    LocoAddress secondaryAddress; /**< secondary locomotive address */
+
+    /** locomotives controlled by this connection */
+    std::vector<Train> trains;
 
     /** socket descriptor of throttle connection */
     int fd;
 
-    /** read data buffer */
-    char readRaw[128];
+    /** number of bytes of a partial line at the beginning of readRaw */
+    size_t readLength;
+
+    /** true if the connection is closing */
+    bool closing;
 
-    /** agrigate pre-processed stream data */
-    string data;
+    /** read data buffer */
+    char readRaw[256];
 
-    /** data index for parsing */
-    size_t dataIndex;
+    /** output waiting for the writer */
+    string outputPending;
 
-    /** Current state of parsing the data */
-    ServerState state;
+    /** output being written by the writer */
+    string outputSending;
 
     /** Helper for waiting on data from a file descriptor */
     StateFlowSelectHelper selectHelper;
 
-    /** dispatch flow that will handle messages incoming from the cab */
-    typedef DispatchFlow<Buffer<ThrottleCommand>, 1> CommandDispatchFlow;
-
-    /** flow responsible for routing incoming messages to handlers. */
-    CommandDispatchFlow dispatcher;
-
-    /** throttle command */
-    Buffer<ThrottleCommand> *command;
-
-    /** handler for locomotive commands */
-    ServerCommandLoco serverCommandLoco;
-
-    /** allow access to private members from class ServerCommandBase */
-    friend class ServerCommandBase;
-
-    /** allow access to private members from class ServerCommandLoco */
-    friend class ServerCommandLoco;
+    /** writes the output batches */
+    Writer writer;
 };
 
-/*
- * Server::on_new_connection()
- */
-inline void Server::on_new_connection(int fd)
-{
-    ThrottleFlow *flow = new ThrottleFlow(this, fd, node);
-    flow->start();
-}
-
 } /* namespace withrottle */
 
 #endif /* _WITHROTTLE_SERVER_HXX_ */